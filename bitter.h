@@ -77,28 +77,263 @@
 //     return engineTester.RunAllTests();
 // };
 
+// BENCHMARKS
+
+// Benchmark cases are defined next to the test cases, the function is a single iteration.
+// The iterations are calibrated after a warmup and min/median/p99/stddev in ns per iteration are reported
+// On Linux the cycles, instructions, cache misses and branch misses per iteration are also read through perf_event_open
+//
+//  void MyTestClass::Define()
+//  {
+//      BenchmarkCase("Hash 64 bytes", [this]() {
+//          bitter::DoNotOptimize(Hash(Buffer, 64));
+//      });
+//  }
+
+// FIXTURES
+
+// SetUp and TearDown run around every case, BeforeAll and AfterAll once per class around its selected cases.
+// A fixture shared by several classes is constructed on first use and destroyed after the last class that declared it in DeclareSharedFixtures
+//
+//  TEST_DEFINE_CLASS(MyTestClass)
+//          static void DeclareSharedFixtures(bitter::SharedFixtureUsers& users) { users.Use<MyDataset>(); };
+//          void BeforeAll() override { Dataset = bitter::SharedFixtures::Acquire<MyDataset>(); };
+//          void AfterAll() override { Dataset.reset(); };
+//          std::shared_ptr<MyDataset> Dataset;
+//  TEST_END_CLASS(MyTestClass)
+//
+//  void MyTestClass::Define()
+//  {
+//          TestCase("Uses the dataset", [this]() { TEST_TRUE(Dataset->IsLoaded()); });
+//  }
+
+// SNAPSHOTS
+
+// TEST_MATCHES_SNAPSHOT compares an output with its golden file in the --snapshot-dir, a mismatch writes the output next to it as .actual
+//
+//  const std::vector<uint8_t> image = Render(scene);
+//  TEST_MATCHES_SNAPSHOT("scene.rgba", image.data(), image.size());
+
+// THREADS
+
+// The threads started by a case report their assertions to it once attached, their messages are merged when the case ends
+//
+//  std::thread producer = StartTestThread([this, &queue]() { TEST_TRUE(queue.Push(1)); });
+//  producer.join();
+
+// ASYNC CASES
+
+// With C++20 an async case is a coroutine returning bitter::Task<>, the async cases of a class calling SetRunCasesInParallel(true) are in flight
+// together on an event loop
+//
+//  AsyncTestCase("Echo", [this]() -> bitter::Task<> {
+//      co_await bitter::WaitReadable(Socket);
+//      TEST_EQUAL(co_await ReadReply(Socket), "pong");
+//  }, bitter::Timeout{ 2s });
+
+// PARAMETERIZED CASES
+
+// TestCaseP runs a function for every parameter of a generator, the parameters are split in chunks that run as separate cases.
+// Generators: Range(begin, end, step), Values({...}), Combine(generators...), CsvRows(filename) and BinaryRecords<T>(filename)
+//
+//  TestCaseP("Decode", bitter::Combine(bitter::Values({ 8, 16 }), bitter::Range(0, 1000)), [this](const std::tuple<int, int>& p) {
+//      TEST_TRUE(Decode(std::get<0>(p), std::get<1>(p)));
+//  });
+
+// PROPERTY CASES
+
+// PropertyCase checks a predicate on random values, a falsified property is shrunk and reported with the seed that reproduces it
+//
+//  PropertyCase("Round trip", bitter::VectorsOf(bitter::Integers<uint8_t>()), [](const std::vector<uint8_t>& data) {
+//      return Decompress(Compress(data)) == data;
+//  });
+
+// SPLIT COMPILATION
+
+// Compile every test file with -DBITTER_SPLIT, they only see the declarations, the templates of the test classes and the macros with the light
+// standard headers. The definitions of the framework, the runner, the reporters and the heavy includes (<iostream>, <sstream>, <fstream>, <regex>,
+// <functional>, the platform headers) are compiled once, in the file defining BITTER_IMPLEMENTATION before including bitter.h.
+// A test file using the standard streams or the other headers includes them itself
+//
+//  #define BITTER_IMPLEMENTATION
+//  #include "bitter.h"
+//  int main(int argc, char* argv[])
+//  {
+//      RUN_ALL_TESTS(argc, argv);
+//  };
+
+// ALLOCATIONS
+
+// #define BITTER_TRACK_ALLOCS before including bitter.h in one translation unit to count the allocations of every case.
+// TEST_MAX_ALLOCS(n, expression) fails when the expression allocates more than n times, SetDetectLeaks(true) fails the cases that leak.
+// The sanitizers own the allocator, in their builds the allocations aren't counted and TEST_MAX_ALLOCS is skipped
+
 // When launching the executable you can pass a filename that will be used a log (the path must exist)
 // ~ test.exe testResult.txt
+// The report is buffered and written by a background thread, it's flushed right away after a failure and at the end of the run
+
+// Command line options
+// --jobs=N                Run N test classes concurrently, 0 uses one job per hardware thread
+// --parallel-cases        With --jobs, the cases of classes calling SetRunCasesInParallel(true) are scheduled individually
+// --slowest=N             Number of slowest cases and classes listed at the end of the run, 10 by default and 0 disables it
+// --filter=G              Run only the Class.Case names matching the glob patterns G separated by ':', the patterns after a '-' exclude
+//                         the cases. The classes that can't match are never constructed. --filter=MyClass.*:Other.Fast*-*.Slow*
+// --filter-regex=R        Run only the Class.Case names where the regular expression R is found
+// --junit=F               Stream the results as JUnit XML to the file F
+// --jsonl=F               Stream the results as JSON Lines to the file F
+// --telemetry=F           Publish the progress of the run in the memory mapped file F, bitter::Telemetry::Read(F, snapshot) reads it
+// --bench-baseline=F      Compare the benchmark cases against the baseline file F, a significantly slower median makes the case fail
+// --bench-save[=F]        Write the benchmark measurements to F, by default the baseline file
+// --bench-tolerance=P     Slowdown in percent of the baseline median that is tolerated, 10 by default
+// --bench-significance=A  P-value under which a slowdown of the samples is considered significant, 0.05 by default
+// --timeout=D             Stop the run when a case runs longer than D (500ms, 2s, 1m), TestCase(name, fn, bitter::Timeout{ 2s }) overrides it.
+//                         With --isolate only the worker running the case is stopped
+// --isolate               Run the cases in --jobs forked worker processes, a crash or a timeout fails the case and the worker is replaced
+// --shard-index=I         Run only the shard I of the Class.Case names, from 0 to the shard count - 1. The environment variables
+// --shard-count=N         BITTER_SHARD_INDEX and BITTER_TOTAL_SHARDS or GTEST_SHARD_INDEX and GTEST_TOTAL_SHARDS are also read
+// --shard-balance         Split the shards by the durations of --durations instead of the hash of the names
+// --durations=F           Read the case durations recorded by a previous run from the file F
+// --durations-save[=F]    Write the case durations of this run to F, by default the --durations file
+// --history=F             Read and write the case durations in F, with --jobs or --isolate the longest classes and cases start first
+// --results[=F]           Write the results of the run to F, bitter.results by default
+// --rerun-failed          Run only the cases that failed in the results file of the previous run
+// --seed=S                Seed of the property cases and of --shuffle, the seed printed with a counterexample reproduces it
+// --trials=N              Number of trials of every property case, instead of the SetPropertyTrials of the classes
+// --repeat=N              Soak: run the selected cases N times on --concurrency threads, each with its own instances of the classes
+// --duration=D            Soak: run the selected cases until D elapsed (30s, 5m), combined with --repeat the first limit stops the run
+// --concurrency=K         Threads of a soak run, 1 by default and 0 uses one per hardware thread
+// --shuffle               Shuffle the order of the cases of every soak iteration from the --seed, printed at the end of the run
+// --snapshot-dir=D        Directory of the golden files of TEST_MATCHES_SNAPSHOT, snapshots by default (the path must exist)
+// --update-snapshots      Write the outputs that differ from their golden file over it instead of failing
+// --cache                 Report the recorded results of the classes whose AutomationTester::SetFingerprint didn't change instead of running them
 
 #pragma once
 
+// What the test classes, the assertions and the registration need, a file compiled with BITTER_SPLIT includes nothing else
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The definitions of the framework, the runner and the reporters. With BITTER_SPLIT only the file defining BITTER_IMPLEMENTATION has them,
+// the other files see their declarations
+#if !defined(BITTER_SPLIT) || defined(BITTER_IMPLEMENTATION)
+#define BITTER_HAS_IMPLEMENTATION
+#include <condition_variable>
+#include <csignal>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
-#include <limits>
 #include <map>
+#include <regex>
 #include <sstream>
-#include <string>
-#include <vector>
+#include <unordered_set>
+#endif
+
+#if defined(BITTER_SPLIT)
+#define BITTER_API
+#else
+#define BITTER_API inline
+#endif
 
 #define TEXT_RED "\033[31m"
 #define TEXT_GREEN "\033[32m"
 #define TEXT_WHITE "\033[37m"
 #define ENDLINE static_cast<char>(0x0a)
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BITTER_HAS_FORK
+#endif
+
+#if defined(BITTER_HAS_FORK) && defined(BITTER_HAS_IMPLEMENTATION)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define BITTER_HAS_PERF_EVENTS
+#endif
+
+#if defined(BITTER_HAS_PERF_EVENTS) && defined(BITTER_HAS_IMPLEMENTATION)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// The async test cases are C++20 coroutines, compiled when the compiler supports them
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define BITTER_HAS_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <optional>
+#endif
+#endif
+
+// The sanitizers bring their own operator new and delete, the allocations aren't tracked in their builds
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define BITTER_SANITIZED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define BITTER_SANITIZED
+#endif
+#endif
+
+// The buffer assertions use the widest vector extension enabled at compile time, define BITTER_NO_SIMD to use the scalar loops
+#if defined(BITTER_NO_SIMD) || !defined(BITTER_HAS_IMPLEMENTATION)
+#elif defined(__AVX2__)
+#define BITTER_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BITTER_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define BITTER_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BITTER_NOINLINE __attribute__((noinline, cold))
+#define BITTER_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#elif defined(_MSC_VER)
+#define BITTER_NOINLINE __declspec(noinline)
+#define BITTER_UNLIKELY(condition) (condition)
+#else
+#define BITTER_NOINLINE
+#define BITTER_UNLIKELY(condition) (condition)
+#endif
+
 namespace bitter
 {
 	inline bool
@@ -113,6 +348,511 @@ namespace bitter
 		return (std::abs(a - b) < epsilon);
 	}
 
+	/*Formats the operands of a failed assertion, specialize it for the types that have no operator<<*/
+	template<class T, class = void>
+	struct Formatter
+	{
+		static void Format(std::ostream& out, const T&) { out << "{" << sizeof(T) << " bytes object}"; };
+	};
+
+	template<class T>
+	struct Formatter<T, decltype(void(std::declval<std::ostream&>() << std::declval<const T&>()))>
+	{
+		static void Format(std::ostream& out, const T& value)
+		{
+			if (std::is_floating_point<T>::value)
+			{
+				out.precision(std::numeric_limits<typename std::conditional<std::is_floating_point<T>::value, T, double>::type>::max_digits10);
+			}
+			out << value;
+		};
+	};
+
+	template<class T, class A>
+	struct Formatter<std::vector<T, A>, void>
+	{
+		static void Format(std::ostream& out, const std::vector<T, A>& value)
+		{
+			out << "{";
+			for (size_t i = 0; i < value.size(); i++)
+			{
+				out << (i ? ", " : "");
+				Formatter<T>::Format(out, value[i]);
+			}
+			out << "}";
+		};
+	};
+
+	/*Tuples, as the parameters of Combine, are formatted element by element*/
+	template<class... T>
+	struct Formatter<std::tuple<T...>, void>
+	{
+		static void Format(std::ostream& out, const std::tuple<T...>& value)
+		{
+			out << "(";
+			FormatElements(out, value, std::index_sequence_for<T...>());
+			out << ")";
+		};
+
+		template<size_t... I>
+		static void FormatElements(std::ostream& out, const std::tuple<T...>& value, std::index_sequence<I...>)
+		{
+			const int expand[] = { 0, (out << (I ? ", " : ""), Formatter<T>::Format(out, std::get<I>(value)), 0)... };
+			(void)expand;
+		};
+	};
+
+	/*How two operands are compared: 0 with their own operators, 1 integers of different signedness, 2 floating point*/
+	template<class A, class B>
+	struct __comparisonKind
+		: std::integral_constant<int,
+								 std::is_arithmetic<A>::value && std::is_arithmetic<B>::value && (std::is_floating_point<A>::value || std::is_floating_point<B>::value) ? 2
+								 : std::is_integral<A>::value && std::is_integral<B>::value && !std::is_same<A, bool>::value && !std::is_same<B, bool>::value &&
+										 std::is_signed<A>::value != std::is_signed<B>::value
+									 ? 1
+									 : 0>
+	{
+	};
+
+	template<class T>
+	inline bool __isNegative(const T& value)
+	{
+		return std::is_signed<T>::value && value < T(0);
+	}
+
+	template<class A, class B>
+	inline bool __compareEqual(const A& a, const B& b, std::integral_constant<int, 0>)
+	{
+		return a == b;
+	}
+
+	template<class A, class B>
+	inline bool __compareEqual(const A& a, const B& b, std::integral_constant<int, 1>)
+	{
+		return !__isNegative(a) && !__isNegative(b) && static_cast<uintmax_t>(a) == static_cast<uintmax_t>(b);
+	}
+
+	/*Floating point values are equal within the epsilon of the wider type, the same rule of __floatsAlmostSame and __doublesAlmostSame*/
+	template<class A, class B>
+	inline bool __compareEqual(const A& a, const B& b, std::integral_constant<int, 2>)
+	{
+		using C = typename std::common_type<A, B>::type;
+		return static_cast<C>(a) == static_cast<C>(b) || std::abs(static_cast<C>(a) - static_cast<C>(b)) < std::numeric_limits<C>::epsilon();
+	}
+
+	template<class A, class B>
+	inline bool __compareEqual(const A& a, const B& b)
+	{
+		return __compareEqual(a, b, __comparisonKind<A, B>());
+	}
+
+	template<class A, class B, int K>
+	inline bool __compareLess(const A& a, const B& b, std::integral_constant<int, K>)
+	{
+		return a < b;
+	}
+
+	template<class A, class B>
+	inline bool __compareLess(const A& a, const B& b, std::integral_constant<int, 1>)
+	{
+		if (__isNegative(a) || __isNegative(b))
+		{
+			return __isNegative(a) && !__isNegative(b);
+		}
+		return static_cast<uintmax_t>(a) < static_cast<uintmax_t>(b);
+	}
+
+	template<class A, class B>
+	inline bool __compareLess(const A& a, const B& b)
+	{
+		return __compareLess(a, b, __comparisonKind<A, B>());
+	}
+
+	template<class A, class B, class T>
+	inline bool __compareNear(const A& value, const B& expected, const T& tolerance, std::integral_constant<int, 0>)
+	{
+		const auto distance = value > expected ? value - expected : expected - value;
+		return distance <= tolerance;
+	}
+
+	/*The distance of integers of different signedness is exact in uintmax_t, the subtraction wraps around to the difference*/
+	template<class A, class B, class T>
+	inline bool __compareNear(const A& value, const B& expected, const T& tolerance, std::integral_constant<int, 1>)
+	{
+		const uintmax_t distance = __compareLess(value, expected) ? static_cast<uintmax_t>(expected) - static_cast<uintmax_t>(value)
+																   : static_cast<uintmax_t>(value) - static_cast<uintmax_t>(expected);
+		return !__compareLess(tolerance, distance);
+	}
+
+	template<class A, class B, class T>
+	inline bool __compareNear(const A& value, const B& expected, const T& tolerance, std::integral_constant<int, 2>)
+	{
+		using C          = typename std::common_type<A, B>::type;
+		const C distance = std::abs(static_cast<C>(value) - static_cast<C>(expected));
+		return distance <= tolerance;
+	}
+
+	/*True if value is at most tolerance away from expected, NaN is never near*/
+	template<class A, class B, class T>
+	inline bool __compareNear(const A& value, const B& expected, const T& tolerance)
+	{
+		return __compareNear(value, expected, tolerance, __comparisonKind<A, B>());
+	}
+
+	/*Tolerance of TEST_ARRAY_NEAR in units in the last place, the number of representable values between two floats*/
+	struct Ulps
+	{
+		explicit Ulps(uint32_t count) : Count(count){};
+		uint32_t Count;
+	};
+
+	/*Result of CompareBuffers and CompareArraysNear, MaxError is the largest difference found in value or in ulps, ignoring NaN*/
+	struct DBufferComparison
+	{
+		static constexpr size_t NoMismatch = static_cast<size_t>(-1);
+
+		size_t FirstMismatch{ NoMismatch };
+		size_t NumMismatches{};
+		double MaxError{};
+		bool   ErrorInUlps{};
+
+		inline bool Matches() const { return NumMismatches == 0; };
+	};
+
+	template<class T>
+	inline typename std::enable_if<std::is_arithmetic<T>::value, double>::type __elementError(const T& a, const T& b)
+	{
+		return a > b ? static_cast<double>(a - b) : static_cast<double>(b - a);
+	}
+
+	template<class T>
+	inline typename std::enable_if<!std::is_arithmetic<T>::value, double>::type __elementError(const T&, const T&)
+	{
+		return 0.;
+	}
+
+	/*Compare the bytes of count elements, the blocks are compared with memcmp and only a block that differs is walked element by element*/
+	template<class T>
+	inline DBufferComparison CompareBuffers(const T* a, const T* b, size_t count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "the elements are compared by their bytes");
+		DBufferComparison result;
+		const size_t      blockSize = std::max<size_t>(1, 4096 / sizeof(T));
+		for (size_t begin = 0; begin < count; begin += blockSize)
+		{
+			const size_t end = std::min(count, begin + blockSize);
+			if (std::memcmp(a + begin, b + begin, (end - begin) * sizeof(T)) == 0)
+			{
+				continue;
+			}
+			for (size_t i = begin; i < end; i++)
+			{
+				if (std::memcmp(a + i, b + i, sizeof(T)) != 0)
+				{
+					result.FirstMismatch = result.NumMismatches++ == 0 ? i : result.FirstMismatch;
+					result.MaxError      = std::max(result.MaxError, __elementError(a[i], b[i]));
+				}
+			}
+		}
+		return result;
+	}
+
+	inline DBufferComparison CompareBuffers(const void* a, const void* b, size_t size) { return CompareBuffers(static_cast<const uint8_t*>(a), static_cast<const uint8_t*>(b), size); }
+
+	/*Integers are printed as numbers, even the char types*/
+	template<class T>
+	inline auto __printable(const T& value) -> typename std::enable_if<std::is_arithmetic<T>::value, decltype(+value)>::type
+	{
+		return +value;
+	}
+
+	template<class T>
+	inline typename std::enable_if<!std::is_arithmetic<T>::value, const T&>::type __printable(const T& value)
+	{
+		return value;
+	}
+
+	/*Element by element reference of the vector kernels: a and b match when they are equal or at most tolerance apart*/
+	template<class T>
+	inline void __compareNearScalar(const T* a, const T* b, size_t begin, size_t end, T tolerance, DBufferComparison& result)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const T error = std::fabs(a[i] - b[i]);
+			if (!(error <= tolerance) && !(a[i] == b[i]))
+			{
+				result.FirstMismatch = result.NumMismatches++ == 0 ? i : result.FirstMismatch;
+			}
+			if (error == error)
+			{
+				result.MaxError = std::max(result.MaxError, static_cast<double>(error));
+			}
+		}
+	}
+
+	/*Integer with the bits of a float or a double*/
+	template<class T>
+	using __floatBits = typename std::conditional<sizeof(T) == 4, int32_t, int64_t>::type;
+
+	/*Floats with the same sign are as many ulps apart as the difference of their bits, with different signs it's the sum of their magnitudes*/
+	template<class T>
+	inline void __compareNearScalar(const T* a, const T* b, size_t begin, size_t end, Ulps tolerance, DBufferComparison& result)
+	{
+		using Bits = __floatBits<T>;
+		using Unsigned = typename std::make_unsigned<Bits>::type;
+		const Unsigned magnitude = static_cast<Unsigned>(std::numeric_limits<Bits>::max());
+		for (size_t i = begin; i < end; i++)
+		{
+			Bits x, y;
+			std::memcpy(&x, a + i, sizeof(T));
+			std::memcpy(&y, b + i, sizeof(T));
+			const bool     ordered  = a[i] == a[i] && b[i] == b[i];
+			const bool     sameSign = (x < 0) == (y < 0);
+			const Unsigned distance = sameSign ? (x > y ? static_cast<Unsigned>(x) - static_cast<Unsigned>(y) : static_cast<Unsigned>(y) - static_cast<Unsigned>(x))
+											   : (static_cast<Unsigned>(x) & magnitude) + (static_cast<Unsigned>(y) & magnitude);
+			if (!(a[i] == b[i]) && !(ordered && sameSign && distance <= tolerance.Count))
+			{
+				result.FirstMismatch = result.NumMismatches++ == 0 ? i : result.FirstMismatch;
+			}
+			if (ordered && !(a[i] == b[i]))
+			{
+				result.MaxError = std::max(result.MaxError, static_cast<double>(distance));
+			}
+		}
+	}
+
+	/*Compare count floating point values within an absolute tolerance or within a number of Ulps, equal values always match and NaN never does*/
+	BITTER_API DBufferComparison CompareArraysNear(const float* a, const float* b, size_t count, double tolerance);
+	BITTER_API DBufferComparison CompareArraysNear(const float* a, const float* b, size_t count, Ulps tolerance);
+	BITTER_API DBufferComparison CompareArraysNear(const double* a, const double* b, size_t count, double tolerance);
+	BITTER_API DBufferComparison CompareArraysNear(const double* a, const double* b, size_t count, Ulps tolerance);
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+#if defined(BITTER_SIMD_AVX2)
+	/*The lanes of a kernel: Within returns true when every lane matches and sets error to the differences of the lanes, 0 where they match
+	exactly or not at all*/
+	struct __simdFloats
+	{
+		using Vector                 = __m256;
+		static constexpr size_t Width = 8;
+
+		static inline Vector Zero() { return _mm256_setzero_ps(); };
+		static inline Vector Max(Vector a, Vector b) { return _mm256_max_ps(a, b); };
+
+		static inline bool Within(const float* a, const float* b, float tolerance, Vector& error)
+		{
+			const Vector x    = _mm256_loadu_ps(a);
+			const Vector y    = _mm256_loadu_ps(b);
+			const Vector diff = _mm256_andnot_ps(_mm256_set1_ps(-0.f), _mm256_sub_ps(x, y));
+			const Vector near = _mm256_cmp_ps(diff, _mm256_set1_ps(tolerance), _CMP_LE_OQ);
+			error             = _mm256_and_ps(near, diff);
+			return _mm256_movemask_ps(_mm256_or_ps(near, _mm256_cmp_ps(x, y, _CMP_EQ_OQ))) == 0xFF;
+		};
+
+		static inline bool Within(const float* a, const float* b, Ulps tolerance, Vector& error)
+		{
+			const Vector  x        = _mm256_loadu_ps(a);
+			const Vector  y        = _mm256_loadu_ps(b);
+			const __m256i ix       = _mm256_castps_si256(x);
+			const __m256i iy       = _mm256_castps_si256(y);
+			const __m256i distance = _mm256_abs_epi32(_mm256_sub_epi32(ix, iy));
+			const __m256i sameSign = _mm256_cmpgt_epi32(_mm256_xor_si256(ix, iy), _mm256_set1_epi32(-1));
+			const __m256i far      = _mm256_cmpgt_epi32(distance, _mm256_set1_epi32(static_cast<int32_t>(std::min<uint32_t>(tolerance.Count, 0x7FFFFFFF))));
+			const Vector  near = _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_ORD_Q), _mm256_castsi256_ps(_mm256_andnot_si256(far, sameSign)));
+			error              = _mm256_and_ps(near, _mm256_cvtepi32_ps(distance));
+			return _mm256_movemask_ps(_mm256_or_ps(near, _mm256_cmp_ps(x, y, _CMP_EQ_OQ))) == 0xFF;
+		};
+	};
+
+	struct __simdDoubles
+	{
+		using Vector                 = __m256d;
+		static constexpr size_t Width = 4;
+
+		static inline Vector Zero() { return _mm256_setzero_pd(); };
+		static inline Vector Max(Vector a, Vector b) { return _mm256_max_pd(a, b); };
+
+		static inline bool Within(const double* a, const double* b, double tolerance, Vector& error)
+		{
+			const Vector x    = _mm256_loadu_pd(a);
+			const Vector y    = _mm256_loadu_pd(b);
+			const Vector diff = _mm256_andnot_pd(_mm256_set1_pd(-0.), _mm256_sub_pd(x, y));
+			const Vector near = _mm256_cmp_pd(diff, _mm256_set1_pd(tolerance), _CMP_LE_OQ);
+			error             = _mm256_and_pd(near, diff);
+			return _mm256_movemask_pd(_mm256_or_pd(near, _mm256_cmp_pd(x, y, _CMP_EQ_OQ))) == 0xF;
+		};
+	};
+#elif defined(BITTER_SIMD_SSE2)
+	/*The lanes of a kernel: Within returns true when every lane matches and sets error to the differences of the lanes, 0 where they match
+	exactly or not at all*/
+	struct __simdFloats
+	{
+		using Vector                 = __m128;
+		static constexpr size_t Width = 4;
+
+		static inline Vector Zero() { return _mm_setzero_ps(); };
+		static inline Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); };
+
+		static inline bool Within(const float* a, const float* b, float tolerance, Vector& error)
+		{
+			const Vector x    = _mm_loadu_ps(a);
+			const Vector y    = _mm_loadu_ps(b);
+			const Vector diff = _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_sub_ps(x, y));
+			const Vector near = _mm_cmple_ps(diff, _mm_set1_ps(tolerance));
+			error             = _mm_and_ps(near, diff);
+			return _mm_movemask_ps(_mm_or_ps(near, _mm_cmpeq_ps(x, y))) == 0xF;
+		};
+
+		static inline bool Within(const float* a, const float* b, Ulps tolerance, Vector& error)
+		{
+			const Vector  x        = _mm_loadu_ps(a);
+			const Vector  y        = _mm_loadu_ps(b);
+			const __m128i ix       = _mm_castps_si128(x);
+			const __m128i iy       = _mm_castps_si128(y);
+			const __m128i diff     = _mm_sub_epi32(ix, iy);
+			const __m128i sign     = _mm_srai_epi32(diff, 31);
+			const __m128i distance = _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+			const __m128i sameSign = _mm_cmpgt_epi32(_mm_xor_si128(ix, iy), _mm_set1_epi32(-1));
+			const __m128i far      = _mm_cmpgt_epi32(distance, _mm_set1_epi32(static_cast<int32_t>(std::min<uint32_t>(tolerance.Count, 0x7FFFFFFF))));
+			const Vector  near     = _mm_and_ps(_mm_cmpord_ps(x, y), _mm_castsi128_ps(_mm_andnot_si128(far, sameSign)));
+			error                  = _mm_and_ps(near, _mm_cvtepi32_ps(distance));
+			return _mm_movemask_ps(_mm_or_ps(near, _mm_cmpeq_ps(x, y))) == 0xF;
+		};
+	};
+
+	struct __simdDoubles
+	{
+		using Vector                 = __m128d;
+		static constexpr size_t Width = 2;
+
+		static inline Vector Zero() { return _mm_setzero_pd(); };
+		static inline Vector Max(Vector a, Vector b) { return _mm_max_pd(a, b); };
+
+		static inline bool Within(const double* a, const double* b, double tolerance, Vector& error)
+		{
+			const Vector x    = _mm_loadu_pd(a);
+			const Vector y    = _mm_loadu_pd(b);
+			const Vector diff = _mm_andnot_pd(_mm_set1_pd(-0.), _mm_sub_pd(x, y));
+			const Vector near = _mm_cmple_pd(diff, _mm_set1_pd(tolerance));
+			error             = _mm_and_pd(near, diff);
+			return _mm_movemask_pd(_mm_or_pd(near, _mm_cmpeq_pd(x, y))) == 0x3;
+		};
+	};
+#elif defined(BITTER_SIMD_NEON)
+	/*The lanes of a kernel: Within returns true when every lane matches and sets error to the differences of the lanes, 0 where they match
+	exactly or not at all*/
+	struct __simdFloats
+	{
+		using Vector                 = float32x4_t;
+		static constexpr size_t Width = 4;
+
+		static inline Vector Zero() { return vdupq_n_f32(0.f); };
+		static inline Vector Max(Vector a, Vector b) { return vmaxq_f32(a, b); };
+
+		static inline bool AllSet(uint32x4_t mask)
+		{
+			const uint32x2_t half = vand_u32(vget_low_u32(mask), vget_high_u32(mask));
+			return (vget_lane_u32(half, 0) & vget_lane_u32(half, 1)) == 0xFFFFFFFFu;
+		};
+
+		static inline bool Within(const float* a, const float* b, float tolerance, Vector& error)
+		{
+			const Vector     x    = vld1q_f32(a);
+			const Vector     y    = vld1q_f32(b);
+			const Vector     diff = vabdq_f32(x, y);
+			const uint32x4_t near = vcleq_f32(diff, vdupq_n_f32(tolerance));
+			error                 = vreinterpretq_f32_u32(vandq_u32(near, vreinterpretq_u32_f32(diff)));
+			return AllSet(vorrq_u32(near, vceqq_f32(x, y)));
+		};
+
+		static inline bool Within(const float* a, const float* b, Ulps tolerance, Vector& error)
+		{
+			const Vector     x        = vld1q_f32(a);
+			const Vector     y        = vld1q_f32(b);
+			const int32x4_t  ix       = vreinterpretq_s32_f32(x);
+			const int32x4_t  iy       = vreinterpretq_s32_f32(y);
+			const uint32x4_t distance = vreinterpretq_u32_s32(vabdq_s32(ix, iy));
+			const uint32x4_t sameSign = vcgeq_s32(veorq_s32(ix, iy), vdupq_n_s32(0));
+			const uint32x4_t ordered  = vandq_u32(vceqq_f32(x, x), vceqq_f32(y, y));
+			const uint32x4_t near     = vandq_u32(vandq_u32(ordered, sameSign), vcleq_u32(distance, vdupq_n_u32(tolerance.Count)));
+			error                     = vreinterpretq_f32_u32(vandq_u32(near, vreinterpretq_u32_f32(vcvtq_f32_u32(distance))));
+			return AllSet(vorrq_u32(near, vceqq_f32(x, y)));
+		};
+	};
+#endif
+
+	/*Run the vector kernel over the full blocks, a block with a mismatch and the tail go through the scalar comparison so the first mismatch
+	and the count are exact. The lanes have the same rule of __compareNearScalar*/
+	template<class Simd, class T, class Tolerance>
+	inline void __compareNearSimd(const T* a, const T* b, size_t count, Tolerance tolerance, DBufferComparison& result)
+	{
+		typename Simd::Vector maxError = Simd::Zero();
+		size_t                i        = 0;
+		for (; i + Simd::Width <= count; i += Simd::Width)
+		{
+			typename Simd::Vector error;
+			const bool            matched = Simd::Within(a + i, b + i, tolerance, error);
+			maxError                      = Simd::Max(maxError, error);
+			if (BITTER_UNLIKELY(!matched))
+			{
+				__compareNearScalar(a, b, i, i + Simd::Width, tolerance, result);
+			}
+		}
+		T lanes[Simd::Width];
+		std::memcpy(lanes, &maxError, sizeof(lanes));
+		for (const T lane : lanes)
+		{
+			result.MaxError = std::max(result.MaxError, static_cast<double>(lane));
+		}
+		__compareNearScalar(a, b, i, count, tolerance, result);
+	}
+
+	/*Floats within Ulps are compared by their bits, the vector kernels need no conversion*/
+	template<class Tolerance>
+	inline DBufferComparison __compareFloatsNear(const float* a, const float* b, size_t count, Tolerance tolerance)
+	{
+		DBufferComparison result;
+#if defined(BITTER_SIMD_AVX2) || defined(BITTER_SIMD_SSE2) || defined(BITTER_SIMD_NEON)
+		__compareNearSimd<__simdFloats>(a, b, count, tolerance, result);
+#else
+		__compareNearScalar(a, b, 0, count, tolerance, result);
+#endif
+		return result;
+	}
+
+	BITTER_API DBufferComparison CompareArraysNear(const float* a, const float* b, size_t count, double tolerance)
+	{
+		return __compareFloatsNear(a, b, count, static_cast<float>(tolerance));
+	}
+
+	BITTER_API DBufferComparison CompareArraysNear(const float* a, const float* b, size_t count, Ulps tolerance)
+	{
+		DBufferComparison result = __compareFloatsNear(a, b, count, tolerance);
+		result.ErrorInUlps       = true;
+		return result;
+	}
+
+	/*Doubles within Ulps are compared by the scalar loop, a 64 bits distance has no cheap lanes on SSE2*/
+	BITTER_API DBufferComparison CompareArraysNear(const double* a, const double* b, size_t count, double tolerance)
+	{
+		DBufferComparison result;
+#if defined(BITTER_SIMD_AVX2) || defined(BITTER_SIMD_SSE2)
+		__compareNearSimd<__simdDoubles>(a, b, count, tolerance, result);
+#else
+		__compareNearScalar(a, b, 0, count, tolerance, result);
+#endif
+		return result;
+	}
+
+	BITTER_API DBufferComparison CompareArraysNear(const double* a, const double* b, size_t count, Ulps tolerance)
+	{
+		DBufferComparison result;
+		result.ErrorInUlps = true;
+		__compareNearScalar(a, b, 0, count, tolerance, result);
+		return result;
+	}
+#endif
+
 	/*Defines the current status of a given test case*/
 	enum class ETestStatus
 	{
@@ -121,350 +861,7622 @@ namespace bitter
 		FAILED
 	};
 
-	/*Wraps a functions the will execute a test case*/
-	struct DTestCase
+	/*Tuning of a benchmark case*/
+	struct DBenchmarkOptions
 	{
-	public:
-		DTestCase(const std::string& name, std::function<void(void)> testFunction) : Name(name.c_str()), Func(testFunction) {};
-		inline void               DoWork() const { Func(); };
-		std::string               Name;
-		std::function<void(void)> Func;
+		std::chrono::nanoseconds WarmupTime{ std::chrono::milliseconds(20) };
+		std::chrono::nanoseconds SampleTime{ std::chrono::milliseconds(2) };
+		unsigned int             NumSamples{ 50 };
+		bool                     HardwareCounters{ true }; // Read the hardware counters of the samples where perf_event_open is available
 	};
 
-	/*This is the class responsible of defining a group of test cases*/
-	class AutomatedTestInstance
+	/*Hardware counters per iteration of a benchmark case, a counter the machine or its permissions don't provide is negative*/
+	struct DHardwareCounters
+	{
+		double Cycles{ -1. };
+		double Instructions{ -1. };
+		double CacheMisses{ -1. };
+		double BranchMisses{ -1. };
+
+		inline bool HasAny() const { return Cycles >= 0. || Instructions >= 0. || CacheMisses >= 0. || BranchMisses >= 0.; };
+	};
+
+	/*Measurements of a benchmark case, all the times are nanoseconds per iteration*/
+	struct DBenchmarkResult
+	{
+		uint64_t            Iterations{}; // Iterations of each sample
+		std::vector<double> Samples;
+		double              Min{};
+		double              Median{};
+		double              P99{};
+		double              Mean{};
+		double              StdDev{};
+		DHardwareCounters   Counters;
+	};
+
+	/*Make the compiler believe the value is read, so the computation producing it can't be optimized away*/
+	template<class T>
+	inline void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		const volatile char* bytes = reinterpret_cast<const volatile char*>(&value);
+		(void)*bytes;
+		_ReadWriteBarrier();
+#endif
+	}
+
+	/*Make the compiler believe all the memory is read and written, pending stores can't be optimized away*/
+	inline void ClobberMemory()
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : : "memory");
+#else
+		_ReadWriteBarrier();
+#endif
+	}
+
+	template<class F>
+	inline std::chrono::nanoseconds __runBenchmarkBatch(F& benchmarkFunc, uint64_t iterations)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			benchmarkFunc();
+		}
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	}
+
+	/*Cycles, instructions, cache misses and branch misses of the calling thread in user space, opened as one perf_event group so they are
+	read together. A counter that can't be opened is left out of the group, without perf_event_open none is open*/
+	class HardwareCounterGroup
 	{
 	public:
-		AutomatedTestInstance() = default;
-		virtual ~AutomatedTestInstance() = default;
+		static constexpr size_t NumCounters = 4;
 
-		/*Resets it's internal state*/
-		inline void ResetFlags()
+		/*Raw counts in the order of DHardwareCounters with the time the group was enabled and running, they differ when the kernel multiplexed it*/
+		struct DReading
+		{
+			uint64_t Enabled;
+			uint64_t Running;
+			uint64_t Values[NumCounters];
+		};
+
+		explicit HardwareCounterGroup(bool open);
+
+		~HardwareCounterGroup() { Close(); };
+
+		HardwareCounterGroup(const HardwareCounterGroup&)            = delete;
+		HardwareCounterGroup& operator=(const HardwareCounterGroup&) = delete;
+
+		inline bool IsOpen() const { return _leader >= 0; };
+
+		/*Read every counter of the group at once with a single system call*/
+		bool Read(DReading& reading) const;
+
+		/*Per iteration counters from the sum of the differences between the readings around the samples*/
+		DHardwareCounters PerIteration(const double (&totals)[NumCounters], uint64_t iterations) const;
+
+		/*Add the counts between two readings, scaled up when the group was not running the whole time*/
+		static void Accumulate(const DReading& before, const DReading& after, double (&totals)[NumCounters]);
+
+	private:
+		int    _leader{ -1 };
+		int    _fds[NumCounters]{};
+		size_t _counters[NumCounters]{}; // Index in DHardwareCounters of every open descriptor
+		size_t _numOpen{};
+
+		void Close();
+	};
+
+	BITTER_API void __computeBenchmarkStatistics(DBenchmarkResult& result);
+
+	/*One sided Mann-Whitney U test, returns the probability of observing samples at least this much greater than the baseline by chance*/
+	BITTER_API double __mannWhitneyGreater(const std::vector<double>& samples, const std::vector<double>& baseline);
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	BITTER_API HardwareCounterGroup::HardwareCounterGroup(bool open)
+	{
+#if defined(BITTER_HAS_PERF_EVENTS)
+		const uint64_t configs[NumCounters] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+		for (size_t i = 0; open && i < NumCounters; i++)
+		{
+			perf_event_attr attr{};
+			attr.type           = PERF_TYPE_HARDWARE;
+			attr.size           = sizeof(attr);
+			attr.config         = configs[i];
+			attr.disabled       = _leader < 0 ? 1 : 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv     = 1;
+			attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			const int fd        = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, _leader, 0));
+			if (fd < 0)
+			{
+				continue;
+			}
+			_leader               = _leader < 0 ? fd : _leader;
+			_fds[_numOpen]        = fd;
+			_counters[_numOpen++] = i;
+		}
+		if (_leader >= 0 && ::ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+		{
+			Close();
+		}
+#else
+		(void)open;
+#endif
+	}
+
+	BITTER_API bool HardwareCounterGroup::Read(DReading& reading) const
+	{
+		reading = DReading{};
+#if defined(BITTER_HAS_PERF_EVENTS)
+		struct
+		{
+			uint64_t Count;
+			uint64_t Enabled;
+			uint64_t Running;
+			uint64_t Values[NumCounters];
+		} buffer;
+		const ssize_t expected = static_cast<ssize_t>(sizeof(uint64_t) * (3 + _numOpen));
+		if (_leader < 0 || ::read(_leader, &buffer, sizeof(buffer)) < expected)
+		{
+			return false;
+		}
+		reading.Enabled = buffer.Enabled;
+		reading.Running = buffer.Running;
+		for (size_t i = 0; i < _numOpen && i < buffer.Count; i++)
+		{
+			reading.Values[_counters[i]] = buffer.Values[i];
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	BITTER_API DHardwareCounters HardwareCounterGroup::PerIteration(const double (&totals)[NumCounters], uint64_t iterations) const
+	{
+		DHardwareCounters counters;
+		double*           values[NumCounters] = { &counters.Cycles, &counters.Instructions, &counters.CacheMisses, &counters.BranchMisses };
+		for (size_t i = 0; i < _numOpen && iterations > 0; i++)
+		{
+			*values[_counters[i]] = totals[_counters[i]] / static_cast<double>(iterations);
+		}
+		return counters;
+	}
+
+	BITTER_API void HardwareCounterGroup::Accumulate(const DReading& before, const DReading& after, double (&totals)[NumCounters])
+	{
+		const uint64_t running = after.Running - before.Running;
+		const double   scale   = running > 0 ? static_cast<double>(after.Enabled - before.Enabled) / static_cast<double>(running) : 0.;
+		for (size_t i = 0; i < NumCounters; i++)
+		{
+			totals[i] += static_cast<double>(after.Values[i] - before.Values[i]) * scale;
+		}
+	}
+
+	BITTER_API void HardwareCounterGroup::Close()
+	{
+#if defined(BITTER_HAS_PERF_EVENTS)
+		while (_numOpen > 0)
+		{
+			::close(_fds[--_numOpen]);
+		}
+#endif
+		_leader = -1;
+	}
+
+	BITTER_API void __computeBenchmarkStatistics(DBenchmarkResult& result)
+	{
+		if (result.Samples.empty())
+		{
+			return;
+		}
+		std::vector<double> sorted(result.Samples);
+		std::sort(sorted.begin(), sorted.end());
+		const size_t count = sorted.size();
+		result.Min         = sorted.front();
+		result.Median      = count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2.;
+		result.P99         = sorted[static_cast<size_t>(std::ceil(0.99 * static_cast<double>(count))) - 1];
+
+		double sum{};
+		for (const double sample : sorted)
+		{
+			sum += sample;
+		}
+		result.Mean = sum / static_cast<double>(count);
+
+		double squares{};
+		for (const double sample : sorted)
+		{
+			squares += (sample - result.Mean) * (sample - result.Mean);
+		}
+		result.StdDev = count > 1 ? std::sqrt(squares / static_cast<double>(count - 1)) : 0.;
+	}
+
+	BITTER_API double __mannWhitneyGreater(const std::vector<double>& samples, const std::vector<double>& baseline)
+	{
+		const size_t n1 = samples.size();
+		const size_t n2 = baseline.size();
+		if (n1 == 0 || n2 == 0)
+		{
+			return 1.;
+		}
+
+		std::vector<std::pair<double, bool>> values; // value, belongs to samples
+		values.reserve(n1 + n2);
+		for (const double value : samples)
+		{
+			values.emplace_back(value, true);
+		}
+		for (const double value : baseline)
+		{
+			values.emplace_back(value, false);
+		}
+		std::sort(values.begin(), values.end(), [](const std::pair<double, bool>& a, const std::pair<double, bool>& b) { return a.first < b.first; });
+
+		// Sum of the ranks of the samples, ties get the average rank
+		double rankSum{};
+		double tieCorrection{};
+		for (size_t i = 0; i < values.size();)
+		{
+			size_t j = i;
+			while (j < values.size() && values[j].first == values[i].first)
+			{
+				j++;
+			}
+			const double ties    = static_cast<double>(j - i);
+			const double rank    = (static_cast<double>(i + j) + 1.) / 2.;
+			tieCorrection       += ties * ties * ties - ties;
+			for (size_t k = i; k < j; k++)
+			{
+				rankSum += values[k].second ? rank : 0.;
+			}
+			i = j;
+		}
+
+		const double a     = static_cast<double>(n1);
+		const double b     = static_cast<double>(n2);
+		const double u     = rankSum - a * (a + 1.) / 2.;
+		const double mean  = a * b / 2.;
+		const double total = a + b;
+		const double sigma = std::sqrt(a * b / 12. * ((total + 1.) - tieCorrection / (total * (total - 1.))));
+		if (sigma <= 0.)
+		{
+			return u > mean ? 0. : 1.;
+		}
+		const double z = (u - mean - 0.5) / sigma; // continuity correction
+		return 0.5 * std::erfc(z / std::sqrt(2.));
+	}
+#endif
+
+	/*Warmup, calibrate the number of iterations so a sample lasts at least SampleTime and then collect the samples.
+	Stops early when shouldStop returns true*/
+	template<class F, class S>
+	inline DBenchmarkResult __measureBenchmark(F& benchmarkFunc, const DBenchmarkOptions& options, S shouldStop)
+	{
+		DBenchmarkResult result;
+
+		uint64_t   iterations = 1;
+		const auto warmupEnd  = std::chrono::steady_clock::now() + options.WarmupTime;
+		while (std::chrono::steady_clock::now() < warmupEnd && !shouldStop())
+		{
+			__runBenchmarkBatch(benchmarkFunc, iterations);
+			iterations = std::min<uint64_t>(iterations * 2, 1 << 20);
+		}
+
+		iterations = 1;
+		for (;;)
+		{
+			const auto elapsed = __runBenchmarkBatch(benchmarkFunc, iterations);
+			if (elapsed >= options.SampleTime || iterations >= (uint64_t(1) << 40) || shouldStop())
+			{
+				break;
+			}
+			const double ratio = elapsed.count() > 0 ? 1.2 * static_cast<double>(options.SampleTime.count()) / static_cast<double>(elapsed.count()) : 10.;
+			iterations         = std::max(iterations + 1, static_cast<uint64_t>(static_cast<double>(iterations) * std::min(ratio, 10.)));
+		}
+
+		result.Iterations = iterations;
+		result.Samples.reserve(options.NumSamples);
+		// the counters are read outside of the timed batches
+		const HardwareCounterGroup counters(options.HardwareCounters);
+		double                     totals[HardwareCounterGroup::NumCounters]{};
+		bool                       counted = counters.IsOpen();
+		for (unsigned int i = 0; i < options.NumSamples && !shouldStop(); i++)
+		{
+			HardwareCounterGroup::DReading before;
+			counted            = counted && counters.Read(before);
+			const auto elapsed = __runBenchmarkBatch(benchmarkFunc, iterations);
+			HardwareCounterGroup::DReading after;
+			counted = counted && counters.Read(after);
+			if (counted)
+			{
+				HardwareCounterGroup::Accumulate(before, after, totals);
+			}
+			result.Samples.push_back(static_cast<double>(elapsed.count()) / static_cast<double>(iterations));
+		}
+		if (counted)
+		{
+			result.Counters = counters.PerIteration(totals, iterations * result.Samples.size());
+		}
+		__computeBenchmarkStatistics(result);
+		return result;
+	}
+
+	/*Type erased void() callable, stored inline when it fits in Capacity bytes and can be moved without throwing, otherwise on the heap.
+	Unlike std::function it's move only, so capturing non copyable state is fine*/
+	class InlineFunction
+	{
+	public:
+		static constexpr size_t Capacity = 48;
+
+		InlineFunction() = default;
+
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+		InlineFunction(F&& function)
+		{
+			using Stored = typename std::decay<F>::type;
+			Emplace<Stored>(std::forward<F>(function), std::integral_constant<bool, IsStoredInline<Stored>()>());
+		};
+
+		InlineFunction(InlineFunction&& other) noexcept { MoveFrom(other); };
+
+		InlineFunction& operator=(InlineFunction&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				MoveFrom(other);
+			}
+			return *this;
+		};
+
+		InlineFunction(const InlineFunction&)            = delete;
+		InlineFunction& operator=(const InlineFunction&) = delete;
+
+		~InlineFunction() { Reset(); };
+
+		inline void operator()() const { _ops->Invoke(_storage); };
+
+		inline explicit operator bool() const { return _ops != nullptr; };
+
+		/*True if the callable lives in the inline buffer*/
+		inline bool IsInline() const { return _ops != nullptr && _ops->Inline; };
+
+		template<class T>
+		static constexpr bool IsStoredInline()
+		{
+			return sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<T>::value;
+		};
+
+	private:
+		struct DOperations
+		{
+			void (*Invoke)(void* storage);
+			void (*Move)(void* from, void* to);
+			void (*Destroy)(void* storage);
+			bool Inline;
+		};
+
+		template<class T>
+		struct InlineOperations
+		{
+			static void              Invoke(void* storage) { (*static_cast<T*>(storage))(); };
+			static void              Move(void* from, void* to)
+			{
+				new (to) T(std::move(*static_cast<T*>(from)));
+				static_cast<T*>(from)->~T();
+			};
+			static void              Destroy(void* storage) { static_cast<T*>(storage)->~T(); };
+			static const DOperations Table;
+		};
+
+		template<class T>
+		struct HeapOperations
+		{
+			static void              Invoke(void* storage) { (**static_cast<T**>(storage))(); };
+			static void              Move(void* from, void* to) { *static_cast<T**>(to) = *static_cast<T**>(from); };
+			static void              Destroy(void* storage) { delete *static_cast<T**>(storage); };
+			static const DOperations Table;
+		};
+
+		template<class T, class F>
+		inline void Emplace(F&& function, std::true_type)
+		{
+			new (_storage) T(std::forward<F>(function));
+			_ops = &InlineOperations<T>::Table;
+		};
+
+		template<class T, class F>
+		inline void Emplace(F&& function, std::false_type)
+		{
+			*reinterpret_cast<T**>(_storage) = new T(std::forward<F>(function));
+			_ops = &HeapOperations<T>::Table;
+		};
+
+		inline void MoveFrom(InlineFunction& other) noexcept
+		{
+			if (other._ops)
+			{
+				other._ops->Move(other._storage, _storage);
+				_ops       = other._ops;
+				other._ops = nullptr;
+			}
+		};
+
+		inline void Reset() noexcept
+		{
+			if (_ops)
+			{
+				_ops->Destroy(_storage);
+				_ops = nullptr;
+			}
+		};
+
+		alignas(std::max_align_t) mutable unsigned char _storage[Capacity];
+		const DOperations*                              _ops{};
+	};
+
+	template<class T>
+	const InlineFunction::DOperations InlineFunction::InlineOperations<T>::Table = { &Invoke, &Move, &Destroy, true };
+
+	template<class T>
+	const InlineFunction::DOperations InlineFunction::HeapOperations<T>::Table = { &Invoke, &Move, &Destroy, false };
+
+	/*Append only storage for strings, they are copied into big chunks that never move so the returned pointers stay valid
+	for the lifetime of the arena. Storing a string allocates only when a new chunk is needed*/
+	class StringArena
+	{
+	public:
+		static constexpr size_t ChunkSize = 16 * 1024;
+
+		/*Copy size chars into the arena and return a null terminated copy*/
+		inline const char* Store(const char* data, size_t size)
+		{
+			const size_t required = size + 1;
+			if (required > _available)
+			{
+				const size_t chunkSize = std::max(ChunkSize, required);
+				_chunks.emplace_back(new char[chunkSize]);
+				_next      = _chunks.back().get();
+				_available = chunkSize;
+			}
+			char* stored = _next;
+			std::memcpy(stored, data, size);
+			stored[size] = '\0';
+			_next += required;
+			_available -= required;
+			return stored;
+		};
+
+		/*Number of chunks allocated so far*/
+		inline size_t GetNumChunks() const { return _chunks.size(); };
+
+	private:
+		std::vector<std::unique_ptr<char[]>> _chunks;
+		char*                                _next{};
+		size_t                               _available{};
+	};
+
+	/*FNV-1a hash of a string, pass the hash of a previous string to hash their concatenation*/
+	inline uint64_t __hashString(const char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	class MappedFile;
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	/*Read only view of a whole file, mapped in memory where mmap exists and read in a buffer elsewhere*/
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& filename)
+		{
+#if defined(BITTER_HAS_FORK)
+			const int fd = open(filename.c_str(), O_RDONLY);
+			struct stat status;
+			if (fd < 0 || fstat(fd, &status) != 0)
+			{
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+				return;
+			}
+			_size   = static_cast<size_t>(status.st_size);
+			_isOpen = true;
+			if (_size > 0)
+			{
+				void* mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+				_data        = mapped != MAP_FAILED ? static_cast<const uint8_t*>(mapped) : nullptr;
+				_isOpen      = _data != nullptr;
+			}
+			close(fd);
+#else
+			std::ifstream file(filename, std::ios::binary);
+			if (!file.is_open())
+			{
+				return;
+			}
+			_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			_data   = reinterpret_cast<const uint8_t*>(_buffer.data());
+			_size   = _buffer.size();
+			_isOpen = true;
+#endif
+		};
+
+		~MappedFile()
+		{
+#if defined(BITTER_HAS_FORK)
+			if (_data)
+			{
+				munmap(const_cast<uint8_t*>(_data), _size);
+			}
+#endif
+		};
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		inline bool           IsOpen() const { return _isOpen; };
+		inline const uint8_t* Data() const { return _data; };
+		inline size_t         Size() const { return _size; };
+
+	private:
+		const uint8_t* _data{};
+		size_t         _size{};
+		bool           _isOpen{};
+#if !defined(BITTER_HAS_FORK)
+		std::vector<char> _buffer;
+#endif
+	};
+
+	/*Where TEST_MATCHES_SNAPSHOT finds the golden files, set by --snapshot-dir and --update-snapshots*/
+	struct DSnapshotOptions
+	{
+		std::string Directory{ "snapshots" };
+		bool        Update{};
+	};
+
+	inline DSnapshotOptions& __snapshotOptions()
+	{
+		static DSnapshotOptions options;
+		return options;
+	}
+
+	/*Write a file through a temporary renamed over it, so an interrupted run never leaves a truncated golden file*/
+	inline bool __writeFileAtomically(const std::string& filename, const void* data, size_t size)
+	{
+		const std::string temporary = filename + ".tmp";
 		{
-			_failed = false;
-			_currentRunningTest = -1;
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)))
+			{
+				return false;
+			}
+		}
+#if defined(_WIN32)
+		std::remove(filename.c_str());
+#endif
+		return std::rename(temporary.c_str(), filename.c_str()) == 0;
+	}
+#endif
+
+	/*Generators of the parameters of TestCaseP. A generator knows its Size() and visits a range of its parameters calling f(i, value),
+	nothing is materialized up front. Range, Values and Combine also have At(i) so they can be combined*/
+	struct DGenerator
+	{
+		std::string Error; // Set when the parameters can't be generated, the case fails with it
+	};
+
+	template<class T>
+	class RangeGenerator : public DGenerator
+	{
+	public:
+		using Value = T;
+
+		RangeGenerator(T begin, T end, T step) : _begin(begin), _step(step)
+		{
+			assert(step > T(0));
+			_size = end > begin ? Count(begin, end, step, std::is_floating_point<T>()) : 0;
+		};
+
+		inline size_t Size() const { return _size; };
+		inline T      At(size_t i) const { return At(i, std::is_floating_point<T>()); };
+
+		template<class F>
+		inline void Visit(size_t begin, size_t end, F&& function) const
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				function(i, At(i));
+			}
+		};
+
+	private:
+		T      _begin;
+		T      _step;
+		size_t _size;
+
+		/*The unsigned counterpart of an integer T, the distances between its values always fit in it*/
+		using Unsigned = typename std::make_unsigned<typename std::conditional<std::is_integral<T>::value, T, int>::type>::type;
+
+		/*The steps starting before end, the integer division rounds up and a floating point one takes its ceiling*/
+		inline static size_t Count(T begin, T end, T step, std::false_type)
+		{
+			const Unsigned distance = static_cast<Unsigned>(static_cast<Unsigned>(end) - static_cast<Unsigned>(begin));
+			const Unsigned stride   = static_cast<Unsigned>(step);
+			return static_cast<size_t>(distance / stride) + (distance % stride != 0 ? 1 : 0);
+		};
+		inline static size_t Count(T begin, T end, T step, std::true_type) { return static_cast<size_t>(std::ceil((end - begin) / step)); };
+
+		/*The offset from begin is computed in Unsigned, it wraps back to a value of T when it exceeds its maximum*/
+		inline T At(size_t i, std::false_type) const
+		{
+			return static_cast<T>(static_cast<Unsigned>(static_cast<Unsigned>(_begin) + static_cast<Unsigned>(static_cast<Unsigned>(i) * static_cast<Unsigned>(_step))));
+		};
+		inline T At(size_t i, std::true_type) const { return static_cast<T>(_begin + static_cast<T>(i) * _step); };
+	};
+
+	/*The values from begin to end excluded*/
+	template<class T>
+	inline RangeGenerator<T> Range(T begin, T end, T step = T(1))
+	{
+		return RangeGenerator<T>(begin, end, step);
+	}
+
+	template<class T>
+	class ValuesGenerator : public DGenerator
+	{
+	public:
+		using Value = T;
+
+		explicit ValuesGenerator(std::vector<T> values) : _values(std::move(values)){};
+
+		inline size_t   Size() const { return _values.size(); };
+		inline const T& At(size_t i) const { return _values[i]; };
+
+		template<class F>
+		inline void Visit(size_t begin, size_t end, F&& function) const
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				function(i, _values[i]);
+			}
+		};
+
+	private:
+		std::vector<T> _values;
+	};
+
+	template<class T>
+	inline ValuesGenerator<T> Values(std::initializer_list<T> values)
+	{
+		return ValuesGenerator<T>(std::vector<T>(values));
+	}
+
+	template<class T>
+	inline ValuesGenerator<T> Values(std::vector<T> values)
+	{
+		return ValuesGenerator<T>(std::move(values));
+	}
+
+	/*Cartesian product of generators as tuples, the last generator varies the fastest*/
+	template<class... G>
+	class CombineGenerator : public DGenerator
+	{
+	public:
+		using Value = std::tuple<typename std::decay<decltype(std::declval<const G&>().At(0))>::type...>;
+
+		static_assert(sizeof...(G) > 0, "combine at least one generator");
+
+		explicit CombineGenerator(G... generators) : _generators(generators...)
+		{
+			const size_t sizes[] = { generators.Size()... };
+			_size                = 1;
+			for (const size_t size : sizes)
+			{
+				_size *= size;
+			}
+			const std::string* errors[] = { &generators.Error... };
+			for (const std::string* error : errors)
+			{
+				Error = Error.empty() ? *error : Error;
+			}
+		};
+
+		inline size_t Size() const { return _size; };
+		inline Value  At(size_t i) const { return At(i, std::index_sequence_for<G...>()); };
+
+		template<class F>
+		inline void Visit(size_t begin, size_t end, F&& function) const
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				function(i, At(i));
+			}
+		};
+
+	private:
+		std::tuple<G...> _generators;
+		size_t           _size;
+
+		template<size_t... I>
+		inline Value At(size_t i, std::index_sequence<I...>) const
+		{
+			size_t       digits[sizeof...(G)];
+			const size_t sizes[] = { std::get<I>(_generators).Size()... };
+			for (size_t k = sizeof...(G); k-- > 0;)
+			{
+				digits[k] = i % sizes[k];
+				i /= sizes[k];
+			}
+			return Value(std::get<I>(_generators).At(digits[I])...);
+		};
+	};
+
+	template<class... G>
+	inline CombineGenerator<G...> Combine(G... generators)
+	{
+		return CombineGenerator<G...>(std::move(generators)...);
+	}
+
+	/*A row of a CSV file with its line number, counting from 1*/
+	struct DCsvRow
+	{
+		size_t                   Line{};
+		std::vector<std::string> Fields;
+
+		friend std::ostream& operator<<(std::ostream& out, const DCsvRow& row)
+		{
+			out << "line " << row.Line << ":";
+			for (size_t i = 0; i < row.Fields.size(); i++)
+			{
+				out << (i ? "," : "") << row.Fields[i];
+			}
+			return out;
+		};
+	};
+
+	/*Rows of a CSV file, only the offsets of the lines are kept and every chunk of cases reads its rows from the file. Fields can be quoted
+	with " and a quote inside is written twice, a field can't span lines*/
+	class CsvRows : public DGenerator
+	{
+	public:
+		using Value = DCsvRow;
+
+		explicit CsvRows(const std::string& filename, bool skipHeader = false, char separator = ',');
+
+		inline size_t Size() const { return _rows.size(); };
+
+		template<class F>
+		inline void Visit(size_t begin, size_t end, F&& function) const
+		{
+			using Visitor = typename std::remove_reference<F>::type;
+			ReadRows(begin, end, const_cast<void*>(static_cast<const void*>(&function)),
+					 [](void* visitor, size_t i, const DCsvRow& row) { (*static_cast<Visitor*>(visitor))(i, row); });
+		};
+
+	private:
+		struct DRowOffset
+		{
+			uint64_t Offset;
+			size_t   Line;
+		};
+
+		std::string             _filename;
+		char                    _separator;
+		std::vector<DRowOffset> _rows;
+
+		/*Read the rows from begin to end and pass each of them to visit with the visitor*/
+		void ReadRows(size_t begin, size_t end, void* visitor, void (*visit)(void* visitor, size_t i, const DCsvRow& row)) const;
+
+		void Split(const std::string& line, std::vector<std::string>& fields) const;
+	};
+
+	/*Size in bytes of a file, false if it can't be read*/
+	BITTER_API bool __fileSize(const std::string& filename, uint64_t& size);
+
+	/*Read the records from begin to end of a file one by one into record and call visit with the visitor after each of them*/
+	BITTER_API void __readRecords(const std::string& filename, size_t begin, size_t end, size_t recordSize, void* record, void* visitor,
+								  void (*visit)(void* visitor, size_t i));
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	BITTER_API CsvRows::CsvRows(const std::string& filename, bool skipHeader, char separator) : _filename(filename), _separator(separator)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			Error = "Could not read " + filename;
+			return;
+		}
+		std::string line;
+		uint64_t    offset = 0;
+		for (size_t number = 1; std::getline(file, line); number++)
+		{
+			if (!(skipHeader && number == 1) && line.find_first_not_of(" \t\r") != std::string::npos)
+			{
+				_rows.push_back({ offset, number });
+			}
+			offset += line.size() + 1;
+		}
+	}
+
+	BITTER_API void CsvRows::ReadRows(size_t begin, size_t end, void* visitor, void (*visit)(void* visitor, size_t i, const DCsvRow& row)) const
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+		std::ifstream file(_filename, std::ios::binary);
+		uint64_t      position = _rows[begin].Offset;
+		file.seekg(static_cast<std::streamoff>(position));
+		std::string line;
+		DCsvRow     row;
+		for (size_t i = begin; i < end; i++)
+		{
+			// the skipped lines are jumped over
+			if (_rows[i].Offset != position)
+			{
+				position = _rows[i].Offset;
+				file.seekg(static_cast<std::streamoff>(position));
+			}
+			std::getline(file, line);
+			position += line.size() + 1;
+			row.Line = _rows[i].Line;
+			Split(line, row.Fields);
+			visit(visitor, i, row);
+		}
+	}
+
+	BITTER_API void CsvRows::Split(const std::string& line, std::vector<std::string>& fields) const
+{
+		fields.clear();
+		fields.emplace_back();
+		bool quoted = false;
+		for (size_t i = 0; i < line.size(); i++)
+		{
+			const char c = line[i];
+			if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+			{
+				fields.back() += '"';
+				i++;
+			}
+			else if (c == '"')
+			{
+				quoted = !quoted;
+			}
+			else if (c == _separator && !quoted)
+			{
+				fields.emplace_back();
+			}
+			else if (c != '\r' || i + 1 < line.size())
+			{
+				fields.back() += c;
+			}
+		}
+	}
+
+	BITTER_API bool __fileSize(const std::string& filename, uint64_t& size)
+	{
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		size = static_cast<uint64_t>(file.tellg());
+		return true;
+	}
+
+	BITTER_API void __readRecords(const std::string& filename, size_t begin, size_t end, size_t recordSize, void* record, void* visitor,
+								  void (*visit)(void* visitor, size_t i))
+	{
+		std::ifstream file(filename, std::ios::binary);
+		file.seekg(static_cast<std::streamoff>(begin * recordSize));
+		for (size_t i = begin; i < end && file.read(static_cast<char*>(record), static_cast<std::streamsize>(recordSize)); i++)
+		{
+			visit(visitor, i);
+		}
+	}
+#endif
+
+	/*Fixed size records of a binary file read as T, a chunk of cases reads its records with one seek*/
+	template<class T>
+	class BinaryRecords : public DGenerator
+	{
+	public:
+		static_assert(std::is_trivially_copyable<T>::value, "the records are read by their bytes");
+		using Value = T;
+
+		explicit BinaryRecords(const std::string& filename) : _filename(filename)
+		{
+			uint64_t size = 0;
+			if (!__fileSize(filename, size))
+			{
+				Error = "Could not read " + filename;
+				return;
+			}
+			_size = static_cast<size_t>(size / sizeof(T));
+			if (size % sizeof(T) != 0)
+			{
+				Error = filename + " is not made of records of " + std::to_string(sizeof(T)) + " bytes";
+			}
+		};
+
+		inline size_t Size() const { return _size; };
+
+		template<class F>
+		inline void Visit(size_t begin, size_t end, F&& function) const
+		{
+			struct DVisit
+			{
+				typename std::remove_reference<F>::type* Function;
+				T                                        Record;
+			} visit{ &function, {} };
+			__readRecords(_filename, begin, end, sizeof(T), &visit.Record, &visit, [](void* state, size_t i) {
+				DVisit& visit = *static_cast<DVisit*>(state);
+				(*visit.Function)(i, static_cast<const T&>(visit.Record));
+			});
+		};
+
+	private:
+		std::string _filename;
+		size_t      _size{};
+	};
+
+	/*Stream of random values of the property cases, splitmix64 is small enough to give every trial its own stream*/
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed) : _state(seed){};
+
+		/*The stream of a trial, it depends only on the seed and the index of the trial*/
+		inline static uint64_t Stream(uint64_t seed, uint64_t index) { return Random(seed ^ (index * 0xd1b54a32d192ed03ull)).Next(); };
+
+		inline uint64_t Next()
+		{
+			uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+			z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z          = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			return z ^ (z >> 31);
+		};
+
+		/*Uniform in [0, bound), a bound of 0 draws any 64 bits value*/
+		inline uint64_t Below(uint64_t bound) { return bound ? Next() % bound : Next(); };
+
+		/*Uniform in [0, 1)*/
+		inline double Real() { return static_cast<double>(Next() >> 11) / 9007199254740992.; };
+
+	private:
+		uint64_t _state;
+	};
+
+	/*Random integers in [min, max] shrinking towards the value of the range closest to zero*/
+	template<class T>
+	class IntegerArbitrary
+	{
+	public:
+		static_assert(std::is_integral<T>::value, "IntegerArbitrary generates integers");
+		using Value = T;
+
+		IntegerArbitrary(T min, T max) : _min(std::min(min, max)), _max(std::max(min, max)){};
+
+		inline T Generate(Random& random) const
+		{
+			// one trial in eight takes a bound or the target, where the off by one errors are
+			const uint64_t choice = random.Below(8);
+			if (choice == 0)
+			{
+				return random.Below(2) ? _min : _max;
+			}
+			if (choice == 1)
+			{
+				return Target();
+			}
+			const uint64_t span = static_cast<uint64_t>(_max) - static_cast<uint64_t>(_min);
+			return static_cast<T>(static_cast<uint64_t>(_min) + random.Below(span + 1));
+		};
+
+		/*Candidates from the simplest: the target, then halfway to it down to one step away*/
+		inline void Shrink(T value, std::vector<T>& smaller) const
+		{
+			const T        target   = Target();
+			const bool     above    = value > target;
+			const uint64_t distance = above ? static_cast<uint64_t>(value) - static_cast<uint64_t>(target) : static_cast<uint64_t>(target) - static_cast<uint64_t>(value);
+			for (uint64_t step = distance; step > 0; step /= 2)
+			{
+				smaller.push_back(static_cast<T>(above ? static_cast<uint64_t>(value) - step : static_cast<uint64_t>(value) + step));
+			}
+		};
+
+	private:
+		T _min;
+		T _max;
+
+		inline T Target() const { return _min > T(0) ? _min : (_max < T(0) ? _max : T(0)); };
+	};
+
+	/*Random floating point values in [min, max] shrinking towards the value of the range closest to zero and to whole numbers*/
+	template<class T>
+	class FloatArbitrary
+	{
+	public:
+		static_assert(std::is_floating_point<T>::value, "FloatArbitrary generates floating point values");
+		using Value = T;
+
+		FloatArbitrary(T min, T max) : _min(std::min(min, max)), _max(std::max(min, max)){};
+
+		inline T Generate(Random& random) const
+		{
+			const uint64_t choice = random.Below(8);
+			if (choice == 0)
+			{
+				return random.Below(2) ? _min : _max;
+			}
+			if (choice == 1)
+			{
+				return Target();
+			}
+			// interpolated so the full range of T doesn't overflow
+			const T weight = static_cast<T>(random.Real());
+			return std::min(_max, std::max(_min, _min * (T(1) - weight) + _max * weight));
+		};
+
+		inline void Shrink(T value, std::vector<T>& smaller) const
+		{
+			const T target = Target();
+			for (const T candidate : { target, std::trunc(value), target + (value - target) / T(2) })
+			{
+				if (candidate != value && candidate >= _min && candidate <= _max && std::find(smaller.begin(), smaller.end(), candidate) == smaller.end())
+				{
+					smaller.push_back(candidate);
+				}
+			}
+		};
+
+	private:
+		T _min;
+		T _max;
+
+		inline T Target() const { return _min > T(0) ? _min : (_max < T(0) ? _max : T(0)); };
+	};
+
+	/*Random sequences of up to maxSize elements, a std::vector or a std::string, shrinking by dropping elements then shrinking them*/
+	template<class S, class G>
+	class SequenceArbitrary
+	{
+	public:
+		using Value = S;
+
+		SequenceArbitrary(G element, size_t maxSize) : _element(std::move(element)), _maxSize(maxSize){};
+
+		inline S Generate(Random& random) const
+		{
+			S            sequence;
+			const size_t size = random.Below(8) == 0 ? 0 : static_cast<size_t>(random.Below(_maxSize + 1));
+			for (size_t i = 0; i < size; i++)
+			{
+				sequence.push_back(_element.Generate(random));
+			}
+			return sequence;
+		};
+
+		inline void Shrink(const S& sequence, std::vector<S>& smaller) const
+		{
+			const size_t size = sequence.size();
+			if (size == 0)
+			{
+				return;
+			}
+			smaller.emplace_back();
+			if (size > 1)
+			{
+				smaller.emplace_back(sequence.begin(), sequence.begin() + static_cast<std::ptrdiff_t>(size / 2));
+				smaller.emplace_back(sequence.begin() + static_cast<std::ptrdiff_t>(size / 2), sequence.end());
+			}
+			for (size_t i = 0; i < size && size > 1; i++)
+			{
+				S without(sequence);
+				without.erase(without.begin() + static_cast<std::ptrdiff_t>(i));
+				smaller.push_back(std::move(without));
+			}
+			std::vector<typename G::Value> elements;
+			for (size_t i = 0; i < size; i++)
+			{
+				elements.clear();
+				_element.Shrink(sequence[i], elements);
+				for (const auto& element : elements)
+				{
+					smaller.push_back(sequence);
+					smaller.back()[i] = element;
+				}
+			}
+		};
+
+	private:
+		G      _element;
+		size_t _maxSize;
+	};
+
+	template<class T = int>
+	inline IntegerArbitrary<T> Integers(T min = std::numeric_limits<T>::lowest(), T max = std::numeric_limits<T>::max())
+	{
+		return IntegerArbitrary<T>(min, max);
+	}
+
+	template<class T = double>
+	inline FloatArbitrary<T> Floats(T min, T max)
+	{
+		return FloatArbitrary<T>(min, max);
+	}
+
+	inline IntegerArbitrary<bool> Booleans() { return IntegerArbitrary<bool>(false, true); }
+
+	template<class G>
+	inline SequenceArbitrary<std::vector<typename G::Value>, G> VectorsOf(G element, size_t maxSize = 32)
+	{
+		return SequenceArbitrary<std::vector<typename G::Value>, G>(std::move(element), maxSize);
+	}
+
+	inline SequenceArbitrary<std::string, IntegerArbitrary<char>> Strings(size_t maxSize = 32, IntegerArbitrary<char> characters = IntegerArbitrary<char>('a', 'z'))
+	{
+		return SequenceArbitrary<std::string, IntegerArbitrary<char>>(characters, maxSize);
+	}
+
+	/*Threads started once for a property case and given every search of its trials and shrink steps in turn. A search finds the smallest
+	index in [0, count) for which test(index) is true, or count. The threads take the indices in order and none starts an index after a
+	found one, so the result doesn't depend on the number of threads*/
+	class FirstIndexSearch
+	{
+	public:
+		explicit FirstIndexSearch(unsigned int numThreads);
+
+		~FirstIndexSearch();
+
+		FirstIndexSearch(const FirstIndexSearch&)            = delete;
+		FirstIndexSearch& operator=(const FirstIndexSearch&) = delete;
+
+		template<class F>
+		inline size_t Find(size_t count, const F& test)
+		{
+			return Find(count, &test, [](const void* function, size_t index) { return static_cast<bool>((*static_cast<const F*>(function))(index)); });
+		};
+
+		/*The search of Find, invoke tells if the test is true for an index*/
+		size_t Find(size_t count, const void* test, bool (*invoke)(const void* test, size_t index));
+
+	private:
+		struct DState;
+
+		std::unique_ptr<DState> _state;
+
+		void Work();
+
+		void HelperLoop();
+	};
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	struct FirstIndexSearch::DState
+	{
+		std::vector<std::thread> Helpers;
+		std::mutex               Mutex;
+		std::condition_variable  Wake;
+		std::condition_variable  Done;
+		const void*              Test{};
+		bool                     (*Invoke)(const void*, size_t){};
+		std::atomic<size_t>      Next{};
+		std::atomic<size_t>      Found{};
+		size_t                   Working{}; // Helpers still in the current search
+		uint64_t                 Search{};
+		bool                     Stopping{};
+	};
+
+	BITTER_API FirstIndexSearch::FirstIndexSearch(unsigned int numThreads) : _state(new DState())
+	{
+		for (unsigned int i = 1; i < numThreads; i++)
+		{
+			_state->Helpers.emplace_back([this]() { HelperLoop(); });
+		}
+	}
+
+	BITTER_API FirstIndexSearch::~FirstIndexSearch()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_state->Mutex);
+			_state->Stopping = true;
+		}
+		_state->Wake.notify_all();
+		for (std::thread& helper : _state->Helpers)
+		{
+			helper.join();
+		}
+	}
+
+	BITTER_API size_t FirstIndexSearch::Find(size_t count, const void* test, bool (*invoke)(const void* test, size_t index))
+	{
+		DState& state = *_state;
+		{
+			std::lock_guard<std::mutex> lock(state.Mutex);
+			state.Test    = test;
+			state.Invoke  = invoke;
+			state.Next    = 0;
+			state.Found   = count;
+			state.Working = state.Helpers.size();
+			state.Search++;
+		}
+		state.Wake.notify_all();
+		Work();
+		std::unique_lock<std::mutex> lock(state.Mutex);
+		state.Done.wait(lock, [&state]() { return state.Working == 0; });
+		return state.Found;
+	}
+
+	BITTER_API void FirstIndexSearch::Work()
+	{
+		DState& state = *_state;
+		for (size_t i = state.Next++; i < state.Found.load(); i = state.Next++)
+		{
+			if (state.Invoke(state.Test, i))
+			{
+				size_t current = state.Found.load();
+				while (i < current && !state.Found.compare_exchange_weak(current, i))
+				{
+				}
+			}
+		}
+	}
+
+	BITTER_API void FirstIndexSearch::HelperLoop()
+	{
+		DState& state = *_state;
+		for (uint64_t seen = 0;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(state.Mutex);
+				state.Wake.wait(lock, [&]() { return state.Stopping || state.Search != seen; });
+				if (state.Stopping)
+				{
+					return;
+				}
+				seen = state.Search;
+			}
+			Work();
+			std::lock_guard<std::mutex> lock(state.Mutex);
+			if (--state.Working == 0)
+			{
+				state.Done.notify_all();
+			}
+		}
+	}
+#endif
+
+#if defined(BITTER_HAS_COROUTINES)
+	template<class T = void>
+	class Task;
+
+	/*What the promises of the tasks share: the coroutine awaiting the task, resumed when it returns, and the exception it threw*/
+	struct __taskPromiseBase
+	{
+		std::coroutine_handle<> Continuation;
+		std::exception_ptr      Exception;
+
+		struct DFinalAwaiter
+		{
+			inline bool await_ready() noexcept { return false; };
+			template<class P>
+			inline std::coroutine_handle<> await_suspend(std::coroutine_handle<P> finished) noexcept
+			{
+				const std::coroutine_handle<> continuation = finished.promise().Continuation;
+				return continuation ? continuation : std::noop_coroutine();
+			};
+			inline void await_resume() noexcept {};
+		};
+
+		inline std::suspend_always initial_suspend() noexcept { return {}; };
+		inline DFinalAwaiter       final_suspend() noexcept { return {}; };
+		inline void                unhandled_exception() { Exception = std::current_exception(); };
+	};
+
+	template<class T>
+	struct __taskPromise : __taskPromiseBase
+	{
+		std::optional<T> Value;
+
+		inline Task<T> get_return_object() noexcept;
+
+		template<class U>
+		inline void return_value(U&& value)
+		{
+			Value.emplace(std::forward<U>(value));
+		};
+
+		inline T Result()
+		{
+			if (Exception)
+			{
+				std::rethrow_exception(Exception);
+			}
+			return std::move(*Value);
+		};
+	};
+
+	template<>
+	struct __taskPromise<void> : __taskPromiseBase
+	{
+		inline Task<void> get_return_object() noexcept;
+		inline void       return_void() noexcept {};
+
+		inline void Result()
+		{
+			if (Exception)
+			{
+				std::rethrow_exception(Exception);
+			}
+		};
+	};
+
+	/*Coroutine of an async test case, it starts when awaited and resumes its caller with the value of co_return*/
+	template<class T>
+	class [[nodiscard]] Task
+	{
+	public:
+		using promise_type = __taskPromise<T>;
+		using Handle       = std::coroutine_handle<promise_type>;
+
+		explicit Task(Handle handle) noexcept : _handle(handle){};
+		Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)){};
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				_handle = std::exchange(other._handle, nullptr);
+			}
+			return *this;
+		};
+		~Task() { Reset(); };
+
+		inline bool                    await_ready() const noexcept { return IsDone(); };
+		inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			_handle.promise().Continuation = awaiting;
+			return _handle;
+		};
+		inline T await_resume() { return _handle.promise().Result(); };
+
+		inline bool   IsDone() const noexcept { return !_handle || _handle.done(); };
+		inline Handle GetHandle() const noexcept { return _handle; };
+
+		/*Destroy the coroutine even if it's suspended, with the tasks it awaits*/
+		inline void Reset()
+		{
+			if (_handle)
+			{
+				_handle.destroy();
+				_handle = nullptr;
+			}
+		};
+
+	private:
+		Handle _handle;
+	};
+
+	template<class T>
+	inline Task<T> __taskPromise<T>::get_return_object() noexcept
+	{
+		return Task<T>(Task<T>::Handle::from_promise(*this));
+	};
+
+	inline Task<void> __taskPromise<void>::get_return_object() noexcept { return Task<void>(Task<void>::Handle::from_promise(*this)); };
+
+	class EventLoop;
+
+	/*Awaiter resuming the coroutine after a duration. Outside of an event loop the thread sleeps*/
+	struct __sleepAwaiter
+	{
+		std::chrono::nanoseconds Duration;
+
+		inline bool await_ready() const noexcept { return Duration <= std::chrono::nanoseconds::zero(); };
+		bool        await_suspend(std::coroutine_handle<> handle);
+		inline void await_resume() const noexcept {};
+	};
+
+	/*co_await SleepFor(200ms) suspends the async case and lets the others run*/
+	template<class Rep, class Period>
+	inline __sleepAwaiter SleepFor(std::chrono::duration<Rep, Period> duration)
+	{
+		return { std::chrono::duration_cast<std::chrono::nanoseconds>(duration) };
+	};
+
+	/*co_await Yield() lets the other async cases that are ready run first*/
+	inline __sleepAwaiter Yield() { return { std::chrono::nanoseconds(1) }; };
+
+#if defined(BITTER_HAS_FORK)
+	/*Awaiter resuming the coroutine when poll reports the events on a file descriptor*/
+	struct __pollAwaiter
+	{
+		int   Fd;
+		short Events;
+
+		inline bool await_ready() const noexcept { return false; };
+		bool        await_suspend(std::coroutine_handle<> handle);
+		inline void await_resume() const noexcept {};
+	};
+
+	/*co_await WaitReadable(socket) suspends the async case until the file descriptor can be read, or is closed*/
+	BITTER_API __pollAwaiter WaitReadable(int fd);
+
+	/*co_await WaitWritable(socket) suspends the async case until the file descriptor can be written*/
+	BITTER_API __pollAwaiter WaitWritable(int fd);
+#endif
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	/*Single threaded loop resuming the suspended coroutines of the async cases when they are ready, their timer expired or their file
+	descriptor can be read or written. Every entry is tagged with the case that suspended, so the case is restored before resuming it*/
+	class EventLoop
+	{
+	public:
+		/*The loop running on the calling thread, nullptr outside of the async cases*/
+		inline static EventLoop*& Current()
+		{
+			thread_local EventLoop* loop = nullptr;
+			return loop;
+		};
+
+		/*Tag of the case that is resumed*/
+		inline static size_t& CurrentTag()
+		{
+			thread_local size_t tag = 0;
+			return tag;
+		};
+
+		inline void Schedule(std::coroutine_handle<> handle) { _ready.push_back({ handle, CurrentTag() }); };
+		inline void ScheduleAt(std::chrono::steady_clock::time_point time, std::coroutine_handle<> handle)
+		{
+			_timers.push_back({ time, { handle, CurrentTag() } });
+			std::push_heap(_timers.begin(), _timers.end(), Later);
+		};
+
+#if defined(BITTER_HAS_FORK)
+		/*Resume when poll reports one of the events on the file descriptor, or an error*/
+		inline void ScheduleWhen(int fd, short events, std::coroutine_handle<> handle) { _waits.push_back({ fd, events, { handle, CurrentTag() } }); };
+#endif
+
+		/*Room for the entries of that many cases, a case waits on one entry at a time so the loop doesn't allocate while they run*/
+		inline void Reserve(size_t cases)
+		{
+			_ready.reserve(cases);
+			_resuming.reserve(cases);
+			_timers.reserve(cases);
+#if defined(BITTER_HAS_FORK)
+			_waits.reserve(cases);
+#endif
+		};
+
+		/*Drop the entries of a case, before its coroutines are destroyed*/
+		inline void Cancel(size_t tag)
+		{
+			_ready.erase(std::remove_if(_ready.begin(), _ready.end(), [tag](const DEntry& entry) { return entry.Tag == tag; }), _ready.end());
+			_timers.erase(std::remove_if(_timers.begin(), _timers.end(), [tag](const DTimer& timer) { return timer.Entry.Tag == tag; }), _timers.end());
+			std::make_heap(_timers.begin(), _timers.end(), Later);
+#if defined(BITTER_HAS_FORK)
+			_waits.erase(std::remove_if(_waits.begin(), _waits.end(), [tag](const DWait& wait) { return wait.Entry.Tag == tag; }), _waits.end());
+#endif
+		};
+
+		/*Resume the coroutines that are ready, if none is it waits for the first timer or file descriptor but not past until.
+		resume(tag, handle) resumes each of them so the caller can restore their case around it. Returns false when nothing is pending*/
+		template<class F>
+		inline bool RunOnce(std::chrono::steady_clock::time_point until, const F& resume)
+		{
+			if (_ready.empty() && _timers.empty() && NoWaits())
+			{
+				return false;
+			}
+			if (_ready.empty())
+			{
+				const auto wake = _timers.empty() ? until : std::min(until, _timers.front().Time);
+				Wait(wake);
+				const auto now = std::chrono::steady_clock::now();
+				while (!_timers.empty() && _timers.front().Time <= now)
+				{
+					std::pop_heap(_timers.begin(), _timers.end(), Later);
+					_ready.push_back(_timers.back().Entry);
+					_timers.pop_back();
+				}
+			}
+			// the coroutines resumed schedule in the other buffer
+			_resuming.swap(_ready);
+			for (const DEntry& entry : _resuming)
+			{
+				CurrentTag() = entry.Tag;
+				resume(entry.Tag, entry.Handle);
+			}
+			_resuming.clear();
+			return true;
+		};
+
+	private:
+		struct DEntry
+		{
+			std::coroutine_handle<> Handle;
+			size_t                  Tag;
+		};
+
+		struct DTimer
+		{
+			std::chrono::steady_clock::time_point Time;
+			DEntry                                Entry;
+		};
+
+		/*Order of the heap of timers, the first to expire on top*/
+		inline static bool Later(const DTimer& first, const DTimer& second) { return first.Time > second.Time; };
+
+		std::vector<DEntry> _ready;
+		std::vector<DEntry> _resuming;
+		std::vector<DTimer> _timers;
+
+#if defined(BITTER_HAS_FORK)
+		struct DWait
+		{
+			int    Fd;
+			short  Events;
+			DEntry Entry;
+		};
+
+		std::vector<DWait> _waits;
+
+		inline bool NoWaits() const { return _waits.empty(); };
+
+		inline void Wait(std::chrono::steady_clock::time_point wake)
+		{
+			if (_waits.empty())
+			{
+				std::this_thread::sleep_until(wake);
+				return;
+			}
+			// without a deadline poll waits for ever, a far one is cut to the longest timeout poll takes
+			int timeout = -1;
+			if (wake != std::chrono::steady_clock::time_point::max())
+			{
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(wake - std::chrono::steady_clock::now() + std::chrono::microseconds(999));
+				timeout              = static_cast<int>(std::min<int64_t>(std::max<int64_t>(remaining.count(), 0), std::numeric_limits<int>::max()));
+			}
+			std::vector<pollfd> fds(_waits.size());
+			for (size_t i = 0; i < _waits.size(); i++)
+			{
+				fds[i] = { _waits[i].Fd, _waits[i].Events, 0 };
+			}
+			if (poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) <= 0)
+			{
+				return;
+			}
+			size_t kept = 0;
+			for (size_t i = 0; i < _waits.size(); i++)
+			{
+				if (fds[i].revents != 0)
+				{
+					_ready.push_back(_waits[i].Entry);
+				}
+				else
+				{
+					_waits[kept++] = _waits[i];
+				}
+			}
+			_waits.resize(kept);
+		};
+#else
+		inline bool NoWaits() const { return true; };
+		inline void Wait(std::chrono::steady_clock::time_point wake) { std::this_thread::sleep_until(wake); };
+#endif
+	};
+
+	BITTER_API bool __sleepAwaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		if (EventLoop* loop = EventLoop::Current())
+		{
+			loop->ScheduleAt(std::chrono::steady_clock::now() + Duration, handle);
+			return true;
+		}
+		std::this_thread::sleep_for(Duration);
+		return false;
+	}
+
+#if defined(BITTER_HAS_FORK)
+	BITTER_API bool __pollAwaiter::await_suspend(std::coroutine_handle<> handle)
+	{
+		if (EventLoop* loop = EventLoop::Current())
+		{
+			loop->ScheduleWhen(Fd, Events, handle);
+			return true;
+		}
+		pollfd fd{ Fd, Events, 0 };
+		poll(&fd, 1, -1);
+		return false;
+	}
+
+	BITTER_API __pollAwaiter WaitReadable(int fd) { return { fd, POLLIN }; }
+
+	BITTER_API __pollAwaiter WaitWritable(int fd) { return { fd, POLLOUT }; }
+#endif
+#endif
+#endif
+
+	/*Maximum wall clock duration of a test case, passed to TestCase it overrides --timeout*/
+	struct Timeout
+	{
+		template<class Rep, class Period>
+		Timeout(std::chrono::duration<Rep, Period> duration) : Duration(std::chrono::duration_cast<std::chrono::nanoseconds>(duration)){};
+		std::chrono::nanoseconds Duration;
+	};
+
+	/*Allocations counted by the global operator new that BITTER_TRACK_ALLOCS installs. For a thread Live and Peak are the bytes alive and their
+	high water mark, for a test case they are the bytes the case didn't free and the peak above what was alive when it started*/
+	struct DAllocationStats
+	{
+		uint64_t Allocations;
+		uint64_t Frees;
+		uint64_t Bytes;
+		int64_t  Live;
+		int64_t  Peak;
+	};
+
+	/*Counters of the calling thread, constant initialized so operator new can use them at any time*/
+	inline DAllocationStats& __threadAllocations()
+	{
+		thread_local DAllocationStats stats{};
+		return stats;
+	}
+
+	inline bool& __allocationTracking()
+	{
+		static bool installed = false;
+		return installed;
+	}
+
+	/*True when the translation unit defining BITTER_TRACK_ALLOCS is linked in and the allocations are counted*/
+	inline bool IsTrackingAllocations() { return __allocationTracking(); }
+
+	/*Allocations made by the calling thread since it started*/
+	inline DAllocationStats GetThreadAllocations() { return __threadAllocations(); }
+
+	/*Reset the high water mark of the calling thread to the bytes alive, returns the counters at the start of the window*/
+	inline DAllocationStats __beginAllocationWindow()
+	{
+		DAllocationStats& stats = __threadAllocations();
+		stats.Peak              = stats.Live;
+		return stats;
+	}
+
+	/*Allocations of the calling thread since __beginAllocationWindow returned start*/
+	inline DAllocationStats __endAllocationWindow(const DAllocationStats& start)
+	{
+		const DAllocationStats& stats = __threadAllocations();
+		return { stats.Allocations - start.Allocations, stats.Frees - start.Frees, stats.Bytes - start.Bytes, stats.Live - start.Live, stats.Peak - start.Live };
+	}
+
+	/*Add a window to the allocations of a case run in several of them, the peak stays relative to the bytes alive before the first*/
+	inline void __addAllocationWindow(DAllocationStats& total, const DAllocationStats& window)
+	{
+		total.Peak = std::max(total.Peak, total.Live + window.Peak);
+		total.Allocations += window.Allocations;
+		total.Frees += window.Frees;
+		total.Bytes += window.Bytes;
+		total.Live += window.Live;
+	}
+
+	/*Wraps a functions the will execute a test case, the name points in the owning instance arena*/
+	struct DTestCase
+	{
+	public:
+		DTestCase(const char* name, size_t nameSize, InlineFunction&& testFunction) : Name(name), NameSize(nameSize), Func(std::move(testFunction)) {};
+		inline void    DoWork() const { Func(); };
+		const char*    Name;
+		size_t         NameSize;
+		InlineFunction Func;
+	};
+
+	/*Process wide registry of the fixtures shared by the test classes. The first Acquire constructs a fixture and the next ones share it,
+	concurrent callers wait for the construction. It's destroyed when its last handle is released, a fixture with declared users is kept
+	until the last of them is released too, so the classes of a run that use it one after the other construct it once*/
+	class SharedFixtures
+	{
+	public:
+		/*Get the fixture of type T, constructed with its default constructor on first use*/
+		template<class T>
+		static std::shared_ptr<T> Acquire()
+		{
+			return Acquire<T>(std::string(), []() { return std::make_shared<T>(); });
+		};
+
+		/*Get the fixture of type T registered as name, constructed by factory on first use. If factory throws the exception goes to the caller
+		and the next Acquire tries again*/
+		template<class T, class F>
+		static std::shared_ptr<T> Acquire(const std::string& name, F factory)
+		{
+			const std::shared_ptr<DEntry> entry = Entry(std::type_index(typeid(T)), name);
+			// constructed under the lock of the entry, it can acquire other fixtures
+			std::lock_guard<std::mutex> lock(entry->Mutex);
+			std::shared_ptr<T>          fixture = std::static_pointer_cast<T>(entry->Fixture.lock());
+			if (!fixture)
+			{
+				fixture        = factory();
+				entry->Fixture = fixture;
+			}
+			Retain(*entry, fixture);
+			return fixture;
+		};
+
+		/*Declare a user of the fixture of type T registered as name, the fixture is kept alive once constructed until every user is released.
+		The user is released with the returned handle*/
+		template<class T>
+		static std::shared_ptr<void> AddUser(const std::string& name = std::string())
+		{
+			return AddUser(std::type_index(typeid(T)), name);
+		};
+
+		/*Number of fixtures alive*/
+		static size_t GetNumAlive();
+
+	private:
+		struct DEntry
+		{
+			std::mutex            Mutex; // Held while the fixture is constructed
+			std::weak_ptr<void>   Fixture;
+			std::shared_ptr<void> Retained; // The fixture while it has users, guarded by the state mutex
+			size_t                Users{};
+		};
+
+		struct DState;
+
+		static DState& State();
+
+		static std::shared_ptr<DEntry> Entry(std::type_index type, const std::string& name);
+
+		/*Keep the fixture alive with the entry if it has users*/
+		static void Retain(DEntry& entry, const std::shared_ptr<void>& fixture);
+
+		static std::shared_ptr<void> AddUser(std::type_index type, const std::string& name);
+
+		static void RemoveUser(DEntry& entry);
+	};
+
+	/*The shared fixtures a class declares in its static DeclareSharedFixtures. The run collects them for its classes when it starts,
+	without constructing any, and releases those of a class once it ended*/
+	class SharedFixtureUsers
+	{
+	public:
+		/*Declare that the class uses the shared fixture of type T registered as name, it is kept from its first Acquire until the AfterAll
+		of the last class of the run that declared it*/
+		template<class T>
+		inline void Use(const std::string& name = std::string())
+		{
+			_users.push_back(SharedFixtures::AddUser<T>(name));
+		};
+
+	private:
+		friend class AutomationTester;
+
+		std::vector<std::shared_ptr<void>> _users;
+	};
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	struct SharedFixtures::DState
+	{
+		std::mutex                                                                    Mutex;
+		std::map<std::pair<std::type_index, std::string>, std::shared_ptr<DEntry>> Entries;
+	};
+
+	BITTER_API size_t SharedFixtures::GetNumAlive()
+	{
+		DState&                     state = State();
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		return static_cast<size_t>(std::count_if(state.Entries.begin(), state.Entries.end(), [](const auto& entry) { return !entry.second->Fixture.expired(); }));
+	}
+
+	BITTER_API SharedFixtures::DState& SharedFixtures::State()
+	{
+		static DState state;
+		return state;
+	}
+
+	BITTER_API std::shared_ptr<SharedFixtures::DEntry> SharedFixtures::Entry(std::type_index type, const std::string& name)
+	{
+		DState&                     state = State();
+		std::lock_guard<std::mutex> lock(state.Mutex);
+		std::shared_ptr<DEntry>&    found = state.Entries[std::make_pair(type, name)];
+		if (!found)
+		{
+			found = std::make_shared<DEntry>();
+		}
+		return found;
+	}
+
+	BITTER_API void SharedFixtures::Retain(DEntry& entry, const std::shared_ptr<void>& fixture)
+	{
+		std::lock_guard<std::mutex> lock(State().Mutex);
+		if (entry.Users > 0 && !entry.Retained)
+		{
+			entry.Retained = fixture;
+		}
+	}
+
+	BITTER_API std::shared_ptr<void> SharedFixtures::AddUser(std::type_index type, const std::string& name)
+	{
+		const std::shared_ptr<DEntry> entry = Entry(type, name);
+		{
+			std::lock_guard<std::mutex> lock(State().Mutex);
+			entry->Users++;
+		}
+		return std::shared_ptr<void>(entry.get(), [entry](void*) { RemoveUser(*entry); });
+	}
+
+	BITTER_API void SharedFixtures::RemoveUser(DEntry& entry)
+	{
+		std::shared_ptr<void> retained;
+		{
+			std::lock_guard<std::mutex> lock(State().Mutex);
+			if (--entry.Users == 0)
+			{
+				retained.swap(entry.Retained);
+			}
+		}
+		// destroyed outside of the lock since a destructor can release other fixtures
+		retained.reset();
+	}
+#endif
+
+	class TestFilter;
+
+	/*String stream of the failure messages and of the logs, an std::ostringstream created on the first write and kept behind a pointer,
+	so a file with BITTER_SPLIT formats the messages of its assertions without including <sstream>*/
+	class MessageBuffer
+	{
+	public:
+		MessageBuffer();
+		MessageBuffer(MessageBuffer&& other) noexcept;
+		~MessageBuffer();
+
+		template<class T>
+		inline MessageBuffer& operator<<(const T& value)
+		{
+			Stream() << value;
+			return *this;
+		};
+
+		std::ostream& Stream();
+
+		/*What was written, empty for a buffer that was moved from*/
+		std::string Str() const;
+
+		void Clear();
+
+	private:
+		std::unique_ptr<std::ostringstream> _stream;
+	};
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	BITTER_API MessageBuffer::MessageBuffer() = default;
+
+	BITTER_API MessageBuffer::MessageBuffer(MessageBuffer&& other) noexcept = default;
+
+	BITTER_API MessageBuffer::~MessageBuffer() = default;
+
+	BITTER_API std::ostream& MessageBuffer::Stream()
+	{
+		if (!_stream)
+		{
+			_stream.reset(new std::ostringstream());
+		}
+		return *_stream;
+	}
+
+	BITTER_API std::string MessageBuffer::Str() const { return _stream ? _stream->str() : std::string(); }
+
+	BITTER_API void MessageBuffer::Clear()
+	{
+		if (_stream)
+		{
+			_stream->str(std::string());
+		}
+	}
+#endif
+
+	/*This is the class responsible of defining a group of test cases*/
+	class AutomatedTestInstance
+	{
+	public:
+		static constexpr size_t NotFound = static_cast<size_t>(-1);
+
+		AutomatedTestInstance();
+		virtual ~AutomatedTestInstance();
+
+		/*Resets it's internal state*/
+		void ResetFlags();
+
+		/*Overidde this function to define the test cases*/
+		virtual void Define() = 0;
+
+		/*Called around every test case on the thread running it, assertions and exceptions fail the case. When the cases run in parallel
+		they are called concurrently*/
+		virtual void SetUp(){};
+		virtual void TearDown(){};
+
+		/*Called once before the first selected test case of the class and once after the last one. A failed assertion or an exception in
+		BeforeAll fails every case without running them, in AfterAll it fails the class. With --isolate they run in each worker process*/
+		virtual void BeforeAll(){};
+		virtual void AfterAll(){};
+
+		/*If expression == false it will make the test fail*/
+		inline bool TestTrue(bool expression)
+		{
+			if (!expression)
+			{
+				FailCurrentTest();
+			}
+			return expression;
+		};
+
+		/*If expression == true it will make the test fail*/
+		inline bool TestFalse(bool expression)
+		{
+			if (expression)
+			{
+				FailCurrentTest();
+			}
+			return !expression;
+		};
+
+		/*Compare two values and return true if they are equal, if not the test will fail. Floating point values are compared within their epsilon
+		and integers of different signedness by their mathematical value*/
+		template<class A, class B>
+		inline bool TestEqual(const A& value, const B& expected)
+		{
+			return Check(__compareEqual(value, expected));
+		};
+
+		/*Compare two values and return true if they are different, if not the test will fail*/
+		template<class A, class B>
+		inline bool TestNotEqual(const A& value, const B& expected)
+		{
+			return Check(!__compareEqual(value, expected));
+		};
+
+		/*Return true if value < bound, if not the test will fail*/
+		template<class A, class B>
+		inline bool TestLess(const A& value, const B& bound)
+		{
+			return Check(__compareLess(value, bound));
+		};
+
+		/*Return true if value <= bound, if not the test will fail*/
+		template<class A, class B>
+		inline bool TestLessEqual(const A& value, const B& bound)
+		{
+			return Check(!__compareLess(bound, value));
+		};
+
+		/*Return true if value > bound, if not the test will fail*/
+		template<class A, class B>
+		inline bool TestGreater(const A& value, const B& bound)
+		{
+			return Check(__compareLess(bound, value));
+		};
+
+		/*Return true if value >= bound, if not the test will fail*/
+		template<class A, class B>
+		inline bool TestGreaterEqual(const A& value, const B& bound)
+		{
+			return Check(!__compareLess(value, bound));
+		};
+
+		/*Return true if value is at most tolerance away from expected, if not the test will fail*/
+		template<class A, class B, class T>
+		inline bool TestNear(const A& value, const B& expected, const T& tolerance)
+		{
+			return Check(__compareNear(value, expected, tolerance));
+		};
+
+		/*Name of the test running on the calling thread, "<no current case>" on a thread that isn't attached to a case*/
+		const char* GetCurrentTestName() const;
+
+		/*Writes the failure message of a comparison macro with the formatted operands. It's out of line and only called on failure,
+		so a passing assertion costs just the comparison*/
+		template<class A, class B>
+		BITTER_NOINLINE void ReportComparisonFailure(int line, const char* assertion, const char* expectation, const A& value, const B& expected)
+		{
+			MessageBuffer message;
+			message << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion << " " << expectation << ", ";
+			Formatter<A>::Format(message.Stream(), value);
+			message << " vs ";
+			Formatter<B>::Format(message.Stream(), expected);
+			message << ENDLINE;
+			AddFailureMessage(message.Str());
+		};
+
+		/*Fail the running test unless the buffers compared by CompareBuffers or CompareArraysNear match*/
+		inline bool TestBuffers(const DBufferComparison& comparison) { return Check(comparison.Matches()); };
+
+		/*Writes the failure message of a buffer assertion with the number of elements that differ, the first of them and the largest error,
+		so a mismatch of a large buffer is a single line*/
+		template<class T>
+		BITTER_NOINLINE void ReportBufferFailure(int line, const char* assertion, const DBufferComparison& comparison, size_t count, const T* value, const T* expected)
+		{
+			MessageBuffer message;
+			message << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion << " " << comparison.NumMismatches << " of " << count
+					<< " elements differ, the first at index " << comparison.FirstMismatch << " ";
+			const auto& first         = __printable(value[comparison.FirstMismatch]);
+			const auto& firstExpected = __printable(expected[comparison.FirstMismatch]);
+			Formatter<typename std::decay<decltype(first)>::type>::Format(message.Stream(), first);
+			message << " vs ";
+			Formatter<typename std::decay<decltype(firstExpected)>::type>::Format(message.Stream(), firstExpected);
+			message << ", max error " << comparison.MaxError << (comparison.ErrorInUlps ? " ulps" : "") << ENDLINE;
+			AddFailureMessage(message.Str());
+		};
+
+		void ReportBufferFailure(int line, const char* assertion, const DBufferComparison& comparison, size_t count, const void* value, const void* expected);
+
+		/*Compare size bytes with the golden file name in the snapshot directory, used by TEST_MATCHES_SNAPSHOT. The golden file is mapped
+		in memory, on a mismatch the data is written next to it as name.actual. With --update-snapshots the golden file is written instead*/
+		bool TestSnapshot(const std::string& name, const void* data, size_t size, int line, const char* assertion);
+
+		/*Return a vector of test names*/
+		std::vector<std::string> GetTestNames() const;
+
+		/*Return the name of a test case by index, the pointer is null terminated and valid for the lifetime of the instance*/
+		const char* GetTestName(size_t index) const;
+
+		/*Will run a particular test case by it's name*/
+		bool RunTest(const std::string& name);
+
+		/*Will run a particular test case by it's index, different indices can run concurrently on different threads*/
+		bool RunTest(size_t index);
+
+		/*Run all tests, return true if they all passed, false otherwise*/
+		bool RunAll();
+
+		/*Returns the index of a test case by it's name or NotFound*/
+		inline size_t FindTest(const std::string& name) const { return FindTest(name.data(), name.size()); };
+
+		size_t FindTest(const char* name, size_t size) const;
+
+		/*Get the status of a particular test by name*/
+		ETestStatus GetResult(const std::string& name) const;
+
+		/*Get the status of a particular test by index*/
+		ETestStatus GetResult(size_t index) const;
+
+		/*Get a vector of status for all the tests*/
+		inline std::vector<ETestStatus> GetResults() const { return _testStatus; }
+
+		/*Get the wall clock duration of the last run of every test*/
+		inline std::vector<std::chrono::nanoseconds> GetDurations() const { return _testDurations; }
+
+		/*Get the wall clock duration of the last run of a particular test by index*/
+		std::chrono::nanoseconds GetDuration(size_t index) const;
+
+		/*Used to define a test case, the callable is stored inline when small so a test case usually costs no allocation*/
+		template<class F>
+		inline void TestCase(const char* name, F&& testFunc)
+		{
+			AddTestCase(name, std::strlen(name), InlineFunction(std::forward<F>(testFunc)));
+		};
+
+		template<class F>
+		inline void TestCase(const std::string& name, F&& testFunc)
+		{
+			AddTestCase(name.data(), name.size(), InlineFunction(std::forward<F>(testFunc)));
+		};
+
+		/*Used to define a test case that fails when it runs longer than timeout*/
+		template<class F>
+		inline void TestCase(const char* name, F&& testFunc, Timeout timeout)
+		{
+			AddTestCase(name, std::strlen(name), InlineFunction(std::forward<F>(testFunc)), timeout.Duration);
+		};
+
+		template<class F>
+		inline void TestCase(const std::string& name, F&& testFunc, Timeout timeout)
+		{
+			AddTestCase(name.data(), name.size(), InlineFunction(std::forward<F>(testFunc)), timeout.Duration);
+		};
+
+#if defined(BITTER_HAS_COROUTINES)
+		/*Define a case that is a coroutine, testFunc returns a bitter::Task<>. The async cases of a class running its cases in parallel run
+		together on an event loop where a case suspended by a co_await SleepFor, WaitReadable or WaitWritable lets the others run. The assertions
+		report to the case across the co_await and a case is cancelled when its timeout, or else --timeout, expires*/
+		template<class F>
+		inline void AsyncTestCase(const std::string& name, F testFunc)
+		{
+			const size_t index = _tests.size();
+			TestCase(name, [this, index]() { RunAsyncAlone(index); });
+			_asyncCases.emplace(index, std::unique_ptr<AsyncFunction>(new AsyncFunctionOf<F>(std::move(testFunc))));
+		};
+
+		template<class F>
+		inline void AsyncTestCase(const std::string& name, F testFunc, Timeout timeout)
+		{
+			const size_t index = _tests.size();
+			TestCase(name, [this, index]() { RunAsyncAlone(index); }, timeout);
+			_asyncCases.emplace(index, std::unique_ptr<AsyncFunction>(new AsyncFunctionOf<F>(std::move(testFunc))));
+		};
+#endif
+
+		struct DAsyncWatch;
+
+		/*Run together on an event loop the async cases among the selected ones, the following RunTest of each of them reports its result.
+		The cases overlap so the class must allow it with SetRunCasesInParallel(true). Without coroutines, without that or with a single
+		async case it does nothing, RunTest runs them one at a time*/
+		void RunAsyncTests(const std::vector<size_t>& selected, std::chrono::nanoseconds defaultTimeout, const DAsyncWatch& watch);
+
+		/*Define a case that runs testFunc(parameter) for every parameter of a generator: Range, Values, Combine, CsvRows or BinaryRecords.
+		The parameters are split in chunks of chunkSize defined as the cases name/first-last, in a class calling SetRunCasesInParallel(true)
+		they spread across the jobs. A parameter is named name/i only when a failure is reported or a --filter needs it*/
+		template<class G, class F>
+		inline void TestCaseP(const std::string& name, G generator, F testFunc, size_t chunkSize = 256)
+		{
+			if (!generator.Error.empty())
+			{
+				const std::string message = "In:" + name + " " + generator.Error + ENDLINE;
+				TestCase(name, [this, message]() {
+					FailCurrentTest();
+					AddFailureMessage(message);
+				});
+				return;
+			}
+			const auto   shared    = std::make_shared<const G>(std::move(generator));
+			const auto   function  = std::make_shared<F>(std::move(testFunc));
+			const size_t size      = shared->Size();
+			chunkSize              = std::max<size_t>(chunkSize, 1);
+			ReserveTests(_tests.size() + (size + chunkSize - 1) / chunkSize);
+			for (size_t begin = 0; begin < size; begin += chunkSize)
+			{
+				const size_t end   = std::min(size, begin + chunkSize);
+				const size_t chunk = _parameterChunks.size();
+				_parameterChunks.push_back({ name, begin, end, _tests.size(), false, false });
+				TestCase(name + "/" + std::to_string(begin) + "-" + std::to_string(end - 1), [this, shared, function, chunk]() { RunParameters(*shared, *function, chunk); });
+			}
+		};
+
+		/*Define a case checking that predicate(values...) holds for random values of the arbitraries: Integers, Floats, Booleans, VectorsOf or Strings.
+		The trials are spread across threads and each draws from its own stream of the seed. A falsified property is shrunk to a minimal counterexample
+		reported with the seed that reproduces it through --seed. The predicate returns false or throws to falsify, it's called concurrently*/
+		template<class... A>
+		inline void PropertyCase(const std::string& name, A... arguments)
+		{
+			static_assert(sizeof...(A) >= 2, "PropertyCase takes the arbitraries followed by the predicate");
+			DefineProperty(name, std::make_tuple(std::move(arguments)...), std::make_index_sequence<sizeof...(A) - 1>());
+		};
+
+		/*Number of trials of the property cases, --trials overrides it*/
+		inline void SetPropertyTrials(size_t trials) { _propertyTrials = std::max<size_t>(trials, 1); };
+
+		/*Seed of the property cases instead of a new one every run, --seed overrides it*/
+		void SetPropertySeed(uint64_t seed);
+
+		/*Threads running the trials of a property case, 0 uses every core*/
+		inline void SetPropertyThreads(unsigned int threads) { _propertyThreads = threads; };
+
+		/*Timeout of a test case by index, zero when the case uses the --timeout of the run*/
+		std::chrono::nanoseconds GetTimeout(size_t index) const;
+
+		/*Reserve room for a number of test cases, useful when a class defines lots of cases programmatically*/
+		void ReserveTests(size_t count);
+
+		/*Used to define a benchmark case, benchmarkFunc is a single iteration and it's called in a tight loop*/
+		template<class F>
+		inline void BenchmarkCase(const std::string& name, F benchmarkFunc, DBenchmarkOptions options = DBenchmarkOptions())
+		{
+			const size_t index = _tests.size();
+			TestCase(name, [this, index, benchmarkFunc, options]() mutable {
+				_benchmarkResults.at(index) = __measureBenchmark(benchmarkFunc, options, [this, index]() { return _testFailed[index] != 0; });
+			});
+			_benchmarkResults.emplace(index, DBenchmarkResult());
+		};
+
+		/*Returns the measurements of a benchmark case by index, nullptr if it's not a benchmark*/
+		const DBenchmarkResult* GetBenchmarkResult(size_t index) const;
+
+		/*Returns the index of the test running on the calling thread or the test it's attached to, -1 on the other threads*/
+		signed int GetCurrentRunningTest() const;
+
+		/*Fail the running test when an expression made more allocations than budget, used by TEST_MAX_ALLOCS. Without BITTER_TRACK_ALLOCS
+		the allocations are unknown and it fails too, in a sanitized build it's skipped since the sanitizer owns the allocator*/
+		bool TestMaxAllocations(uint64_t allocations, uint64_t budget, int line, const char* assertion);
+
+		/*Allocations of the last run of a test by index, SetUp and TearDown included. Zero without BITTER_TRACK_ALLOCS*/
+		const DAllocationStats& GetAllocations(size_t index) const;
+
+		/*Fail the test cases that end with more bytes alive than when they started, call it from Define(). The allocations and the frees
+		are counted on the thread running the case, memory freed by another thread looks leaked*/
+		inline void SetDetectLeaks(bool detect) { _detectLeaks = detect; };
+
+		/*Declare that the test cases of this class do not share state and can run concurrently with each other, call it from Define()*/
+		inline void SetRunCasesInParallel(bool parallel) { _runCasesInParallel = parallel; };
+		inline bool CanRunCasesInParallel() const { return _runCasesInParallel; };
+
+		/*Declare the shared fixtures used by the class, a derived class hides it with its own static function. It is called when the run
+		starts, before the class is constructed*/
+		static inline void DeclareSharedFixtures(SharedFixtureUsers&) {};
+
+		/*Number of defined test cases*/
+		inline size_t GetNumTests() const { return _tests.size(); };
+
+		/*Stream attaching what is written to the failure messages of the test running on the calling thread, once destroyed*/
+		class FailureMessageStream
+		{
+		public:
+			explicit FailureMessageStream(AutomatedTestInstance& instance) : _instance(instance) {};
+			FailureMessageStream(FailureMessageStream&& other) : _instance(other._instance), _message(std::move(other._message)) {};
+			~FailureMessageStream()
+			{
+				const std::string message = _message.Str();
+				if (!message.empty())
+				{
+					_instance.AddFailureMessage(message);
+				}
+			};
+
+			template<class T>
+			inline FailureMessageStream& operator<<(const T& value)
+			{
+				_message << value;
+				return *this;
+			};
+
+		private:
+			AutomatedTestInstance& _instance;
+			MessageBuffer          _message;
+		};
+
+		/*Append to the failure messages of the test running on the calling thread, without a current case it goes to the log of the class*/
+		void AddFailureMessage(const std::string& message);
+
+		/*Get the failure messages written by the last run of a particular test by index*/
+		const std::string& GetFailureMessages(size_t index) const;
+
+		inline FailureMessageStream OutFailureMessage() { return FailureMessageStream(*this); };
+
+		inline std::string   GetLog() const { return _log.Str(); };
+		inline void          ResetLog() { _log.Stream().clear(); };
+		inline std::ostream& OutLog() { return _log.Stream(); };
+
+	private:
+		friend class AutomationTester;
+
+		/*Index of the running test while BeforeAll or AfterAll execute, assertions go to the class instead of a case*/
+		static constexpr signed int ClassHook = -2;
+
+		/*Index of the running test on a thread that isn't attached to a case, its failures fail the class*/
+		static constexpr signed int NoCurrentCase = -1;
+
+		/*The parameters of a TestCaseP run by one of its cases*/
+		struct DParameterChunk
+		{
+			std::string Name;
+			size_t      Begin;
+			size_t      End;
+			size_t      Case;
+			bool        FilterParameters; // Only the parameters selected by the filter run
+			bool        Matches;          // The filter matches the name of the case, its parameters run unless a negative pattern excludes them
+		};
+
+		/*The test case in execution on a thread, with the parameter when it's a chunk of TestCaseP*/
+		struct DRunningTest
+		{
+			const AutomatedTestInstance* Instance;
+			signed int                   Index;
+			const DParameterChunk*       Chunk;
+			size_t                       Parameter;
+			std::string*                 Messages; // Buffer of a thread attached to the case, nullptr on the thread running it
+		};
+
+		/*Failure flag of a case, set by any thread attached to it. Copyable so the flags can be stored in a vector*/
+		struct DFailureFlag
+		{
+			std::atomic<bool> Failed{};
+
+			DFailureFlag() = default;
+			DFailureFlag(const DFailureFlag& other) : Failed(other.Failed.load()){};
+			inline DFailureFlag& operator=(const DFailureFlag& other)
+			{
+				Failed = other.Failed.load();
+				return *this;
+			};
+			inline DFailureFlag& operator=(bool failed)
+			{
+				Failed = failed;
+				return *this;
+			};
+			inline operator bool() const { return Failed.load(); };
+		};
+
+		/*Messages of a thread attached to a case, merged in the messages of the case when it ends*/
+		struct DThreadMessages
+		{
+			size_t      Case;
+			std::string Messages;
+		};
+
+#if defined(BITTER_HAS_COROUTINES)
+		/*Coroutine function of an async case, started by every run of the case*/
+		class AsyncFunction
+		{
+		public:
+			virtual ~AsyncFunction() = default;
+
+			virtual Task<> Start() = 0;
+		};
+
+		template<class F>
+		class AsyncFunctionOf final : public AsyncFunction
+		{
+		public:
+			explicit AsyncFunctionOf(F function) : _function(std::move(function)){};
+
+			Task<> Start() override { return _function(); };
+
+		private:
+			F _function;
+		};
+#endif
+
+	public:
+		/*The case running on the calling thread, to attach the threads it starts to it*/
+		class TestContext
+		{
+		public:
+			TestContext() = default;
+
+		private:
+			friend class AutomatedTestInstance;
+			explicit TestContext(const DRunningTest& running) : _running(running){};
+			DRunningTest _running{ nullptr, -1, nullptr, 0, nullptr };
+		};
+
+		/*While alive the assertions of the calling thread are attributed to the case of the context: the failure flag is shared and the messages
+		are buffered by the thread then merged in the messages of the case. The attached threads must be joined before the case returns*/
+		class AttachedThread
+		{
+		public:
+			explicit AttachedThread(const TestContext& context) : _previous(CurrentThreadTest())
+			{
+				DRunningTest& running = CurrentThreadTest();
+				running               = context._running;
+				running.Messages      = &_messages;
+			};
+
+			~AttachedThread()
+			{
+				DRunningTest& running = CurrentThreadTest();
+				if (!_messages.empty() && running.Instance && running.Index >= 0)
+				{
+					AutomatedTestInstance&      instance = *const_cast<AutomatedTestInstance*>(running.Instance);
+					std::lock_guard<std::mutex> lock(instance._threadMessagesMutex);
+					instance._threadMessages.push_back({ static_cast<size_t>(running.Index), std::move(_messages) });
+				}
+				running = _previous;
+			};
+
+			AttachedThread(const AttachedThread&) = delete;
+			AttachedThread& operator=(const AttachedThread&) = delete;
+
+		private:
+			DRunningTest _previous;
+			std::string  _messages;
+		};
+
+		/*Context of the case running on the calling thread*/
+		TestContext GetTestContext() const;
+
+		/*Start a std::thread attached to the running case, the assertions of function count for the case*/
+		template<class F>
+		inline std::thread StartTestThread(F function)
+		{
+			return std::thread([context = GetTestContext(), function = std::move(function)]() mutable {
+				AttachedThread attached(context);
+				function();
+			});
+		};
+
+	private:
+
+		std::vector<DTestCase>                       _tests;
+		StringArena                                  _testNames;
+		std::vector<uint32_t>                        _testIndices; // Open addressing table of index + 1, 0 is an empty slot
+		std::vector<ETestStatus>                     _testStatus;
+		std::vector<DFailureFlag>                    _testFailed;
+		std::vector<std::chrono::nanoseconds>        _testDurations;
+		std::vector<std::string>                     _testMessages;
+		std::vector<std::chrono::nanoseconds>        _testTimeouts;
+		std::vector<DAllocationStats>                _testAllocations;
+		std::vector<DParameterChunk>                 _parameterChunks; // Sorted by case
+		std::vector<char>                            _asyncCompleted;
+#if defined(BITTER_HAS_COROUTINES)
+		std::unordered_map<size_t, std::unique_ptr<AsyncFunction>> _asyncCases;
+#endif
+		const TestFilter*                            _parameterFilter{}; // The filter selecting the parameters of TestCaseP, with the class it's applied to
+		std::string                                  _parameterFilterClass;
+		std::unordered_map<size_t, DBenchmarkResult> _benchmarkResults;
+		MessageBuffer                                _log;
+		std::mutex                                   _threadMessagesMutex; // Guards _threadMessages and _log from the attached threads
+		std::vector<DThreadMessages>                 _threadMessages;
+		std::vector<std::shared_ptr<void>>           _fixtureUsers; // Released once the class ended
+		std::atomic<bool>                            _unattachedFailed{};
+		size_t                                       _propertyTrials{ 100 };
+		uint64_t                                     _propertySeed{};
+		bool                                         _hasPropertySeed{};
+		unsigned int                                 _propertyThreads{};
+		bool                                         _runCasesInParallel{};
+		std::atomic<bool>                            _classHookFailed{};
+		bool                                         _classReady{ true };
+		bool                                         _defined{ true };
+		bool                                         _detectLeaks{};
+
+		/*The --seed and --trials of the run in progress*/
+		struct DPropertyOverrides
+		{
+			uint64_t Seed;
+			bool     HasSeed;
+			size_t   Trials; // Zero keeps the trials of the class
+		};
+
+		static DPropertyOverrides& PropertyOverrides();
+
+		static DRunningTest& CurrentThreadTest();
+
+		/*Mark as failed a test case that already ran*/
+		void FailTest(size_t index);
+
+		/*Fail the running test unless condition is true*/
+		inline bool Check(bool condition)
+		{
+			if (BITTER_UNLIKELY(!condition))
+			{
+				FailCurrentTest();
+			}
+			return condition;
+		};
+
+		/*Mark as failed the test case running on the calling thread*/
+		void FailCurrentTest();
+
+		/*Run BeforeAll or AfterAll on the calling thread, return false if it failed an assertion or threw*/
+		bool RunClassHook(void (AutomatedTestInstance::*hook)(), const char* hookName);
+
+#if defined(BITTER_HAS_COROUTINES)
+		/*Body of an async case run on its own, with its own event loop*/
+		void RunAsyncAlone(size_t index);
+
+		/*Fail an async case that threw or never completed*/
+		void FinishAsync(size_t index, Task<>& task);
+
+		/*Start every case right after its SetUp and resume them on one event loop until they complete or time out, the TearDown of a case runs
+		as soon as it finished. The allocations of a case are counted while it runs, apart from the resumes of the others*/
+		void RunAsyncBatch(const std::vector<size_t>& cases, std::chrono::nanoseconds defaultTimeout, const DAsyncWatch& watch);
+#endif
+
+		/*Fail a case that kept allocations alive when the leaks are detected*/
+		void CheckLeaks(size_t index);
+
+		void ReportSnapshotFailure(const MappedFile& golden, const std::string& filename, const void* data, size_t size, int line, const char* assertion);
+
+		/*Append the messages of the threads that were attached to a case, in the order they detached*/
+		void MergeThreadMessages(size_t index);
+
+		inline static std::string ParameterName(const DParameterChunk& chunk, size_t parameter) { return chunk.Name + "/" + std::to_string(parameter); };
+
+		/*The chunk of parameters run by a case, nullptr if it's not a case of TestCaseP*/
+		DParameterChunk* FindParameterChunk(size_t index);
+
+		/*True when the filter of the run selects a parameter of a chunk, defined with the filter*/
+		bool MatchesParameter(const DParameterChunk& chunk, size_t parameter) const;
+
+		/*Body of a case of TestCaseP, every parameter runs even after a failure and the failures are followed by the value of the parameter*/
+		template<class G, class F>
+		inline void RunParameters(const G& generator, F& function, size_t chunkPosition)
+		{
+			const DParameterChunk& chunk   = _parameterChunks[chunkPosition];
+			DRunningTest&          running = CurrentThreadTest();
+			const size_t           index   = static_cast<size_t>(running.Index);
+			generator.Visit(chunk.Begin, chunk.End, [&](size_t parameter, const typename G::Value& value) {
+				if (chunk.FilterParameters && !MatchesParameter(chunk, parameter))
+				{
+					return;
+				}
+				running.Chunk           = &chunk;
+				running.Parameter       = parameter;
+				const size_t messages   = _testMessages[index].size();
+				const bool   wasFailing = _testFailed[index] != 0;
+				try
+				{
+					function(value);
+				}
+				catch (const std::exception& exception)
+				{
+					FailCurrentTest();
+					AddFailureMessage(std::string("In:") + GetCurrentTestName() + " threw " + exception.what() + ENDLINE);
+				}
+				catch (...)
+				{
+					FailCurrentTest();
+					AddFailureMessage(std::string("In:") + GetCurrentTestName() + " threw" + ENDLINE);
+				}
+				if (_testMessages[index].size() != messages || (!wasFailing && _testFailed[index]))
+				{
+					MessageBuffer message;
+					message << "  with " << ParameterName(chunk, parameter) << " = ";
+					Formatter<typename G::Value>::Format(message.Stream(), value);
+					message << ENDLINE;
+					_testMessages[index] += message.Str();
+				}
+				running.Chunk = nullptr;
+			});
+		};
+
+		template<class T, size_t... I>
+		inline void DefineProperty(const std::string& name, T arguments, std::index_sequence<I...>)
+		{
+			using Arbitraries = std::tuple<typename std::tuple_element<I, T>::type...>;
+			using Predicate   = typename std::tuple_element<sizeof...(I), T>::type;
+			const auto arbitraries = std::make_shared<const Arbitraries>(std::get<I>(std::move(arguments))...);
+			const auto predicate   = std::make_shared<Predicate>(std::get<sizeof...(I)>(std::move(arguments)));
+			TestCase(name, [this, arbitraries, predicate]() { RunProperty(*arbitraries, *predicate, std::index_sequence<I...>()); });
+		};
+
+		/*Replace in turn each value of a counterexample by the candidates of its arbitrary*/
+		template<size_t K, class A, class V>
+		inline static void ShrinkValue(const A& arbitraries, const V& values, std::vector<V>& candidates)
+		{
+			std::vector<typename std::tuple_element<K, V>::type> smaller;
+			std::get<K>(arbitraries).Shrink(std::get<K>(values), smaller);
+			for (size_t i = 0; i < smaller.size(); i++)
+			{
+				candidates.push_back(values);
+				std::get<K>(candidates.back()) = smaller[i];
+			}
+		};
+
+		/*Body of a property case: the trials run until the first falsified one, then its values are shrunk while a candidate still falsifies*/
+		template<class A, class P, size_t... I>
+		inline void RunProperty(const A& arbitraries, P& predicate, std::index_sequence<I...>)
+		{
+			using Values = std::tuple<typename std::tuple_element<I, A>::type::Value...>;
+			constexpr size_t          maxSteps = 1000;
+			const DPropertyOverrides& run      = PropertyOverrides();
+			const uint64_t            seed     = run.HasSeed ? run.Seed : (_hasPropertySeed ? _propertySeed : NewSeed());
+			const size_t              trials   = run.Trials ? run.Trials : _propertyTrials;
+			const unsigned int        threads  = _propertyThreads ? _propertyThreads : std::max(1u, std::thread::hardware_concurrency());
+			const auto                generate = [&](size_t trial) {
+				Random random(Random::Stream(seed, trial));
+				return Values{ std::get<I>(arbitraries).Generate(random)... };
+			};
+			const auto falsifies = [&](const Values& values, std::string* error) {
+				try
+				{
+					return !static_cast<bool>(predicate(std::get<I>(values)...));
+				}
+				catch (const std::exception& exception)
+				{
+					if (error)
+					{
+						*error = exception.what();
+					}
+				}
+				catch (...)
+				{
+					if (error)
+					{
+						*error = "an unknown exception";
+					}
+				}
+				return true;
+			};
+
+			FirstIndexSearch search(static_cast<unsigned int>(std::min<size_t>(threads, trials)));
+			const size_t     falsified = search.Find(trials, [&](size_t trial) { return falsifies(generate(trial), nullptr); });
+			if (falsified == trials)
+			{
+				return;
+			}
+			Values counterexample = generate(falsified);
+			size_t steps          = 0;
+			for (std::vector<Values> candidates; steps < maxSteps; steps++)
+			{
+				candidates.clear();
+				const int expand[] = { 0, (ShrinkValue<I>(arbitraries, counterexample, candidates), 0)... };
+				(void)expand;
+				const size_t smaller = search.Find(candidates.size(), [&](size_t candidate) { return falsifies(candidates[candidate], nullptr); });
+				if (smaller == candidates.size())
+				{
+					break;
+				}
+				counterexample = std::move(candidates[smaller]);
+			}
+
+			std::string error;
+			falsifies(counterexample, &error);
+			MessageBuffer message;
+			message << "In:" << GetCurrentTestName() << " property falsified by trial " << falsified + 1 << " of " << trials << ", shrunk in " << steps
+					<< " steps, reproduce with --seed=" << seed << ENDLINE << "  counterexample: ";
+			Formatter<Values>::Format(message.Stream(), counterexample);
+			message << ENDLINE;
+			if (!error.empty())
+			{
+				message << "  threw " << error << ENDLINE;
+			}
+			FailCurrentTest();
+			AddFailureMessage(message.Str());
+		};
+
+		static uint64_t NewSeed();
+
+		/*Run Define, a throw fails the class and the cases defined before it fail without running*/
+		inline bool DefineCases() { return _defined = RunClassHook(&AutomatedTestInstance::Define, "Define"); };
+
+		/*Run BeforeAll before the first case of the class, if it or Define failed the cases fail without running*/
+		inline void BeginClass() { _classReady = _defined && RunClassHook(&AutomatedTestInstance::BeforeAll, "BeforeAll"); };
+
+		/*Run AfterAll once the last case completed, return false if it or BeforeAll failed or a thread not attached to a case failed an assertion.
+		The shared fixtures the class declared are then released*/
+		bool EndClass();
+
+		/*Fail a selected test case without running it because Define or BeforeAll failed*/
+		void FailWithoutRunning(size_t index);
+
+		void AddTestCase(const char* name, size_t nameSize, InlineFunction&& testFunc, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+		/*Keep the name table at most half full so probe sequences stay short*/
+		void GrowIndices(size_t count);
+
+		void InsertIndex(size_t index);
+	};
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+	/*Lets the runner watch the cases of a batch of async cases, a case blocking the event loop can't be cancelled at its timeout*/
+	struct AutomatedTestInstance::DAsyncWatch
+	{
+		std::function<uint64_t(size_t, std::chrono::nanoseconds)> Watch; // Case and timeout, returns the id passed to Unwatch
+		std::function<void(uint64_t)>                            Unwatch;
+	};
+
+	BITTER_API AutomatedTestInstance::AutomatedTestInstance() = default;
+
+	BITTER_API AutomatedTestInstance::~AutomatedTestInstance() = default;
+
+	BITTER_API void AutomatedTestInstance::ResetFlags()
+	{
+		std::fill(_testFailed.begin(), _testFailed.end(), false);
+		_unattachedFailed = false;
+	}
+
+	BITTER_API const char* AutomatedTestInstance::GetCurrentTestName() const
+	{
+		const signed int running = GetCurrentRunningTest();
+		const DRunningTest& current = CurrentThreadTest();
+		if (running >= 0 && current.Instance == this && current.Chunk)
+		{
+			// a parameter of TestCaseP, only named when a failure is reported
+			thread_local std::string name;
+			name = ParameterName(*current.Chunk, current.Parameter);
+			return name.c_str();
+		}
+		return running >= 0 ? _tests[running].Name : running == NoCurrentCase ? "<no current case>" : "";
+	}
+
+	BITTER_API void AutomatedTestInstance::ReportBufferFailure(int line, const char* assertion, const DBufferComparison& comparison, size_t count, const void* value, const void* expected)
+	{
+		ReportBufferFailure(line, assertion, comparison, count, static_cast<const uint8_t*>(value), static_cast<const uint8_t*>(expected));
+	}
+
+	BITTER_API bool AutomatedTestInstance::TestSnapshot(const std::string& name, const void* data, size_t size, int line, const char* assertion)
+	{
+		const DSnapshotOptions& options  = __snapshotOptions();
+		const std::string       filename = options.Directory.empty() ? name : options.Directory + "/" + name;
+		const std::string       actual   = filename + ".actual";
+		{
+			MappedFile golden(filename);
+			if (golden.IsOpen() && golden.Size() == size && CompareBuffers(golden.Data(), data, size).Matches())
+			{
+				std::remove(actual.c_str());
+				return true;
+			}
+			if (!options.Update)
+			{
+				ReportSnapshotFailure(golden, filename, data, size, line, assertion);
+				if (!__writeFileAtomically(actual, data, size))
+				{
+					AddFailureMessage("  could not write " + actual + ENDLINE);
+				}
+				return false;
+			}
+		}
+		if (!__writeFileAtomically(filename, data, size))
+		{
+			FailCurrentTest();
+			OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion << " could not update " << filename << ENDLINE;
+			return false;
+		}
+		std::remove(actual.c_str());
+		return true;
+	}
+
+	BITTER_API std::vector<std::string> AutomatedTestInstance::GetTestNames() const
+	{
+		std::vector<std::string> names;
+		names.reserve(_tests.size());
+		std::transform(_tests.begin(), _tests.end(), std::back_inserter(names), [](const DTestCase& test) { return std::string(test.Name, test.NameSize); });
+		return names;
+	}
+
+	BITTER_API const char* AutomatedTestInstance::GetTestName(size_t index) const
+	{
+		assert(index < _tests.size());
+		return _tests[index].Name;
+	}
+
+	BITTER_API bool AutomatedTestInstance::RunTest(const std::string& name)
+	{
+		const size_t found = FindTest(name);
+		assert(found != NotFound);
+		return RunTest(found);
+	}
+
+	BITTER_API bool AutomatedTestInstance::RunTest(size_t index)
+	{
+		assert(index < _tests.size());
+		if (index < _asyncCompleted.size() && _asyncCompleted[index])
+		{
+			// already run by RunAsyncTests
+			_asyncCompleted[index] = 0;
+			return !_testFailed[index];
+		}
+		DRunningTest&      running  = CurrentThreadTest();
+		const DRunningTest previous = running;
+		running                     = { this, static_cast<signed int>(index), nullptr, 0, nullptr };
+		_testFailed[index]          = 0;
+		_testMessages[index].clear();
+		const auto             start       = std::chrono::steady_clock::now();
+		const DAllocationStats allocations = __beginAllocationWindow();
+		try
+		{
+			SetUp();
+			if (!_testFailed[index])
+			{
+				_tests[index].DoWork();
+			}
+		}
+		catch (const std::exception& exception)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " threw " + exception.what() + ENDLINE);
+		}
+		catch (...)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " threw" + ENDLINE);
+		}
+		try
+		{
+			TearDown();
+		}
+		catch (const std::exception& exception)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " TearDown threw " + exception.what() + ENDLINE);
+		}
+		catch (...)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " TearDown threw" + ENDLINE);
+		}
+		_testAllocations[index] = __endAllocationWindow(allocations);
+		MergeThreadMessages(index);
+		CheckLeaks(index);
+		_testDurations[index] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		_testStatus[index]    = _testFailed[index] ? ETestStatus::FAILED : ETestStatus::PASSED;
+		running = previous;
+		return !_testFailed[index];
+	}
+
+	BITTER_API bool AutomatedTestInstance::RunAll()
+	{
+		size_t              passed{};
+		std::vector<size_t> all(_tests.size());
+		for (size_t i = 0; i < all.size(); i++)
+		{
+			all[i] = i;
+		}
+		RunAsyncTests(all, std::chrono::nanoseconds::zero(), {});
+		for (size_t i = 0; i < _tests.size(); i++)
+		{
+			passed += static_cast<size_t>(RunTest(i));
+		}
+
+		return (passed == _tests.size());
+	}
+
+	BITTER_API size_t AutomatedTestInstance::FindTest(const char* name, size_t size) const
+	{
+		if (_testIndices.empty())
+		{
+			return NotFound;
+		}
+		const size_t mask = _testIndices.size() - 1;
+		for (size_t slot = static_cast<size_t>(__hashString(name, size)) & mask;; slot = (slot + 1) & mask)
+		{
+			const uint32_t entry = _testIndices[slot];
+			if (entry == 0)
+			{
+				return NotFound;
+			}
+			const DTestCase& test = _tests[entry - 1];
+			if (test.NameSize == size && std::memcmp(test.Name, name, size) == 0)
+			{
+				return entry - 1;
+			}
+		}
+	}
+
+	BITTER_API ETestStatus AutomatedTestInstance::GetResult(const std::string& name) const
+	{
+		const size_t found = FindTest(name);
+		assert(found != NotFound);//Test name does not exists
+		return found != NotFound ? _testStatus[found] : ETestStatus::NOT_TESTED;
+	}
+
+	BITTER_API ETestStatus AutomatedTestInstance::GetResult(size_t index) const
+	{
+		assert(index < _testStatus.size());
+		return _testStatus[index];
+	}
+
+	BITTER_API std::chrono::nanoseconds AutomatedTestInstance::GetDuration(size_t index) const
+	{
+		assert(index < _testDurations.size());
+		return _testDurations[index];
+	}
+
+	BITTER_API void AutomatedTestInstance::RunAsyncTests(const std::vector<size_t>& selected, std::chrono::nanoseconds defaultTimeout, const DAsyncWatch& watch)
+	{
+#if defined(BITTER_HAS_COROUTINES)
+		if (!_runCasesInParallel || !_classReady)
+		{
+			return;
+		}
+		std::vector<size_t> cases;
+		for (const size_t index : selected)
+		{
+			if (_asyncCases.count(index) != 0)
+			{
+				cases.push_back(index);
+			}
+		}
+		if (cases.size() < 2)
+		{
+			return;
+		}
+		RunAsyncBatch(cases, defaultTimeout, watch);
+#else
+		(void)selected;
+		(void)defaultTimeout;
+		(void)watch;
+#endif
+	}
+
+	BITTER_API void AutomatedTestInstance::SetPropertySeed(uint64_t seed)
+	{
+		_propertySeed    = seed;
+		_hasPropertySeed = true;
+	}
+
+	BITTER_API std::chrono::nanoseconds AutomatedTestInstance::GetTimeout(size_t index) const
+	{
+		assert(index < _testTimeouts.size());
+		return _testTimeouts[index];
+	}
+
+	BITTER_API void AutomatedTestInstance::ReserveTests(size_t count)
+	{
+		_tests.reserve(count);
+		_testStatus.reserve(count);
+		_testFailed.reserve(count);
+		_testDurations.reserve(count);
+		_testMessages.reserve(count);
+		_testTimeouts.reserve(count);
+		_testAllocations.reserve(count);
+		GrowIndices(count);
+	}
+
+	BITTER_API const DBenchmarkResult* AutomatedTestInstance::GetBenchmarkResult(size_t index) const
+	{
+		const auto found = _benchmarkResults.find(index);
+		return found != _benchmarkResults.end() ? &found->second : nullptr;
+	}
+
+	BITTER_API signed int AutomatedTestInstance::GetCurrentRunningTest() const
+	{
+		const DRunningTest& running = CurrentThreadTest();
+		if (running.Instance == this)
+		{
+			return running.Index;
+		}
+		return NoCurrentCase;
+	}
+
+	BITTER_API bool AutomatedTestInstance::TestMaxAllocations(uint64_t allocations, uint64_t budget, int line, const char* assertion)
+	{
+#if defined(BITTER_SANITIZED)
+		(void)allocations;
+		(void)budget;
+		(void)line;
+		(void)assertion;
+#else
+		if (BITTER_UNLIKELY(!IsTrackingAllocations()))
+		{
+			FailCurrentTest();
+			OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion
+								<< " can't count the allocations, define BITTER_TRACK_ALLOCS in one translation unit" << ENDLINE;
+			return false;
+		}
+		if (BITTER_UNLIKELY(allocations > budget))
+		{
+			FailCurrentTest();
+			OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion << " made " << allocations
+								<< " allocations, at most " << budget << " were expected" << ENDLINE;
+			return false;
+		}
+#endif
+		return true;
+	}
+
+	BITTER_API const DAllocationStats& AutomatedTestInstance::GetAllocations(size_t index) const
+	{
+		assert(index < _testAllocations.size());
+		return _testAllocations[index];
+	}
+
+	BITTER_API void AutomatedTestInstance::AddFailureMessage(const std::string& message)
+	{
+		const DRunningTest& current = CurrentThreadTest();
+		const signed int    running = GetCurrentRunningTest();
+		if (current.Instance == this && current.Messages)
+		{
+			*current.Messages += message;
+		}
+		else if (running >= 0)
+		{
+			_testMessages[running] += message;
+		}
+		else
+		{
+			// a class hook, or a thread that isn't attached to a case and fails the class instead
+			std::lock_guard<std::mutex> lock(_threadMessagesMutex);
+			_log << message;
+		}
+	}
+
+	BITTER_API const std::string& AutomatedTestInstance::GetFailureMessages(size_t index) const
+	{
+		assert(index < _testMessages.size());
+		return _testMessages[index];
+	}
+
+	BITTER_API AutomatedTestInstance::TestContext AutomatedTestInstance::GetTestContext() const
+	{
+		const DRunningTest& running = CurrentThreadTest();
+		return running.Instance == this ? TestContext({ running.Instance, running.Index, running.Chunk, running.Parameter, nullptr }) : TestContext();
+	}
+
+	BITTER_API AutomatedTestInstance::DPropertyOverrides& AutomatedTestInstance::PropertyOverrides()
+	{
+		static DPropertyOverrides overrides{ 0, false, 0 };
+		return overrides;
+	}
+
+	BITTER_API AutomatedTestInstance::DRunningTest& AutomatedTestInstance::CurrentThreadTest()
+	{
+		thread_local DRunningTest running{ nullptr, -1, nullptr, 0, nullptr };
+		return running;
+	}
+
+	BITTER_API void AutomatedTestInstance::FailTest(size_t index)
+	{
+		_testFailed[index] = 1;
+		_testStatus[index] = ETestStatus::FAILED;
+	}
+
+	BITTER_API void AutomatedTestInstance::FailCurrentTest()
+	{
+		const signed int running = GetCurrentRunningTest();
+		if (running >= 0)
+		{
+			_testFailed[running] = 1;
+		}
+		else if (running == ClassHook)
+		{
+			_classHookFailed = true;
+		}
+		else
+		{
+			_unattachedFailed = true;
+		}
+	}
+
+	BITTER_API bool AutomatedTestInstance::RunClassHook(void (AutomatedTestInstance::*hook)(), const char* hookName)
+	{
+		DRunningTest&      running  = CurrentThreadTest();
+		const DRunningTest previous = running;
+		running                     = { this, ClassHook, nullptr, 0, nullptr };
+		_classHookFailed            = false;
+		try
+		{
+			(this->*hook)();
+		}
+		catch (const std::exception& exception)
+		{
+			_classHookFailed = true;
+			_log << hookName << " threw " << exception.what() << ENDLINE;
+		}
+		catch (...)
+		{
+			_classHookFailed = true;
+			_log << hookName << " threw" << ENDLINE;
+		}
+		running = previous;
+		return !_classHookFailed;
+	}
+
+#if defined(BITTER_HAS_COROUTINES)
+	BITTER_API void AutomatedTestInstance::RunAsyncAlone(size_t index)
+	{
+		EventLoop  loop;
+		EventLoop* previous = std::exchange(EventLoop::Current(), &loop);
+		Task<>     task     = _asyncCases.at(index)->Start();
+		const auto never    = std::chrono::steady_clock::time_point::max();
+		EventLoop::CurrentTag() = index;
+		loop.Schedule(task.GetHandle());
+		while (!task.IsDone() && loop.RunOnce(never, [](size_t, std::coroutine_handle<> handle) { handle.resume(); }))
+		{
+		}
+		EventLoop::Current() = previous;
+		FinishAsync(index, task);
+	}
+
+	BITTER_API void AutomatedTestInstance::FinishAsync(size_t index, Task<>& task)
+	{
+		if (!task.IsDone())
+		{
+			task.Reset();
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " is suspended on nothing that can resume it" + ENDLINE);
+			return;
+		}
+		try
+		{
+			task.await_resume();
+		}
+		catch (const std::exception& exception)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " threw " + exception.what() + ENDLINE);
+		}
+		catch (...)
+		{
+			FailCurrentTest();
+			AddFailureMessage("In:" + std::string(_tests[index].Name) + " threw" + ENDLINE);
+		}
+	}
+
+	BITTER_API void AutomatedTestInstance::RunAsyncBatch(const std::vector<size_t>& cases, std::chrono::nanoseconds defaultTimeout, const DAsyncWatch& watch)
+	{
+		struct DInFlight
+		{
+			size_t                                Index;
+			Task<>                                Coroutine;
+			std::chrono::steady_clock::time_point Start;
+			std::chrono::steady_clock::time_point Deadline;
+			uint64_t                              Watched; // 0 if not watched
+			bool                                  Finished;
+		};
+
+		EventLoop              loop;
+		EventLoop*             previousLoop = std::exchange(EventLoop::Current(), &loop);
+		DRunningTest&          running      = CurrentThreadTest();
+		const DRunningTest     previous     = running;
+		std::vector<DInFlight> inFlight;
+		std::vector<size_t>    slots(_tests.size()); // Position in inFlight by the index of the case
+		inFlight.reserve(cases.size());
+		loop.Reserve(cases.size());
+		_asyncCompleted.assign(_tests.size(), 0);
+
+		const auto inCase = [&](size_t index, const auto& work) {
+			running                            = { this, static_cast<signed int>(index), nullptr, 0, nullptr };
+			const DAllocationStats allocations = __beginAllocationWindow();
+			work();
+			__addAllocationWindow(_testAllocations[index], __endAllocationWindow(allocations));
+		};
+
+		const auto finish = [&](DInFlight& flight) {
+			const size_t index = flight.Index;
+			inCase(index, [&]() {
+				if (flight.Coroutine.GetHandle())
+				{
+					FinishAsync(index, flight.Coroutine);
+				}
+				loop.Cancel(index);
+				flight.Coroutine.Reset();
+				try
+				{
+					TearDown();
+				}
+				catch (...)
+				{
+					_testFailed[index] = true;
+				}
+			});
+			if (flight.Watched != 0)
+			{
+				watch.Unwatch(flight.Watched);
+			}
+			MergeThreadMessages(index);
+			CheckLeaks(index);
+			_testDurations[index]  = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flight.Start);
+			_testStatus[index]     = _testFailed[index] ? ETestStatus::FAILED : ETestStatus::PASSED;
+			_asyncCompleted[index] = 1;
+			flight.Finished        = true;
+		};
+
+		for (const size_t index : cases)
+		{
+			_testFailed[index] = false;
+			_testMessages[index].clear();
+			_testAllocations[index]                = {};
+			const auto                     start   = std::chrono::steady_clock::now();
+			const std::chrono::nanoseconds timeout = _testTimeouts[index] > std::chrono::nanoseconds::zero() ? _testTimeouts[index] : defaultTimeout;
+			const bool                     timed   = timeout > std::chrono::nanoseconds::zero();
+			slots[index] = inFlight.size();
+			inFlight.push_back({ index, Task<>(nullptr), start, timed ? start + timeout : std::chrono::steady_clock::time_point::max(), 0, false });
+			DInFlight& flight = inFlight.back();
+			if (timed && watch.Watch)
+			{
+				flight.Watched = watch.Watch(index, timeout);
+			}
+			inCase(index, [&]() {
+				try
+				{
+					SetUp();
+					if (!_testFailed[index])
+					{
+						// runs until it first suspends, before the SetUp of the next case
+						flight.Coroutine        = _asyncCases.at(index)->Start();
+						EventLoop::CurrentTag() = index;
+						flight.Coroutine.GetHandle().resume();
+					}
+				}
+				catch (...)
+				{
+					_testFailed[index] = true;
+				}
+			});
+			if (!flight.Coroutine.GetHandle() || flight.Coroutine.IsDone())
+			{
+				finish(flight);
+			}
+		}
+
+		for (size_t remaining = cases.size(); remaining > 0;)
+		{
+			auto until = std::chrono::steady_clock::time_point::max();
+			for (const DInFlight& flight : inFlight)
+			{
+				until = flight.Finished ? until : std::min(until, flight.Deadline);
+			}
+			// a case completing is finished before the next one is resumed, even when they were ready together
+			const bool pending = loop.RunOnce(until, [&](size_t tag, std::coroutine_handle<> handle) {
+				inCase(tag, [handle]() { handle.resume(); });
+				DInFlight& flight = inFlight[slots[tag]];
+				if (!flight.Finished && flight.Coroutine.IsDone())
+				{
+					finish(flight);
+				}
+			});
+			const auto now     = std::chrono::steady_clock::now();
+			remaining          = 0;
+			for (DInFlight& flight : inFlight)
+			{
+				if (flight.Finished)
+				{
+					continue;
+				}
+				if (!flight.Coroutine.IsDone() && now >= flight.Deadline)
+				{
+					inCase(flight.Index, [&]() {
+						loop.Cancel(flight.Index);
+						flight.Coroutine.Reset();
+						FailCurrentTest();
+						std::ostringstream message;
+						message << "In:" << _tests[flight.Index].Name << " timed out after ";
+						message << std::fixed << std::setprecision(3) << static_cast<double>((now - flight.Start).count()) / 1e6 << "ms" << ENDLINE;
+						AddFailureMessage(message.str());
+					});
+				}
+				if (flight.Coroutine.IsDone() || !pending)
+				{
+					finish(flight);
+					continue;
+				}
+				remaining++;
+			}
+		}
+		running              = previous;
+		EventLoop::Current() = previousLoop;
+	}
+#endif
+
+	BITTER_API void AutomatedTestInstance::CheckLeaks(size_t index)
+	{
+		if (_detectLeaks && _testAllocations[index].Live > 0 && IsTrackingAllocations())
+		{
+			_testFailed[index] = 1;
+			std::ostringstream message;
+			message << "In:" << _tests[index].Name << " leaked " << _testAllocations[index].Live << " bytes, "
+					<< _testAllocations[index].Allocations - _testAllocations[index].Frees << " allocations were not freed" << ENDLINE;
+			_testMessages[index] += message.str();
+		}
+	}
+
+	BITTER_NOINLINE BITTER_API void AutomatedTestInstance::ReportSnapshotFailure(const MappedFile& golden, const std::string& filename, const void* data, size_t size, int line, const char* assertion)
+	{
+		FailCurrentTest();
+		std::ostringstream message;
+		message << "In:" << GetCurrentTestName() << "[line " << line << "] " << assertion;
+		if (!golden.IsOpen())
+		{
+			message << " no snapshot " << filename << ", --update-snapshots creates it";
+		}
+		else
+		{
+			const size_t            common     = std::min(size, golden.Size());
+			const DBufferComparison comparison = CompareBuffers(data, golden.Data(), common);
+			message << " differs from " << filename;
+			if (golden.Size() != size)
+			{
+				message << ", " << size << " bytes against " << golden.Size();
+			}
+			if (!comparison.Matches())
+			{
+				const auto flags = message.flags();
+				message << ", " << comparison.NumMismatches << " of " << common << " bytes differ, the first at offset " << comparison.FirstMismatch << std::hex
+						<< " 0x" << +static_cast<const uint8_t*>(data)[comparison.FirstMismatch] << " vs 0x" << +golden.Data()[comparison.FirstMismatch];
+				message.flags(flags);
+			}
+		}
+		message << ", the output is in " << filename << ".actual" << ENDLINE;
+		AddFailureMessage(message.str());
+	}
+
+	BITTER_API void AutomatedTestInstance::MergeThreadMessages(size_t index)
+	{
+		std::lock_guard<std::mutex> lock(_threadMessagesMutex);
+		if (_threadMessages.empty())
+		{
+			return;
+		}
+		for (const DThreadMessages& messages : _threadMessages)
+		{
+			if (messages.Case == index)
+			{
+				_testMessages[index] += messages.Messages;
+			}
+		}
+		_threadMessages.erase(std::remove_if(_threadMessages.begin(), _threadMessages.end(), [index](const DThreadMessages& messages) { return messages.Case == index; }),
+							  _threadMessages.end());
+	}
+
+	BITTER_API AutomatedTestInstance::DParameterChunk* AutomatedTestInstance::FindParameterChunk(size_t index)
+	{
+		const auto found = std::lower_bound(_parameterChunks.begin(), _parameterChunks.end(), index, [](const DParameterChunk& chunk, size_t i) { return chunk.Case < i; });
+		return found != _parameterChunks.end() && found->Case == index ? &*found : nullptr;
+	}
+
+	BITTER_API uint64_t AutomatedTestInstance::NewSeed()
+	{
+		static std::atomic<uint64_t> counter{};
+		return Random(static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^ (counter++ << 32)).Next();
+	}
+
+	BITTER_API bool AutomatedTestInstance::EndClass()
+	{
+		const bool passed = _classReady && RunClassHook(&AutomatedTestInstance::AfterAll, "AfterAll") && !_unattachedFailed;
+		_fixtureUsers.clear();
+		return passed;
+	}
+
+	BITTER_API void AutomatedTestInstance::FailWithoutRunning(size_t index)
+	{
+		_testMessages[index] = std::string("In:") + _tests[index].Name + (_defined ? " BeforeAll" : " Define") + " of the class failed" + ENDLINE;
+		_testDurations[index] = std::chrono::nanoseconds::zero();
+		FailTest(index);
+	}
+
+	BITTER_API void AutomatedTestInstance::AddTestCase(const char* name, size_t nameSize, InlineFunction&& testFunc, std::chrono::nanoseconds timeout)
+	{
+		assert(_tests.size() < static_cast<size_t>(std::numeric_limits<signed int>().max()));
+		// check that does not exists with same name
+		assert(FindTest(name, nameSize) == NotFound);
+		try
+		{
+			GrowIndices(_tests.size() + 1);
+			_tests.emplace_back(_testNames.Store(name, nameSize), nameSize, std::move(testFunc));
+			InsertIndex(_tests.size() - 1);
+			_testStatus.push_back(ETestStatus::NOT_TESTED);
+			_testFailed.emplace_back();
+			_testDurations.push_back(std::chrono::nanoseconds::zero());
+			_testMessages.emplace_back();
+			_testTimeouts.push_back(timeout);
+			_testAllocations.push_back({});
+		}
+		catch (...)
+		{
+			assert(0); // Failed to allocate test case
+		}
+	}
+
+	BITTER_API void AutomatedTestInstance::GrowIndices(size_t count)
+	{
+		if (count * 2 <= _testIndices.size())
+		{
+			return;
+		}
+		size_t capacity = std::max<size_t>(_testIndices.size(), 16);
+		while (capacity < count * 2)
+		{
+			capacity *= 2;
+		}
+		_testIndices.assign(capacity, 0);
+		for (size_t i = 0; i < _tests.size(); i++)
+		{
+			InsertIndex(i);
+		}
+	}
+
+	BITTER_API void AutomatedTestInstance::InsertIndex(size_t index)
+	{
+		const size_t mask = _testIndices.size() - 1;
+		size_t       slot = static_cast<size_t>(__hashString(_tests[index].Name, _tests[index].NameSize)) & mask;
+		while (_testIndices[slot] != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+		_testIndices[slot] = static_cast<uint32_t>(index + 1);
+	}
+#endif
+
+	template<class T>
+	inline AutomatedTestInstance* __createTestInstance()
+	{
+		return new T;
+	}
+
+	/*Node of the intrusive list of the statically registered classes, TEST_DEFINE_CLASS defines one as a constant initialized global.
+	Registering a class doesn't allocate, the list is only sorted when a run starts*/
+	struct DTestRegistration
+	{
+		const char* Name;
+		AutomatedTestInstance* (*Create)(void);
+		void (*DeclareFixtures)(SharedFixtureUsers&);
+		DTestRegistration* Next;
+	};
+
+	/*Head of the intrusive list, a constant initialized pointer that is valid whatever the static initialization order is*/
+	inline DTestRegistration*& __testRegistryHead()
+	{
+		static DTestRegistration* head = nullptr;
+		return head;
+	}
+
+	/*Links a registration node to the list, it only writes two pointers*/
+	class TestRegistrar
+	{
+	public:
+		explicit TestRegistrar(DTestRegistration& registration) noexcept
+		{
+			registration.Next    = __testRegistryHead();
+			__testRegistryHead() = &registration;
+		};
+
+		/*Removes a node that is destroyed before the end of the program*/
+		static inline void Unlink(DTestRegistration& registration) noexcept
+		{
+			for (DTestRegistration** link = &__testRegistryHead(); *link; link = &(*link)->Next)
+			{
+				if (*link == &registration)
+				{
+					*link = registration.Next;
+					return;
+				}
+			}
+		};
+	};
+
+	/*Add a class to the singleton tester under a name known at run time, defined with the runner*/
+	BITTER_API void __addTestClass(const std::string& className, AutomatedTestInstance* (*create)(void), void (*declareFixtures)(SharedFixtureUsers&));
+
+#if defined(BITTER_HAS_IMPLEMENTATION)
+
+	/*Options parsed from the command line of the test executable*/
+	struct DRunOptions
+	{
+		std::string              LogFilename;
+		unsigned int             Jobs{ 1 };
+		bool                     ParallelCases{};
+		std::string              BenchmarkBaseline;
+		std::string              BenchmarkSave;
+		double                   BenchmarkTolerance{ 10. }; // Percent of the baseline median
+		double                   BenchmarkSignificance{ 0.05 };
+		unsigned int             Slowest{ 10 }; // Number of cases and classes in the slowest summary
+		std::string              JUnitFilename;
+		std::string              JsonLinesFilename;
+		std::string              TelemetryFilename;
+		std::string              Filter;
+		std::string              FilterRegex;
+		std::chrono::nanoseconds Timeout{}; // Zero waits forever
+		bool                     Isolate{};
+		unsigned int             ShardIndex{};
+		unsigned int             ShardCount{ 1 };
+		bool                     ShardBalance{};
+		std::string              Durations;
+		std::string              DurationsSave;
+		std::string              ResultsFilename;
+		bool                     RerunFailed{};
+		bool                     UseCache{};
+		uint64_t                 Seed{};
+		bool                     HasSeed{};
+		size_t                   Trials{}; // Zero keeps the trials of the classes
+		uint64_t                 Repeat{}; // Iterations of a soak run, zero without --repeat
+		std::chrono::nanoseconds SoakDuration{};
+		unsigned int             Concurrency{ 1 };
+		bool                     Shuffle{};
+		std::string              SnapshotDirectory{ "snapshots" };
+		bool                     UpdateSnapshots{};
+	};
+
+	/*Selects the test cases to run by their Class.Case name.
+	The glob filter is a list of patterns separated by ':' where '*' matches any text and '?' one character,
+	the patterns after a '-' exclude the cases they match. The regex filter is searched in the name*/
+	class TestFilter
+	{
+	public:
+		TestFilter() = default;
+		TestFilter(const std::string& glob, const std::string& regex)
+		{
+			bool        negative = false;
+			std::string pattern;
+			for (size_t i = 0; i <= glob.size(); i++)
+			{
+				const char c = i < glob.size() ? glob[i] : ':';
+				if (c == ':' || (c == '-' && !negative))
+				{
+					if (!pattern.empty())
+					{
+						(negative ? _negative : _positive).push_back(pattern);
+					}
+					pattern.clear();
+					negative = negative || c == '-';
+					continue;
+				}
+				pattern += c;
+			}
+			if (!regex.empty())
+			{
+				_hasRegex = true;
+				_regex    = std::regex(regex);
+			}
+		};
+
+		inline bool IsActive() const { return !_positive.empty() || !_negative.empty() || _hasRegex; };
+
+		/*Returns false when no case of the class can be selected, the class doesn't need to be constructed*/
+		inline bool MayMatchClass(const std::string& className) const
+		{
+			const std::string prefix = className + ".";
+			for (const std::string& pattern : _negative)
+			{
+				// Class.* excludes the whole class
+				if (pattern.size() > 2 && pattern.compare(pattern.size() - 2, 2, ".*") == 0 && GlobMatch(pattern.substr(0, pattern.size() - 2), className, false))
+				{
+					return false;
+				}
+			}
+			if (_positive.empty())
+			{
+				return true;
+			}
+			return std::any_of(_positive.begin(), _positive.end(), [&prefix](const std::string& pattern) { return GlobMatch(pattern, prefix, true); });
+		};
+
+		inline bool HasNegative() const { return !_negative.empty(); };
+
+		/*True when a negative pattern matches the case*/
+		inline bool Excludes(const std::string& className, const std::string& caseName) const
+		{
+			const std::string name = className + "." + caseName;
+			return std::any_of(_negative.begin(), _negative.end(), [&name](const std::string& pattern) { return GlobMatch(pattern, name, false); });
+		};
+
+		/*Returns false when no case whose name starts with prefix can match*/
+		inline bool MayMatchCasePrefix(const std::string& className, const std::string& prefix) const
+		{
+			const std::string name = className + "." + prefix;
+			return _hasRegex || _positive.empty() ||
+				   std::any_of(_positive.begin(), _positive.end(), [&name](const std::string& pattern) { return GlobMatch(pattern, name, true); });
+		};
+
+		inline bool MatchesCase(const std::string& className, const std::string& caseName) const
+		{
+			const std::string name = className + "." + caseName;
+			if (!_positive.empty() && std::none_of(_positive.begin(), _positive.end(), [&name](const std::string& pattern) { return GlobMatch(pattern, name, false); }))
+			{
+				return false;
+			}
+			if (std::any_of(_negative.begin(), _negative.end(), [&name](const std::string& pattern) { return GlobMatch(pattern, name, false); }))
+			{
+				return false;
+			}
+			return !_hasRegex || std::regex_search(name, _regex);
+		};
+
+		/*Matches text against the glob pattern, with prefixOnly it's enough that the text is the beginning of a matching string*/
+		inline static bool GlobMatch(const std::string& pattern, const std::string& text, bool prefixOnly)
+		{
+			// Simulate the pattern as an automaton, states are the pattern positions reachable after consuming the text so far
+			std::vector<char> states(pattern.size() + 1), next(pattern.size() + 1);
+			const auto        closure = [&pattern](std::vector<char>& reachable) {
+				for (size_t i = 0; i < pattern.size(); i++)
+				{
+					if (reachable[i] && pattern[i] == '*')
+					{
+						reachable[i + 1] = 1;
+					}
+				}
+			};
+			states[0] = 1;
+			closure(states);
+			for (const char c : text)
+			{
+				std::fill(next.begin(), next.end(), static_cast<char>(0));
+				bool any = false;
+				for (size_t i = 0; i < pattern.size(); i++)
+				{
+					if (!states[i])
+					{
+						continue;
+					}
+					if (pattern[i] == '*')
+					{
+						next[i] = 1;
+						any     = true;
+					}
+					else if (pattern[i] == '?' || pattern[i] == c)
+					{
+						next[i + 1] = 1;
+						any         = true;
+					}
+				}
+				if (!any)
+				{
+					return false;
+				}
+				closure(next);
+				states.swap(next);
+			}
+			return prefixOnly ? std::find(states.begin(), states.end(), 1) != states.end() : states[pattern.size()] != 0;
+		};
+
+	private:
+		std::vector<std::string> _positive;
+		std::vector<std::string> _negative;
+		bool                     _hasRegex{};
+		std::regex               _regex;
+	};
+
+	BITTER_API bool AutomatedTestInstance::MatchesParameter(const DParameterChunk& chunk, size_t parameter) const
+	{
+		const std::string name = ParameterName(chunk, parameter);
+		return chunk.Matches ? !_parameterFilter->Excludes(_parameterFilterClass, name) : _parameterFilter->MatchesCase(_parameterFilterClass, name);
+	}
+
+	/*Previous measurements of a benchmark case*/
+	struct DBenchmarkBaseline
+	{
+		double              Median{};
+		std::vector<double> Samples;
+		DHardwareCounters   Counters;
+	};
+
+	/*Pool of worker threads where each worker owns a deque of tasks, an idle worker steals tasks from the other deques*/
+	class TaskScheduler
+	{
+	public:
+		explicit TaskScheduler(unsigned int numThreads) : _queues(std::max(1u, numThreads))
+		{
+			_workers.reserve(_queues.size());
+			for (size_t i = 0; i < _queues.size(); i++)
+			{
+				_workers.emplace_back([this, i]() { WorkerLoop(i); });
+			}
+		};
+
+		~TaskScheduler()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wakeUp.notify_all();
+			for (auto& worker : _workers)
+			{
+				worker.join();
+			}
+		};
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		/*Queue a task, when called from one of the workers it goes on the worker's own deque.
+		The task is counted before it's published, a worker popping it right away never takes the count below zero*/
+		inline void Submit(std::function<void(void)> task)
+		{
+			const DWorkerId& current = CurrentWorker();
+			const size_t     queue   = current.Scheduler == this ? current.Index : (_nextQueue++ % _queues.size());
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending++;
+			}
+			{
+				std::lock_guard<std::mutex> lock(_queues[queue].Mutex);
+				_queues[queue].Tasks.push_back(std::move(task));
+			}
+			_wakeUp.notify_one();
+		};
+
+		/*Queue tasks that should start in the given order, they are dealt to the deques so their owners pop the first tasks first.
+		From a worker they all go on its own deque*/
+		inline void SubmitBatch(std::vector<std::function<void(void)>> tasks)
+		{
+			const DWorkerId& current = CurrentWorker();
+			const size_t     first   = current.Scheduler == this ? current.Index : (_nextQueue.fetch_add(tasks.size()) % _queues.size());
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending += tasks.size();
+			}
+			for (size_t k = tasks.size(); k-- > 0;)
+			{
+				const size_t                queue = current.Scheduler == this ? first : (first + k) % _queues.size();
+				std::lock_guard<std::mutex> lock(_queues[queue].Mutex);
+				_queues[queue].Tasks.push_back(std::move(tasks[k]));
+			}
+			_wakeUp.notify_all();
+		};
+
+	private:
+		struct DWorkerQueue
+		{
+			std::mutex                            Mutex;
+			std::deque<std::function<void(void)>> Tasks;
+		};
+
+		struct DWorkerId
+		{
+			const TaskScheduler* Scheduler;
+			size_t               Index;
+		};
+
+		std::vector<DWorkerQueue> _queues;
+		std::vector<std::thread>  _workers;
+		std::atomic<size_t>       _nextQueue{};
+		std::mutex                _mutex;
+		std::condition_variable   _wakeUp;
+		size_t                    _pending{}; // Tasks queued or about to be, a worker seeing it ahead of the deques retries
+		bool                      _stopping{};
+
+		inline static DWorkerId& CurrentWorker()
+		{
+			thread_local DWorkerId worker{ nullptr, 0 };
+			return worker;
+		};
+
+		/*The owner works on the newest task of its deque, keeping the tasks it spawned hot in cache*/
+		inline bool PopLocal(size_t index, std::function<void(void)>& task)
+		{
+			std::lock_guard<std::mutex> lock(_queues[index].Mutex);
+			if (_queues[index].Tasks.empty())
+			{
+				return false;
+			}
+			task = std::move(_queues[index].Tasks.back());
+			_queues[index].Tasks.pop_back();
+			return true;
+		};
+
+		/*Thieves take the oldest task from the other deques*/
+		inline bool Steal(size_t index, std::function<void(void)>& task)
+		{
+			for (size_t i = 1; i < _queues.size(); i++)
+			{
+				DWorkerQueue&               victim = _queues[(index + i) % _queues.size()];
+				std::lock_guard<std::mutex> lock(victim.Mutex);
+				if (!victim.Tasks.empty())
+				{
+					task = std::move(victim.Tasks.front());
+					victim.Tasks.pop_front();
+					return true;
+				}
+			}
+			return false;
+		};
+
+		inline void WorkerLoop(size_t index)
+		{
+			CurrentWorker() = { this, index };
+			for (;;)
+			{
+				std::function<void(void)> task;
+				if (PopLocal(index, task) || Steal(index, task))
+				{
+					{
+						std::lock_guard<std::mutex> lock(_mutex);
+						_pending--;
+					}
+					task();
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wakeUp.wait(lock, [this]() { return _stopping || _pending > 0; });
+				if (_stopping && _pending == 0)
+				{
+					return;
+				}
+			}
+		};
+	};
+
+	/*Thread waiting for the deadlines of the running test cases, the handler is called from the watchdog thread for every case that
+	is still running when its deadline expires. The thread is started by the first watched case*/
+	class Watchdog
+	{
+	public:
+		struct DWatchedCase
+		{
+			const std::string*       ClassName;
+			AutomatedTestInstance*   Instance;
+			size_t                   Index;
+			std::chrono::nanoseconds Timeout;
+		};
+
+		explicit Watchdog(std::function<void(const DWatchedCase&)> onTimeout) : _onTimeout(std::move(onTimeout)) {};
+
+		~Watchdog()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wakeUp.notify_all();
+			if (_thread.joinable())
+			{
+				_thread.join();
+			}
+		};
+
+		Watchdog(const Watchdog&) = delete;
+		Watchdog& operator=(const Watchdog&) = delete;
+
+		/*Start watching a case, returns the id to pass to Unwatch once it completed. The handler is called after the timeout and the grace*/
+		inline uint64_t Watch(const DWatchedCase& watched, std::chrono::nanoseconds grace = std::chrono::nanoseconds::zero())
+		{
+			uint64_t id;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				id = ++_lastId;
+				_watched.emplace(id, DEntry{ watched, std::chrono::steady_clock::now() + watched.Timeout + grace });
+				if (!_thread.joinable())
+				{
+					_thread = std::thread([this]() { WatchLoop(); });
+				}
+			}
+			_wakeUp.notify_one();
+			return id;
+		};
+
+		inline void Unwatch(uint64_t id)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_watched.erase(id);
+		};
+
+	private:
+		struct DEntry
+		{
+			DWatchedCase                          Case;
+			std::chrono::steady_clock::time_point Deadline;
+		};
+
+		std::function<void(const DWatchedCase&)> _onTimeout;
+		std::unordered_map<uint64_t, DEntry>      _watched;
+		std::mutex                               _mutex;
+		std::condition_variable                  _wakeUp;
+		std::thread                              _thread;
+		uint64_t                                 _lastId{};
+		bool                                     _stopping{};
+
+		inline void WatchLoop()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_stopping)
+			{
+				// few cases run at the same time, a linear search of the earliest deadline is enough
+				auto earliest = _watched.end();
+				for (auto it = _watched.begin(); it != _watched.end(); ++it)
+				{
+					if (earliest == _watched.end() || it->second.Deadline < earliest->second.Deadline)
+					{
+						earliest = it;
+					}
+				}
+				if (earliest == _watched.end())
+				{
+					_wakeUp.wait(lock);
+					continue;
+				}
+				if (std::chrono::steady_clock::now() < earliest->second.Deadline)
+				{
+					_wakeUp.wait_until(lock, earliest->second.Deadline);
+					continue;
+				}
+				const DWatchedCase expired = earliest->second.Case;
+				_watched.erase(earliest);
+				lock.unlock();
+				_onTimeout(expired);
+				lock.lock();
+			}
+		};
+	};
+
+	/*Layout of the --telemetry file. The run keeps it mapped and updates it with relaxed atomics, a monitor maps the same file and polls it.
+	The case of a worker is guarded by its sequence, odd while the worker writes it*/
+	struct DTelemetryBlock
+	{
+		static constexpr uint64_t ExpectedSignature = 0x314d4c5452544942; // "BITRTLM1"
+		static constexpr size_t   MaxWorkers        = 64;
+		static constexpr size_t   NameWords         = 16;
+
+		struct DWorker
+		{
+			std::atomic<uint32_t> Sequence;
+			std::atomic<int64_t>  Started; // Nanoseconds since the start of the run, 0 when idle
+			std::atomic<uint64_t> Name[NameWords];
+		};
+
+		std::atomic<uint64_t> Signature;
+		std::atomic<uint32_t> Running;
+		std::atomic<uint32_t> Workers;
+		std::atomic<uint64_t> Cases;
+		std::atomic<uint64_t> Passed;
+		std::atomic<uint64_t> Failed;
+		std::atomic<int64_t>  Elapsed;
+		std::atomic<uint64_t> PeakRss;
+		DWorker               Worker[MaxWorkers];
+	};
+
+	/*Consistent copy of a telemetry block, the remaining cases are those scheduled minus those completed*/
+	struct DTelemetrySnapshot
+	{
+		struct DWorkerStatus
+		{
+			std::string              Case; // Empty when the worker is idle
+			std::chrono::nanoseconds Running{};
+		};
+
+		bool                       Running{};
+		uint64_t                   Cases{};
+		uint64_t                   Passed{};
+		uint64_t                   Failed{};
+		uint64_t                   Remaining{};
+		std::chrono::nanoseconds   Elapsed{};
+		uint64_t                   PeakRss{};
+		std::vector<DWorkerStatus> Workers;
+	};
+
+	/*Publishes the progress of a run in a memory mapped file. The case threads only do relaxed atomic stores, a background thread updates
+	the elapsed time and the peak resident memory every 100ms. The forked workers of --isolate share the mapping*/
+	class Telemetry
+	{
+	public:
+		Telemetry() = default;
+
+		~Telemetry() { Close(); };
+
+		Telemetry(const Telemetry&) = delete;
+		Telemetry& operator=(const Telemetry&) = delete;
+
+		/*Create or truncate the file and map the block, returns false when the file can't be mapped*/
+		inline bool Open(const std::string& filename)
+		{
+#if defined(BITTER_HAS_FORK)
+			const int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0)
+			{
+				return false;
+			}
+			void* mapped = MAP_FAILED;
+			if (::ftruncate(fd, sizeof(DTelemetryBlock)) == 0)
+			{
+				mapped = ::mmap(nullptr, sizeof(DTelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			::close(fd);
+			if (mapped == MAP_FAILED)
+			{
+				return false;
+			}
+			_block      = new (mapped) DTelemetryBlock();
+			_start      = std::chrono::steady_clock::now();
+			_generation = ++Generations();
+			_block->Running.store(1, std::memory_order_relaxed);
+			_block->Signature.store(DTelemetryBlock::ExpectedSignature, std::memory_order_release);
+			_thread = std::thread([this]() {
+				std::unique_lock<std::mutex> lock(_mutex);
+				while (!_wakeUp.wait_for(lock, std::chrono::milliseconds(100), [this]() { return _stopping; }))
+				{
+					UpdateUsage();
+				}
+			});
+			return true;
+#else
+			(void)filename;
+			return false;
+#endif
+		};
+
+		/*Mark the run as ended and unmap the block, the file keeps the final counters*/
+		inline void Close()
+		{
+			if (!_block)
+			{
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wakeUp.notify_all();
+			if (_thread.joinable())
+			{
+				_thread.join();
+			}
+			UpdateUsage();
+			_block->Running.store(0, std::memory_order_release);
+#if defined(BITTER_HAS_FORK)
+			::munmap(_block, sizeof(DTelemetryBlock));
+#endif
+			_block = nullptr;
+		};
+
+		inline void AddCases(size_t count) { _block->Cases.fetch_add(count, std::memory_order_relaxed); };
+
+		/*Publish the case of the calling thread*/
+		inline void BeginCase(const std::string& className, const std::string& caseName)
+		{
+			DTelemetryBlock::DWorker* worker = CurrentWorker();
+			if (!worker)
+			{
+				return;
+			}
+			char         name[DTelemetryBlock::NameWords * sizeof(uint64_t)]{};
+			const size_t classSize = std::min(className.size(), sizeof(name) - 2);
+			const size_t caseSize  = std::min(caseName.size(), sizeof(name) - 2 - classSize);
+			std::memcpy(name, className.data(), classSize);
+			name[classSize] = '.';
+			std::memcpy(name + classSize + 1, caseName.data(), caseSize);
+			// a case starting in the first nanosecond still reads as busy
+			const int64_t started = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count());
+			Publish(*worker, name, started);
+		};
+
+		inline void EndCase(bool passed)
+		{
+			(passed ? _block->Passed : _block->Failed).fetch_add(1, std::memory_order_relaxed);
+			if (DTelemetryBlock::DWorker* worker = CurrentWorker())
+			{
+				ClearWorker(*worker);
+			}
+		};
+
+		/*A case failed outside of its worker, like the case of a crashed worker process*/
+		inline void AddFailure() { _block->Failed.fetch_add(1, std::memory_order_relaxed); };
+
+		inline void ClearWorker(size_t slot)
+		{
+			if (slot < DTelemetryBlock::MaxWorkers)
+			{
+				ClearWorker(_block->Worker[slot]);
+			}
+		};
+
+		/*Give the calling thread a fixed worker slot, used by the forked workers that replace each other*/
+		inline void SetWorker(size_t slot)
+		{
+			ThreadSlot()     = { _generation, slot };
+			uint32_t workers = _block->Workers.load(std::memory_order_relaxed);
+			while (workers <= slot && !_block->Workers.compare_exchange_weak(workers, static_cast<uint32_t>(slot + 1), std::memory_order_relaxed))
+			{
+			}
+		};
+
+		/*Read the block of a running or ended run, returns false when the file isn't a telemetry file*/
+		inline static bool Read(const std::string& filename, DTelemetrySnapshot& snapshot)
+		{
+#if defined(BITTER_HAS_FORK)
+			const int fd = ::open(filename.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				return false;
+			}
+			struct stat status;
+			void*       mapped = MAP_FAILED;
+			if (::fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(DTelemetryBlock))
+			{
+				mapped = ::mmap(nullptr, sizeof(DTelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+			}
+			::close(fd);
+			if (mapped == MAP_FAILED)
+			{
+				return false;
+			}
+			const DTelemetryBlock& block = *static_cast<const DTelemetryBlock*>(mapped);
+			const bool             valid = block.Signature.load(std::memory_order_acquire) == DTelemetryBlock::ExpectedSignature;
+			if (valid)
+			{
+				snapshot.Running   = block.Running.load(std::memory_order_acquire) != 0;
+				snapshot.Passed    = block.Passed.load(std::memory_order_relaxed);
+				snapshot.Failed    = block.Failed.load(std::memory_order_relaxed);
+				snapshot.Cases     = std::max(block.Cases.load(std::memory_order_relaxed), snapshot.Passed + snapshot.Failed);
+				snapshot.Remaining = snapshot.Cases - snapshot.Passed - snapshot.Failed;
+				snapshot.Elapsed   = std::chrono::nanoseconds(block.Elapsed.load(std::memory_order_relaxed));
+				snapshot.PeakRss   = block.PeakRss.load(std::memory_order_relaxed);
+				snapshot.Workers.assign(std::min<size_t>(block.Workers.load(std::memory_order_relaxed), DTelemetryBlock::MaxWorkers), {});
+				for (size_t w = 0; w < snapshot.Workers.size(); w++)
+				{
+					ReadWorker(block.Worker[w], snapshot.Elapsed, snapshot.Workers[w]);
+				}
+			}
+			::munmap(mapped, sizeof(DTelemetryBlock));
+			return valid;
+#else
+			(void)filename;
+			(void)snapshot;
+			return false;
+#endif
+		};
+
+	private:
+		struct DThreadSlot
+		{
+			uint64_t Generation;
+			size_t   Slot;
+		};
+
+		DTelemetryBlock*                      _block{};
+		std::chrono::steady_clock::time_point _start;
+		uint64_t                              _generation{};
+		std::thread                           _thread;
+		std::mutex                            _mutex;
+		std::condition_variable               _wakeUp;
+		bool                                  _stopping{};
+
+		inline static std::atomic<uint64_t>& Generations()
+		{
+			static std::atomic<uint64_t> generations{};
+			return generations;
+		};
+
+		/*The slot of a thread is drawn once per run, the generation tells the runs apart*/
+		inline static DThreadSlot& ThreadSlot()
+		{
+			static thread_local DThreadSlot slot{};
+			return slot;
+		};
+
+		inline DTelemetryBlock::DWorker* CurrentWorker()
+		{
+			DThreadSlot& slot = ThreadSlot();
+			if (slot.Generation != _generation)
+			{
+				slot = { _generation, _block->Workers.fetch_add(1, std::memory_order_relaxed) };
+			}
+			return slot.Slot < DTelemetryBlock::MaxWorkers ? &_block->Worker[slot.Slot] : nullptr;
+		};
+
+		inline static void Publish(DTelemetryBlock::DWorker& worker, const char* name, int64_t started)
+		{
+			// a worker process killed while writing left the sequence odd
+			const uint32_t writing = worker.Sequence.load(std::memory_order_relaxed) | 1;
+			worker.Sequence.store(writing, std::memory_order_relaxed);
+			// released so that a reader seeing any of them also sees the odd sequence, plain stores on x86
+			for (size_t i = 0; i < DTelemetryBlock::NameWords; i++)
+			{
+				uint64_t word;
+				std::memcpy(&word, name + i * sizeof(word), sizeof(word));
+				worker.Name[i].store(word, std::memory_order_release);
+			}
+			worker.Started.store(started, std::memory_order_release);
+			worker.Sequence.store(writing + 1, std::memory_order_release);
+		};
+
+		inline static void ClearWorker(DTelemetryBlock::DWorker& worker)
+		{
+			const char name[DTelemetryBlock::NameWords * sizeof(uint64_t)]{};
+			Publish(worker, name, 0);
+		};
+
+		/*Retry while the worker is writing its case, a worker killed while writing is read as idle*/
+		inline static void ReadWorker(const DTelemetryBlock::DWorker& worker, std::chrono::nanoseconds elapsed, DTelemetrySnapshot::DWorkerStatus& status)
+		{
+			char    name[DTelemetryBlock::NameWords * sizeof(uint64_t)];
+			int64_t started;
+			for (unsigned int attempt = 0;; attempt++)
+			{
+				if (attempt == 1000)
+				{
+					status = {};
+					return;
+				}
+				const uint32_t sequence = worker.Sequence.load(std::memory_order_acquire);
+				for (size_t i = 0; i < DTelemetryBlock::NameWords; i++)
+				{
+					const uint64_t word = worker.Name[i].load(std::memory_order_acquire);
+					std::memcpy(name + i * sizeof(word), &word, sizeof(word));
+				}
+				started = worker.Started.load(std::memory_order_acquire);
+				if ((sequence & 1) == 0 && worker.Sequence.load(std::memory_order_relaxed) == sequence)
+				{
+					break;
+				}
+				std::this_thread::yield();
+			}
+			name[sizeof(name) - 1] = '\0';
+			status.Case            = name;
+			status.Running         = started > 0 ? std::max(std::chrono::nanoseconds::zero(), elapsed - std::chrono::nanoseconds(started)) : std::chrono::nanoseconds::zero();
+		};
+
+		inline void UpdateUsage()
+		{
+			_block->Elapsed.store(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count(), std::memory_order_relaxed);
+#if defined(BITTER_HAS_FORK)
+			struct rusage self{};
+			struct rusage children{};
+			::getrusage(RUSAGE_SELF, &self);
+			::getrusage(RUSAGE_CHILDREN, &children);
+			const uint64_t peak = static_cast<uint64_t>(std::max(self.ru_maxrss, children.ru_maxrss));
+#if defined(__APPLE__)
+			_block->PeakRss.store(peak, std::memory_order_relaxed);
+#else
+			_block->PeakRss.store(peak * 1024, std::memory_order_relaxed);
+#endif
+#endif
+		};
+	};
+
+	/*Stream buffer collecting the output in large blocks that a background thread writes to the destination.
+	The pending output is also written after flushInterval without new blocks, sync() returns only once everything reached the destination.
+	Given crashFd, the file descriptor the destination writes to, a fatal signal writes the pending output to it from the crashing thread before
+	the previous handler runs, so the report shows the crashing case. Without background the blocks are written by the thread filling them,
+	for a process that forks and must not start other threads*/
+	class AsyncStreamBuffer final : public std::streambuf
+	{
+	public:
+		explicit AsyncStreamBuffer(std::streambuf* destination, size_t blockSize = 1 << 20, std::chrono::milliseconds flushInterval = std::chrono::milliseconds(250),
+								   bool background = true, int crashFd = -1)
+			: _destination(destination), _blockSize(std::max<size_t>(blockSize, 1)), _flushInterval(flushInterval)
+		{
+			_blocks[0].Data.reset(new char[_blockSize]);
+			if (background)
+			{
+				_writer = std::thread([this]() { WriterLoop(); });
+			}
+#if defined(BITTER_HAS_FORK)
+			AsyncStreamBuffer* none = nullptr;
+			if (crashFd >= 0 && CrashedBuffer().compare_exchange_strong(none, this))
+			{
+				_crashFd = crashFd;
+				for (size_t i = 0; i < NumCrashSignals; i++)
+				{
+					_previousHandlers[i] = std::signal(CrashSignals()[i], &AsyncStreamBuffer::FlushOnCrash);
+				}
+				_handlingCrashes = true;
+			}
+#else
+			static_cast<void>(crashFd);
+#endif
+		};
+
+		~AsyncStreamBuffer()
+		{
+#if defined(BITTER_HAS_FORK)
+			if (_handlingCrashes)
+			{
+				for (size_t i = 0; i < NumCrashSignals; i++)
+				{
+					std::signal(CrashSignals()[i], _previousHandlers[i]);
+				}
+				CrashedBuffer().store(nullptr);
+			}
+#endif
+			sync();
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stopping = true;
+			}
+			_wakeUp.notify_all();
+			if (_writer.joinable())
+			{
+				_writer.join();
+			}
+		};
+
+		AsyncStreamBuffer(const AsyncStreamBuffer&) = delete;
+		AsyncStreamBuffer& operator=(const AsyncStreamBuffer&) = delete;
+
+	protected:
+		std::streamsize xsputn(const char* data, std::streamsize count) override
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			for (size_t remaining = static_cast<size_t>(count); remaining > 0;)
+			{
+				DBlock&      block = CurrentBlock();
+				const size_t size  = block.Size.load(std::memory_order_relaxed);
+				const size_t chunk = std::min(remaining, _blockSize - size);
+				std::memcpy(block.Data.get() + size, data, chunk);
+				// published for the crash handler once copied
+				block.Size.store(size + chunk, std::memory_order_release);
+				data += chunk;
+				remaining -= chunk;
+				if (size + chunk == _blockSize && !_writer.joinable())
+				{
+					WriteCurrentBlock();
+				}
+				else if (size + chunk == _blockSize)
+				{
+					QueueCurrentBlock(lock);
+				}
+			}
+			return count;
+		};
+
+		int_type overflow(int_type c) override
+		{
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+			{
+				const char character = traits_type::to_char_type(c);
+				xsputn(&character, 1);
+			}
+			return traits_type::not_eof(c);
+		};
+
+		int sync() override
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (!_writer.joinable())
+			{
+				WriteCurrentBlock();
+				return _destination->pubsync();
+			}
+			QueueCurrentBlock(lock);
+			_idle.wait(lock, [this]() { return NumQueued() == 0 && !_writing; });
+			return _destination->pubsync();
+		};
+
+	private:
+		/*A block of output allocated once, the crash handler reads its size*/
+		struct DBlock
+		{
+			std::unique_ptr<char[]> Data;
+			std::atomic<size_t>     Size{};
+		};
+
+		static constexpr size_t   _maxQueuedBlocks = 4;
+		static constexpr size_t   NumBlocks        = _maxQueuedBlocks + 2; // The queued blocks, the one being written and the current one
+		static constexpr size_t   Crashed          = std::numeric_limits<size_t>::max();
+		std::streambuf*           _destination;
+		const size_t              _blockSize;
+		std::chrono::milliseconds _flushInterval;
+		DBlock                    _blocks[NumBlocks]; // A ring indexed by the sequence number of the block
+		std::atomic<size_t>       _current{};         // Sequence number of the block being filled
+		std::atomic<size_t>       _nextWrite{};       // Of the first queued block, Crashed once the crash handler took the output
+		std::mutex                _mutex;
+		std::condition_variable   _wakeUp;
+		std::condition_variable   _idle;
+		bool                      _writing{};
+		bool                      _stopping{};
+		std::thread               _writer;
+
+		/*Must be called with the mutex locked*/
+		inline DBlock& CurrentBlock() { return _blocks[_current.load(std::memory_order_relaxed) % NumBlocks]; };
+
+		/*Must be called with the mutex locked*/
+		inline size_t NumQueued() const
+		{
+			const size_t next = _nextWrite.load();
+			return next == Crashed ? 0 : _current.load(std::memory_order_relaxed) - next;
+		};
+
+#if defined(BITTER_HAS_FORK)
+#if defined(SIGBUS)
+		static constexpr size_t NumCrashSignals = 5;
+#else
+		static constexpr size_t NumCrashSignals = 4;
+#endif
+		using FSignalHandler = void (*)(int);
+		FSignalHandler _previousHandlers[NumCrashSignals]{};
+		bool           _handlingCrashes{};
+		int            _crashFd{ -1 };
+
+		static inline const int* CrashSignals()
+		{
+#if defined(SIGBUS)
+			static const int signals[NumCrashSignals] = { SIGSEGV, SIGFPE, SIGILL, SIGABRT, SIGBUS };
+#else
+			static const int signals[NumCrashSignals] = { SIGSEGV, SIGFPE, SIGILL, SIGABRT };
+#endif
+			return signals;
+		};
+
+		/*The buffer flushed by the crash handler, only one at a time installs it*/
+		static inline std::atomic<AsyncStreamBuffer*>& CrashedBuffer()
+		{
+			static std::atomic<AsyncStreamBuffer*> buffer{};
+			return buffer;
+		};
+
+		static void FlushOnCrash(int signal)
+		{
+			AsyncStreamBuffer* buffer = CrashedBuffer().exchange(nullptr);
+			FSignalHandler     previous = SIG_DFL;
+			if (buffer)
+			{
+				for (size_t i = 0; i < NumCrashSignals; i++)
+				{
+					previous = CrashSignals()[i] == signal ? buffer->_previousHandlers[i] : previous;
+				}
+				buffer->WritePendingOutput();
+			}
+			std::signal(signal, previous == SIG_IGN ? SIG_DFL : previous);
+			std::raise(signal);
+		};
+
+		/*Writes the queued blocks and the current one to the crash file descriptor from the crashing thread. It is async signal safe: it doesn't
+		lock, allocate or wait, the thread crashing may hold the mutex. The block the writer thread is writing is left to it, the writer then stops*/
+		inline void WritePendingOutput()
+		{
+			const size_t first = _nextWrite.exchange(Crashed);
+			if (first == Crashed)
+			{
+				return;
+			}
+			const size_t last = _current.load(std::memory_order_acquire);
+			for (size_t sequence = first; sequence <= last; sequence++)
+			{
+				const DBlock& block = _blocks[sequence % NumBlocks];
+				const char*   bytes = block.Data.get();
+				for (size_t size = block.Size.load(std::memory_order_acquire); size > 0;)
+				{
+					const ssize_t written = ::write(_crashFd, bytes, size);
+					if (written < 0 && errno == EINTR)
+					{
+						continue;
+					}
+					if (written <= 0)
+					{
+						return;
+					}
+					bytes += written;
+					size -= static_cast<size_t>(written);
+				}
+			}
+		};
+#endif
+
+		/*Without background, must be called with the mutex locked*/
+		inline void WriteCurrentBlock()
+		{
+			DBlock& block = CurrentBlock();
+			_destination->sputn(block.Data.get(), static_cast<std::streamsize>(block.Size.load(std::memory_order_relaxed)));
+			block.Size.store(0, std::memory_order_release);
+		};
+
+		/*Starts filling the next block of the ring, it is allocated on its first use. Must be called with the mutex locked*/
+		inline void QueueCurrentBlock(std::unique_lock<std::mutex>& lock)
+		{
+			if (CurrentBlock().Size.load(std::memory_order_relaxed) == 0)
+			{
+				return;
+			}
+			// Bound the memory when the destination is slower than the producer, the next block is then neither queued nor being written
+			_idle.wait(lock, [this]() { return NumQueued() < _maxQueuedBlocks; });
+			const size_t next  = _current.load(std::memory_order_relaxed) + 1;
+			DBlock&      block = _blocks[next % NumBlocks];
+			if (!block.Data)
+			{
+				block.Data.reset(new char[_blockSize]);
+			}
+			block.Size.store(0, std::memory_order_relaxed);
+			_current.store(next, std::memory_order_release);
+			_wakeUp.notify_one();
+		};
+
+		inline void WriterLoop()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_stopping)
+			{
+				if (!_wakeUp.wait_for(lock, _flushInterval, [this]() { return _stopping || NumQueued() > 0; }))
+				{
+					QueueCurrentBlock(lock);
+				}
+				// a block is taken before being written, unless the crash handler took the output first
+				for (size_t next = _nextWrite.load(); next != Crashed && next != _current.load(std::memory_order_relaxed); next = _nextWrite.load())
+				{
+					if (!_nextWrite.compare_exchange_strong(next, next + 1))
+					{
+						break;
+					}
+					const DBlock& block = _blocks[next % NumBlocks];
+					_writing            = true;
+					lock.unlock();
+					_destination->sputn(block.Data.get(), static_cast<std::streamsize>(block.Size.load(std::memory_order_acquire)));
+					_destination->pubsync();
+					lock.lock();
+					_writing = false;
+				}
+				_idle.notify_all();
+			}
+		};
+	};
+
+	/*Latencies of the runs of a case summarized in buckets of 1/16 of a power of two, the percentiles are within 7% at a constant memory*/
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram() : _counts(NumBuckets){};
+
+		inline void Add(std::chrono::nanoseconds latency)
+		{
+			const uint64_t value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+			_counts[Bucket(value)]++;
+			_total++;
+			_max = std::max(_max, value);
+		};
+
+		inline void Merge(const LatencyHistogram& other)
+		{
+			for (size_t i = 0; i < NumBuckets; i++)
+			{
+				_counts[i] += other._counts[i];
+			}
+			_total += other._total;
+			_max = std::max(_max, other._max);
+		};
+
+		/*Latency under which the fraction of the runs fall, the middle of its bucket*/
+		inline std::chrono::nanoseconds Percentile(double fraction) const
+		{
+			const uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(_total)));
+			uint64_t       seen = 0;
+			for (size_t i = 0; i < NumBuckets; i++)
+			{
+				seen += _counts[i];
+				if (seen >= std::max<uint64_t>(rank, 1))
+				{
+					const uint64_t low  = LowerBound(i);
+					const uint64_t high = i + 1 < NumBuckets ? LowerBound(i + 1) : low;
+					return std::chrono::nanoseconds(static_cast<int64_t>(std::min(_max, low + (high - low) / 2)));
+				}
+			}
+			return std::chrono::nanoseconds::zero();
+		};
+
+		inline std::chrono::nanoseconds Max() const { return std::chrono::nanoseconds(static_cast<int64_t>(_max)); };
+		inline uint64_t                 Count() const { return _total; };
+
+	private:
+		static constexpr size_t NumBuckets = 1024;
+		std::vector<uint64_t>   _counts;
+		uint64_t                _total{};
+		uint64_t                _max{};
+
+		inline static size_t Bucket(uint64_t value)
+		{
+			if (value < 16)
+			{
+				return static_cast<size_t>(value);
+			}
+			size_t exponent = 4;
+			while (exponent < 63 && (value >> (exponent + 1)) != 0)
+			{
+				exponent++;
+			}
+			return (exponent - 3) * 16 + static_cast<size_t>((value >> (exponent - 4)) & 15);
+		};
+
+		inline static uint64_t LowerBound(size_t bucket)
+		{
+			if (bucket < 16)
+			{
+				return bucket;
+			}
+			return (16 + static_cast<uint64_t>(bucket % 16)) << (bucket / 16 - 1);
+		};
+	};
+
+	/*Runs of a case repeated by --repeat or --duration*/
+	struct DSoakStats
+	{
+		uint64_t                 Runs{};
+		uint64_t                 Failures{};
+		int64_t                  FirstFailedIteration{ -1 };
+		std::chrono::nanoseconds P50{};
+		std::chrono::nanoseconds P90{};
+		std::chrono::nanoseconds P99{};
+		std::chrono::nanoseconds Max{};
+	};
+
+	/*Result of a test case as it's given to the reporters*/
+	struct DCaseResult
+	{
+		std::string              Name;
+		ETestStatus              Status{ ETestStatus::NOT_TESTED };
+		std::chrono::nanoseconds Duration{};
+		std::string              Messages;
+		bool                     IsBenchmark{};
+		DBenchmarkResult         Benchmark;
+		bool                     Cached{}; // Replayed from the results of a previous run
+		DAllocationStats         Allocations{};
+		DSoakStats               Soak{};
+	};
+
+	/*Result of a test class as it's given to the reporters*/
+	struct DClassResult
+	{
+		std::string              Name;
+		size_t                   NumTests{};
+		size_t                   NumPassed{};
+		std::string              Log;
+		std::chrono::nanoseconds Duration{};
+		bool                     HooksPassed{ true }; // False when BeforeAll or AfterAll failed
+
+		inline bool Passed() const { return NumPassed == NumTests && HooksPassed; };
+	};
+
+	/*Results of a class kept in the results file between runs. Complete when every case of the class ran with this fingerprint*/
+	struct DRecordedClass
+	{
+		std::string              Fingerprint;
+		bool                     Complete{};
+		std::string              Log;
+		std::vector<DCaseResult> Cases;
+	};
+
+	inline const char* __statusName(ETestStatus status)
+	{
+		switch (status)
+		{
+			case ETestStatus::PASSED:
+				return "passed";
+			case ETestStatus::FAILED:
+				return "failed";
+			default:
+				return "not_tested";
+		}
+	}
+	inline ETestStatus __parseStatus(const std::string& name)
+	{
+		return name == "passed" ? ETestStatus::PASSED : name == "failed" ? ETestStatus::FAILED : ETestStatus::NOT_TESTED;
+	}
+
+	/*Escape the separators of the tab separated files*/
+	inline std::string __escapeField(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (const char c : text)
+		{
+			switch (c)
+			{
+				case '\\':
+					escaped += "\\\\";
+					break;
+				case '\t':
+					escaped += "\\t";
+					break;
+				case '\n':
+					escaped += "\\n";
+					break;
+				case '\r':
+					escaped += "\\r";
+					break;
+				default:
+					escaped += c;
+			}
+		}
+		return escaped;
+	}
+
+	inline std::string __unescapeField(const std::string& text)
+	{
+		std::string unescaped;
+		unescaped.reserve(text.size());
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			if (text[i] != '\\' || i + 1 == text.size())
+			{
+				unescaped += text[i];
+				continue;
+			}
+			const char c = text[++i];
+			unescaped += c == 't' ? '\t' : c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+		}
+		return unescaped;
+	}
+
+
+	/*Escape text and attribute values, the control characters that XML 1.0 can't represent are dropped*/
+	inline std::string __escapeXml(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (const char c : text)
+		{
+			switch (c)
+			{
+				case '&':
+					escaped += "&amp;";
+					break;
+				case '<':
+					escaped += "&lt;";
+					break;
+				case '>':
+					escaped += "&gt;";
+					break;
+				case '"':
+					escaped += "&quot;";
+					break;
+				case '\'':
+					escaped += "&apos;";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) >= 0x20 || c == '\t' || c == '\n' || c == '\r')
+					{
+						escaped += c;
+					}
+			}
+		}
+		return escaped;
+	}
+
+	inline std::string __escapeJson(const std::string& text)
+	{
+		static const char hex[] = "0123456789abcdef";
+		std::string       escaped;
+		escaped.reserve(text.size() + 2);
+		escaped += '"';
+		for (const char c : text)
+		{
+			switch (c)
+			{
+				case '"':
+					escaped += "\\\"";
+					break;
+				case '\\':
+					escaped += "\\\\";
+					break;
+				case '\n':
+					escaped += "\\n";
+					break;
+				case '\r':
+					escaped += "\\r";
+					break;
+				case '\t':
+					escaped += "\\t";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						escaped += "\\u00";
+						escaped += hex[(c >> 4) & 0xf];
+						escaped += hex[c & 0xf];
+					}
+					else
+					{
+						escaped += c;
+					}
+			}
+		}
+		escaped += '"';
+		return escaped;
+	}
+
+	/*Receives the results while the run progresses, derive from it to stream the results in a custom format.
+	With --jobs the events of a class are delivered once the class completed, always from the thread calling RunAllTests and in the class order*/
+	class Reporter
+	{
+	public:
+		virtual ~Reporter() = default;
+
+		virtual void OnRunBegin() {};
+		virtual void OnClassBegin(const std::string& className) { (void)className; };
+		virtual void OnCaseBegin(const std::string& className, const std::string& caseName)
+		{
+			(void)className;
+			(void)caseName;
+		};
+		virtual void OnCaseEnd(const std::string& className, const DCaseResult& result)
+		{
+			(void)className;
+			(void)result;
+		};
+		virtual void OnClassEnd(const DClassResult& result) { (void)result; };
+		virtual void OnRunEnd(bool passed, std::chrono::nanoseconds duration)
+		{
+			(void)passed;
+			(void)duration;
+		};
+	};
+
+	/*The colored human readable report*/
+	class TextReporter final : public Reporter
+	{
+	public:
+		explicit TextReporter(std::ostream& out, unsigned int slowest = 10) : _out(out), _slowest(slowest) {};
+
+		void OnClassBegin(const std::string& className) override { _out << TEXT_WHITE << ENDLINE << "Begin testing:" << className << ENDLINE; };
+
+		void OnCaseBegin(const std::string& className, const std::string& caseName) override
+		{
+			(void)className;
+			_out << TEXT_WHITE << "Running:" << caseName << ENDLINE;
+		};
+
+		/*Write the result of a case, a failure is flushed right away*/
+		void OnCaseEnd(const std::string& className, const DCaseResult& result) override
+		{
+			if (!result.Messages.empty())
+			{
+				_out << TEXT_RED << result.Messages << TEXT_WHITE;
+			}
+			OutResult(result.Status == ETestStatus::PASSED);
+			_out << " ";
+			OutDuration(result.Duration);
+			if (result.Cached)
+			{
+				_out << " (cached)";
+			}
+			else if (IsTrackingAllocations())
+			{
+				_out << " " << result.Allocations.Allocations << " allocs " << result.Allocations.Bytes << "B peak " << result.Allocations.Peak << "B";
+			}
+			_out << ENDLINE;
+			if (result.IsBenchmark && !result.Benchmark.Samples.empty())
+			{
+				OutBenchmark(result.Benchmark);
+			}
+			if (result.Soak.Runs > 0)
+			{
+				OutSoak(result.Soak);
+			}
+			if (result.Status != ETestStatus::PASSED)
+			{
+				_out.flush();
+			}
+			if (_slowest > 0)
+			{
+				_caseDurations.emplace_back(result.Duration, className + "." + result.Name);
+			}
+		};
+
+		void OnClassEnd(const DClassResult& result) override
+		{
+			_out << TEXT_RED << result.Log << ENDLINE;
+			_out << TEXT_GREEN << "Result completed tests [" << result.NumPassed << "/" << result.NumTests << "]" << ENDLINE;
+
+			_out << TEXT_WHITE << result.Name << " Completed with result" << ENDLINE;
+			OutResult(result.Passed());
+			_out << " ";
+			OutDuration(result.Duration);
+
+			_out << ENDLINE << ENDLINE;
+			if (!result.Passed())
+			{
+				_out.flush();
+			}
+			if (_slowest > 0)
+			{
+				_classDurations.emplace_back(result.Duration, result.Name);
+			}
+		};
+
+		void OnRunEnd(bool passed, std::chrono::nanoseconds duration) override
+		{
+			if (_slowest > 0)
+			{
+				OutSlowest("Slowest test cases", _caseDurations);
+				OutSlowest("Slowest test classes", _classDurations);
+			}
+
+			_out << TEXT_WHITE << "Testing ended with result" << ENDLINE;
+			OutResult(passed);
+			_out << " ";
+			OutDuration(duration);
+			_out << ENDLINE;
+
+			_out << TEXT_WHITE;
+			_out.flush();
+		};
+
+	private:
+		static constexpr unsigned int                                 _resultOffset = 60;
+		std::ostream&                                                 _out;
+		unsigned int                                                  _slowest;
+		std::vector<std::pair<std::chrono::nanoseconds, std::string>> _caseDurations;
+		std::vector<std::pair<std::chrono::nanoseconds, std::string>> _classDurations;
+
+		inline void OutBenchmark(const DBenchmarkResult& benchmark)
+		{
+			const auto flags     = _out.flags();
+			const auto precision = _out.precision();
+			_out << TEXT_WHITE << std::fixed << std::setprecision(2) << "  min " << benchmark.Min << "ns"
+				 << " median " << benchmark.Median << "ns"
+				 << " p99 " << benchmark.P99 << "ns"
+				 << " stddev " << benchmark.StdDev << "ns"
+				 << " per iteration (" << benchmark.Samples.size() << " samples of " << benchmark.Iterations << " iterations)" << ENDLINE;
+			const DHardwareCounters& counters = benchmark.Counters;
+			if (counters.HasAny())
+			{
+				_out << " ";
+				OutCounter("cycles", counters.Cycles);
+				OutCounter("instructions", counters.Instructions);
+				if (counters.Cycles > 0. && counters.Instructions >= 0.)
+				{
+					_out << " IPC " << counters.Instructions / counters.Cycles;
+				}
+				OutCounter("cache misses", counters.CacheMisses);
+				OutCounter("branch misses", counters.BranchMisses);
+				_out << " per iteration" << ENDLINE;
+			}
+			_out.flags(flags);
+			_out.precision(precision);
+		};
+
+		inline void OutCounter(const char* name, double value)
+		{
+			if (value >= 0.)
+			{
+				_out << " " << name << " " << value;
+			}
+		};
+
+		inline void OutSoak(const DSoakStats& soak)
+		{
+			_out << TEXT_WHITE << "  " << soak.Runs << " runs, " << soak.Failures << " failed";
+			if (soak.FirstFailedIteration >= 0)
+			{
+				_out << " first at iteration " << soak.FirstFailedIteration;
+			}
+			_out << ", p50 ";
+			OutDuration(soak.P50);
+			_out << " p90 ";
+			OutDuration(soak.P90);
+			_out << " p99 ";
+			OutDuration(soak.P99);
+			_out << " max ";
+			OutDuration(soak.Max);
+			_out << ENDLINE;
+		};
+
+		inline void OutDuration(std::chrono::nanoseconds duration)
+		{
+			const auto flags     = _out.flags();
+			const auto precision = _out.precision();
+			_out << std::fixed << std::setprecision(3) << static_cast<double>(duration.count()) / 1e6 << "ms";
+			_out.flags(flags);
+			_out.precision(precision);
+		};
+
+		/*List the longest durations, ties are sorted by name*/
+		inline void OutSlowest(const char* title, std::vector<std::pair<std::chrono::nanoseconds, std::string>>& durations)
+		{
+			const size_t count = std::min<size_t>(_slowest, durations.size());
+			std::partial_sort(durations.begin(), durations.begin() + count, durations.end(),
+							  [](const std::pair<std::chrono::nanoseconds, std::string>& a, const std::pair<std::chrono::nanoseconds, std::string>& b) {
+								  return a.first != b.first ? a.first > b.first : a.second < b.second;
+							  });
+			_out << TEXT_WHITE << title << ENDLINE;
+			for (size_t i = 0; i < count; i++)
+			{
+				_out << "  ";
+				OutDuration(durations[i].first);
+				_out << " " << durations[i].second << ENDLINE;
+			}
+			_out << ENDLINE;
+		};
+
+		/*The result is right aligned at _resultOffset, the padding is built once instead of formatting it on every line*/
+		inline static const std::string& ResultPadding()
+		{
+			static const std::string padding = std::string(_resultOffset - 1, '-') + "[";
+			return padding;
+		};
+
+		inline void OutSuccess() { _out << ResultPadding() << TEXT_GREEN "PASSED" TEXT_WHITE "]"; };
+		inline void OutFailure() { _out << ResultPadding() << TEXT_RED "FAILED" TEXT_WHITE "]"; };
+
+		inline void OutResult(bool result)
+		{
+			if (result)
+			{
+				OutSuccess();
+			}
+			else
+			{
+				OutFailure();
+			}
+		};
+	};
+
+	/*Streams a JUnit XML document, the cases of a class are collected and its testsuite element is written when it ends since it carries the counts*/
+	class JUnitReporter final : public Reporter
+	{
+	public:
+		explicit JUnitReporter(std::ostream& out) : _out(out) {};
+
+		void OnRunBegin() override { _out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << ENDLINE << "<testsuites>" << ENDLINE; };
+
+		void OnCaseEnd(const std::string& className, const DCaseResult& result) override
+		{
+			_cases << "    <testcase classname=\"" << __escapeXml(className) << "\" name=\"" << __escapeXml(result.Name) << "\" time=\"" << Seconds(result.Duration) << "\"";
+			_numCases++;
+			if (result.Status == ETestStatus::PASSED)
+			{
+				_cases << "/>" << ENDLINE;
+				return;
+			}
+			_cases << ">" << ENDLINE;
+			if (result.Status == ETestStatus::NOT_TESTED)
+			{
+				_numSkipped++;
+				_cases << "      <skipped/>" << ENDLINE;
+			}
+			else
+			{
+				_numFailures++;
+				const std::string firstLine = result.Messages.substr(0, result.Messages.find(ENDLINE));
+				_cases << "      <failure message=\"" << __escapeXml(firstLine) << "\">" << __escapeXml(result.Messages) << "</failure>" << ENDLINE;
+			}
+			_cases << "    </testcase>" << ENDLINE;
+		};
+
+		void OnClassEnd(const DClassResult& result) override
+		{
+			if (!result.HooksPassed)
+			{
+				// a failed Define, BeforeAll or AfterAll is reported as a failed case of its own so that the suite fails
+				const std::string firstLine = result.Log.empty() ? std::string("A hook of the class failed") : result.Log.substr(0, result.Log.find(ENDLINE));
+				_cases << "    <testcase classname=\"" << __escapeXml(result.Name) << "\" name=\"[hooks]\" time=\"0.000000\">" << ENDLINE << "      <failure message=\""
+					   << __escapeXml(firstLine) << "\">" << __escapeXml(result.Log) << "</failure>" << ENDLINE << "    </testcase>" << ENDLINE;
+				_numCases++;
+				_numFailures++;
+			}
+			_out << "  <testsuite name=\"" << __escapeXml(result.Name) << "\" tests=\"" << _numCases << "\" failures=\"" << _numFailures << "\" skipped=\"" << _numSkipped
+				 << "\" time=\"" << Seconds(result.Duration) << "\">" << ENDLINE;
+			_out << _cases.str();
+			if (!result.Log.empty())
+			{
+				_out << "    <system-out>" << __escapeXml(result.Log) << "</system-out>" << ENDLINE;
+			}
+			_out << "  </testsuite>" << ENDLINE;
+			_out.flush();
+			_cases.str(std::string());
+			_numCases    = 0;
+			_numFailures = 0;
+			_numSkipped  = 0;
+		};
+
+		void OnRunEnd(bool passed, std::chrono::nanoseconds duration) override
+		{
+			(void)passed;
+			(void)duration;
+			_out << "</testsuites>" << ENDLINE;
+			_out.flush();
+		};
+
+	private:
+		std::ostream&      _out;
+		std::ostringstream _cases; // Of the class being reported, the reporters get a class at a time
+		size_t             _numCases{};
+		size_t             _numFailures{};
+		size_t             _numSkipped{};
+
+		inline static std::string Seconds(std::chrono::nanoseconds duration)
+		{
+			std::ostringstream seconds;
+			seconds << std::fixed << std::setprecision(6) << static_cast<double>(duration.count()) / 1e9;
+			return seconds.str();
+		};
+	};
+
+	/*Streams one JSON object per line for every case, class and for the run*/
+	class JsonLinesReporter final : public Reporter
+	{
+	public:
+		explicit JsonLinesReporter(std::ostream& out) : _out(out) {};
+
+		void OnCaseEnd(const std::string& className, const DCaseResult& result) override
+		{
+			_out << "{\"type\":\"case\",\"class\":" << __escapeJson(className) << ",\"name\":" << __escapeJson(result.Name) << ",\"status\":\""
+				 << __statusName(result.Status) << "\",\"duration_ns\":" << result.Duration.count();
+			if (result.Cached)
+			{
+				_out << ",\"cached\":true";
+			}
+			else if (IsTrackingAllocations())
+			{
+				_out << ",\"allocs\":" << result.Allocations.Allocations << ",\"alloc_bytes\":" << result.Allocations.Bytes << ",\"peak_bytes\":" << result.Allocations.Peak
+					 << ",\"live_bytes\":" << result.Allocations.Live;
+			}
+			if (!result.Messages.empty())
+			{
+				_out << ",\"message\":" << __escapeJson(result.Messages);
+			}
+			if (result.Soak.Runs > 0)
+			{
+				_out << ",\"soak\":{\"runs\":" << result.Soak.Runs << ",\"failures\":" << result.Soak.Failures << ",\"first_failed_iteration\":" << result.Soak.FirstFailedIteration
+					 << ",\"p50_ns\":" << result.Soak.P50.count() << ",\"p90_ns\":" << result.Soak.P90.count() << ",\"p99_ns\":" << result.Soak.P99.count()
+					 << ",\"max_ns\":" << result.Soak.Max.count() << "}";
+			}
+			if (result.IsBenchmark && !result.Benchmark.Samples.empty())
+			{
+				const auto precision = _out.precision(std::numeric_limits<double>::max_digits10);
+				_out << ",\"benchmark\":{\"iterations\":" << result.Benchmark.Iterations << ",\"samples\":" << result.Benchmark.Samples.size()
+					 << ",\"min_ns\":" << result.Benchmark.Min << ",\"median_ns\":" << result.Benchmark.Median << ",\"p99_ns\":" << result.Benchmark.P99
+					 << ",\"stddev_ns\":" << result.Benchmark.StdDev;
+				const DHardwareCounters& counters = result.Benchmark.Counters;
+				const std::pair<const char*, double> values[] = { { "cycles", counters.Cycles },
+																  { "instructions", counters.Instructions },
+																  { "cache_misses", counters.CacheMisses },
+																  { "branch_misses", counters.BranchMisses } };
+				for (const auto& value : values)
+				{
+					if (value.second >= 0.)
+					{
+						_out << ",\"" << value.first << "\":" << value.second;
+					}
+				}
+				_out << "}";
+				_out.precision(precision);
+			}
+			_out << "}" << ENDLINE;
+			if (result.Status == ETestStatus::FAILED)
+			{
+				_out.flush();
+			}
+		};
+
+		void OnClassEnd(const DClassResult& result) override
+		{
+			_out << "{\"type\":\"class\",\"class\":" << __escapeJson(result.Name) << ",\"tests\":" << result.NumTests << ",\"passed\":" << result.NumPassed
+				 << ",\"hooks_passed\":" << (result.HooksPassed ? "true" : "false") << ",\"duration_ns\":" << result.Duration.count();
+			if (!result.Log.empty())
+			{
+				_out << ",\"log\":" << __escapeJson(result.Log);
+			}
+			_out << "}" << ENDLINE;
+			_out.flush();
+		};
+
+		void OnRunEnd(bool passed, std::chrono::nanoseconds duration) override
+		{
+			_out << "{\"type\":\"run\",\"passed\":" << (passed ? "true" : "false") << ",\"duration_ns\":" << duration.count() << "}" << ENDLINE;
+			_out.flush();
+		};
+
+	private:
+		std::ostream& _out;
+	};
+
+	class AutomationTester
+	{
+		using TestFactory     = std::function<AutomatedTestInstance* (void)>;
+		using FixturesDeclare = void (*)(SharedFixtureUsers&);
+
+	public:
+		AutomationTester() = default;
+
+		// Define it as a singleton, it also runs the statically registered classes
+		inline static AutomationTester& GetInstance()
+		{
+			static AutomationTester tester(true);
+			return tester;
+		};
+
+		template<class T>
+		void AddTest(const std::string& testName)
+		{
+			AddTest(testName, []() -> AutomatedTestInstance* { return new T; }, &T::DeclareSharedFixtures);
+		};
+
+		/*Add a class constructed by the factory, declareFixtures is its DeclareSharedFixtures if it uses shared fixtures*/
+		inline void AddTest(const std::string& testName, TestFactory factory, FixturesDeclare declareFixtures = nullptr)
+		{
+			_tests[testName] = { std::move(factory), declareFixtures };
+		};
+
+		/*Set the fingerprint of a class, like the hash of what its cases depend on. With --cache a class whose fingerprint is the same of the
+		previous run isn't run and its recorded results are reported again*/
+		inline void SetFingerprint(const std::string& className, const std::string& fingerprint) { _fingerprints[className] = fingerprint; };
+
+		/*Add a reporter that will receive the results of every following run*/
+		inline void AddReporter(std::shared_ptr<Reporter> reporter) { _reporters.push_back(std::move(reporter)); };
+
+		bool RunAllTests(int argc = 0, char* argv[] = nullptr)
+		{
+			const auto runStart = std::chrono::steady_clock::now();
+			_runStart           = runStart;
+			_options            = ParseArguments(argc, argv);
+			SetupOutstream(_options);
+
+			std::vector<std::unique_ptr<std::ofstream>> reportFiles;
+			std::vector<std::shared_ptr<Reporter>>      builtinReporters;
+			builtinReporters.push_back(std::make_shared<TextReporter>(GetOutstream(), _options.Slowest));
+			if (std::ostream* junit = OpenReportFile(_options.JUnitFilename, reportFiles))
+			{
+				builtinReporters.push_back(std::make_shared<JUnitReporter>(*junit));
+			}
+			if (std::ostream* jsonLines = OpenReportFile(_options.JsonLinesFilename, reportFiles))
+			{
+				builtinReporters.push_back(std::make_shared<JsonLinesReporter>(*jsonLines));
+			}
+			_activeReporters.clear();
+			for (const auto& reporter : builtinReporters)
+			{
+				_activeReporters.push_back(reporter.get());
+			}
+			for (const auto& reporter : _reporters)
+			{
+				_activeReporters.push_back(reporter.get());
+			}
+
+			_benchmarkBaseline.clear();
+			_benchmarkMeasures.clear();
+			if (!_options.BenchmarkBaseline.empty() && !LoadBenchmarkBaseline(_options.BenchmarkBaseline, _benchmarkBaseline))
+			{
+				std::cerr << "Could not read benchmark baseline:" << _options.BenchmarkBaseline << ENDLINE;
+			}
+
+			_durations.clear();
+			_measuredDurations.clear();
+			if (!_options.Durations.empty() && !LoadDurations(_options.Durations, _durations))
+			{
+				std::cerr << "Could not read case durations:" << _options.Durations << ENDLINE;
+			}
+			_recordedResults.clear();
+			_rerunCases.clear();
+			std::unordered_set<std::string> rerunClasses;
+			if (!_options.ResultsFilename.empty() && !LoadResults(_options.ResultsFilename, _recordedResults) && _options.RerunFailed)
+			{
+				std::cerr << "Could not read the results of the previous run:" << _options.ResultsFilename << ENDLINE;
+			}
+			if (_options.RerunFailed)
+			{
+				for (const auto& recorded : _recordedResults)
+				{
+					for (const DCaseResult& result : recorded.second.Cases)
+					{
+						if (result.Status == ETestStatus::FAILED)
+						{
+							_rerunCases.insert(recorded.first + "." + result.Name);
+							rerunClasses.insert(recorded.first);
+						}
+					}
+				}
+				if (_rerunCases.empty())
+				{
+					std::cerr << "No failed case recorded, running every case" << ENDLINE;
+				}
+			}
+			if (const char* shardStatusFile = std::getenv("GTEST_SHARD_STATUS_FILE"))
+			{
+				// tells the CI runner that sharding is supported
+				std::ofstream(shardStatusFile).put('\n');
+			}
+
+			for (Reporter* reporter : _activeReporters)
+			{
+				reporter->OnRunBegin();
+			}
+			_watchdog.reset(new Watchdog([this](const Watchdog::DWatchedCase& watched) { OnCaseTimeout(watched); }));
+			_telemetry.reset();
+			if (!_options.TelemetryFilename.empty())
+			{
+				_telemetry.reset(new Telemetry());
+				if (!_telemetry->Open(_options.TelemetryFilename))
+				{
+					std::cerr << "Could not map the telemetry file:" << _options.TelemetryFilename << ENDLINE;
+					_telemetry.reset();
+				}
+			}
+
+			try
+			{
+				_filter = TestFilter(_options.Filter, _options.FilterRegex);
+			}
+			catch (const std::regex_error&)
+			{
+				std::cerr << "Invalid filter regex:" << _options.FilterRegex << ENDLINE;
+				_filter = TestFilter(_options.Filter, std::string());
+			}
+
+			IndexTestClasses();
+			std::vector<const DTestClass*> classes;
+			classes.reserve(_classes.size());
+			for (const DTestClass& testClass : _classes)
+			{
+				if (_filter.MayMatchClass(testClass.Name) && (_rerunCases.empty() || rerunClasses.count(testClass.Name) != 0))
+				{
+					classes.push_back(&testClass);
+				}
+			}
+
+			if (!_options.Isolate)
+			{
+				DeclareFixtures(classes);
+			}
+			if (_options.ShardCount > 1 && _options.ShardBalance)
+			{
+				PlanShards(classes);
+			}
+
+			unsigned int testPassed{};
+			_classesRun = 0;
+			const AutomatedTestInstance::DPropertyOverrides previousOverrides = AutomatedTestInstance::PropertyOverrides();
+			AutomatedTestInstance::PropertyOverrides()                        = { _options.Seed, _options.HasSeed, _options.Trials };
+			const DSnapshotOptions previousSnapshots                          = __snapshotOptions();
+			__snapshotOptions()                                               = { _options.SnapshotDirectory, _options.UpdateSnapshots };
+			if (_options.Repeat > 0 || _options.SoakDuration > std::chrono::nanoseconds::zero())
+			{
+				testPassed = RunSoak(classes);
+			}
+			else if (_options.Isolate)
+			{
+				testPassed = RunTestClassesIsolated(classes);
+			}
+			else if (_options.Jobs > 1 && (classes.size() > 1 || _options.ParallelCases))
+			{
+				testPassed = RunTestClassesParallel(classes);
+			}
+			else
+			{
+				for (const DTestClass* testClass : classes)
+				{
+					const DRecordedClass* cached = CachedClass(testClass->Name);
+					testPassed += static_cast<unsigned int>(cached ? ReplayCachedClass(testClass->Name, *cached) : RunTestClass(*testClass));
+				}
+			}
+			_definedInstances.clear();
+			_declaredFixtures.clear();
+			AutomatedTestInstance::PropertyOverrides() = previousOverrides;
+			__snapshotOptions()                        = previousSnapshots;
+			_telemetry.reset();
+
+			if (!_options.BenchmarkSave.empty())
+			{
+				std::map<std::string, DBenchmarkBaseline> baseline(_benchmarkBaseline);
+				for (auto& measure : _benchmarkMeasures)
+				{
+					baseline[measure.first] = std::move(measure.second);
+				}
+				if (!SaveBenchmarkBaseline(_options.BenchmarkSave, baseline))
+				{
+					std::cerr << "Could not write benchmark baseline:" << _options.BenchmarkSave << ENDLINE;
+				}
+			}
+
+			if (!_options.DurationsSave.empty())
+			{
+				std::map<std::string, std::chrono::nanoseconds> durations(_durations);
+				for (const auto& measured : _measuredDurations)
+				{
+					durations[measured.first] = measured.second;
+				}
+				if (!SaveDurations(_options.DurationsSave, durations))
+				{
+					std::cerr << "Could not write case durations:" << _options.DurationsSave << ENDLINE;
+				}
+			}
+
+			if (!_options.ResultsFilename.empty() && !SaveResults(_options.ResultsFilename, _recordedResults))
+			{
+				std::cerr << "Could not write the results:" << _options.ResultsFilename << ENDLINE;
+			}
+
+			if (_filter.IsActive() && _classesRun == 0)
+			{
+				std::cerr << "No test matched the filter" << ENDLINE;
+			}
+
+			const bool passed   = (testPassed == _classesRun);
+			const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - runStart);
+			for (Reporter* reporter : _activeReporters)
+			{
+				reporter->OnRunEnd(passed, duration);
+			}
+			_watchdog.reset();
+			_activeReporters.clear();
+			builtinReporters.clear();
+			EndOutputStream();
+
+			return passed;
+		};
+
+		/*The report stream, during a run it's buffered and only flushed on failures and at the end*/
+		inline std::ostream& GetOutstream()
+		{
+			if (_bufferedStream)
+			{
+				return *_bufferedStream;
+			}
+			return GetDestination();
+		};
+
+		/*Parse the command line, the first argument not starting with -- is the log filename*/
+		inline static DRunOptions ParseArguments(int argc, char* argv[])
+		{
+			DRunOptions options;
+			// the sharding protocol of the CI runners that split GoogleTest binaries, the command line has the precedence
+			const char* shardIndex = std::getenv("BITTER_SHARD_INDEX") ? std::getenv("BITTER_SHARD_INDEX") : std::getenv("GTEST_SHARD_INDEX");
+			const char* shardCount = std::getenv("BITTER_TOTAL_SHARDS") ? std::getenv("BITTER_TOTAL_SHARDS") : std::getenv("GTEST_TOTAL_SHARDS");
+			if (shardIndex && shardCount)
+			{
+				options.ShardIndex = static_cast<unsigned int>(std::strtoul(shardIndex, nullptr, 10));
+				options.ShardCount = static_cast<unsigned int>(std::strtoul(shardCount, nullptr, 10));
+			}
+			for (int i = 1; i < argc; i++)
+			{
+				const std::string argument(argv[i]);
+				if (argument.compare(0, 2, "--") != 0)
+				{
+					if (options.LogFilename.empty())
+					{
+						options.LogFilename = argument;
+					}
+					continue;
+				}
+
+				const size_t      separator = argument.find('=');
+				const std::string key       = argument.substr(0, separator);
+				const std::string value     = separator == std::string::npos ? std::string() : argument.substr(separator + 1);
+				if (key == "--jobs")
+				{
+					const long jobs = std::strtol(value.c_str(), nullptr, 10);
+					options.Jobs    = jobs > 0 ? static_cast<unsigned int>(jobs) : std::max(1u, std::thread::hardware_concurrency());
+				}
+				else if (key == "--parallel-cases")
+				{
+					options.ParallelCases = true;
+				}
+				else if (key == "--slowest")
+				{
+					options.Slowest = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+				}
+				else if (key == "--filter")
+				{
+					options.Filter = value;
+				}
+				else if (key == "--filter-regex")
+				{
+					options.FilterRegex = value;
+				}
+				else if (key == "--junit")
+				{
+					options.JUnitFilename = value;
+				}
+				else if (key == "--jsonl")
+				{
+					options.JsonLinesFilename = value;
+				}
+				else if (key == "--telemetry")
+				{
+					options.TelemetryFilename = value;
+				}
+				else if (key == "--bench-baseline")
+				{
+					options.BenchmarkBaseline = value;
+				}
+				else if (key == "--bench-save")
+				{
+					options.BenchmarkSave = value.empty() ? std::string("-") : value;
+				}
+				else if (key == "--bench-tolerance")
+				{
+					options.BenchmarkTolerance = std::strtod(value.c_str(), nullptr);
+				}
+				else if (key == "--bench-significance")
+				{
+					options.BenchmarkSignificance = std::strtod(value.c_str(), nullptr);
+				}
+				else if (key == "--shard-index")
+				{
+					options.ShardIndex = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+				}
+				else if (key == "--shard-count")
+				{
+					options.ShardCount = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+				}
+				else if (key == "--shard-balance")
+				{
+					options.ShardBalance = true;
+				}
+				else if (key == "--durations")
+				{
+					options.Durations = value;
+				}
+				else if (key == "--history")
+				{
+					options.Durations     = value;
+					options.DurationsSave = value;
+				}
+				else if (key == "--durations-save")
+				{
+					options.DurationsSave = value.empty() ? std::string("-") : value;
+				}
+				else if (key == "--results")
+				{
+					options.ResultsFilename = value.empty() ? std::string("bitter.results") : value;
+				}
+				else if (key == "--rerun-failed")
+				{
+					options.RerunFailed = true;
+				}
+				else if (key == "--cache")
+				{
+					options.UseCache = true;
+				}
+				else if (key == "--seed")
+				{
+					options.Seed    = std::strtoull(value.c_str(), nullptr, 10);
+					options.HasSeed = true;
+				}
+				else if (key == "--trials")
+				{
+					options.Trials = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10));
+				}
+				else if (key == "--repeat")
+				{
+					options.Repeat = std::max<uint64_t>(std::strtoull(value.c_str(), nullptr, 10), 1);
+				}
+				else if (key == "--duration")
+				{
+					if (!ParseDuration(value, options.SoakDuration))
+					{
+						std::cerr << "Invalid duration:" << argument << ENDLINE;
+					}
+				}
+				else if (key == "--concurrency")
+				{
+					const long concurrency = std::strtol(value.c_str(), nullptr, 10);
+					options.Concurrency    = concurrency > 0 ? static_cast<unsigned int>(concurrency) : std::max(1u, std::thread::hardware_concurrency());
+				}
+				else if (key == "--shuffle")
+				{
+					options.Shuffle = true;
+				}
+				else if (key == "--snapshot-dir")
+				{
+					options.SnapshotDirectory = value;
+				}
+				else if (key == "--update-snapshots")
+				{
+					options.UpdateSnapshots = true;
+				}
+				else if (key == "--isolate")
+				{
+#if defined(BITTER_HAS_FORK)
+					options.Isolate = true;
+#else
+					std::cerr << "--isolate is not supported on this platform, the cases run in process" << ENDLINE;
+#endif
+				}
+				else if (key == "--timeout")
+				{
+					if (!ParseDuration(value, options.Timeout))
+					{
+						std::cerr << "Invalid duration:" << argument << ENDLINE;
+					}
+				}
+				else
+				{
+					std::cerr << "Unknown argument:" << argument << ENDLINE;
+				}
+			}
+			if (options.ShardCount == 0 || options.ShardIndex >= options.ShardCount)
+			{
+				std::cerr << "Invalid shard " << options.ShardIndex << " of " << options.ShardCount << ", running every shard" << ENDLINE;
+				options.ShardIndex = 0;
+				options.ShardCount = 1;
+			}
+			if ((options.RerunFailed || options.UseCache) && options.ResultsFilename.empty())
+			{
+				options.ResultsFilename = "bitter.results";
+			}
+			if (options.DurationsSave == "-")
+			{
+				options.DurationsSave = options.Durations.empty() ? std::string("bitter.durations") : options.Durations;
+			}
+			if (options.BenchmarkSave == "-")
+			{
+				options.BenchmarkSave = options.BenchmarkBaseline.empty() ? std::string("benchmarks.baseline") : options.BenchmarkBaseline;
+			}
+			return options;
+		};
+
+		/*Parse a duration like 500ms or 2.5s, the units are ns, us, ms, s, m and h and a number without unit is in seconds*/
+		inline static bool ParseDuration(const std::string& text, std::chrono::nanoseconds& duration)
+		{
+			char*        end   = nullptr;
+			const double value = std::strtod(text.c_str(), &end);
+			if (end == text.c_str() || !(value >= 0.))
+			{
+				return false;
+			}
+			static const std::pair<const char*, double> units[] = { { "ns", 1. }, { "us", 1e3 }, { "ms", 1e6 }, { "s", 1e9 }, { "", 1e9 }, { "m", 60e9 }, { "h", 3600e9 } };
+			for (const auto& unit : units)
+			{
+				if (std::strcmp(end, unit.first) == 0)
+				{
+					// the maximum of int64_t rounds up to 2^63 as a double, a duration that can't be converted back is rejected
+					if (value * unit.second >= static_cast<double>(std::numeric_limits<int64_t>::max()))
+					{
+						return false;
+					}
+					duration = std::chrono::nanoseconds(static_cast<int64_t>(value * unit.second));
+					return true;
+				}
+			}
+			return false;
+		};
+
+		/*Read a baseline written by SaveBenchmarkBaseline, every line is: Class.Case<tab>median<tab>samples separated by spaces, optionally followed
+		by <tab>cycles instructions cache misses branch misses per iteration*/
+		inline static bool LoadBenchmarkBaseline(const std::string& filename, std::map<std::string, DBenchmarkBaseline>& baseline)
+		{
+			std::ifstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			std::string line;
+			while (std::getline(file, line))
+			{
+				const size_t nameEnd   = line.find('\t');
+				const size_t medianEnd = nameEnd == std::string::npos ? std::string::npos : line.find('\t', nameEnd + 1);
+				if (line.empty() || line[0] == '#' || medianEnd == std::string::npos)
+				{
+					continue;
+				}
+				const size_t       samplesEnd = line.find('\t', medianEnd + 1);
+				DBenchmarkBaseline entry;
+				entry.Median = std::strtod(line.c_str() + nameEnd + 1, nullptr);
+				std::istringstream samples(line.substr(medianEnd + 1, samplesEnd == std::string::npos ? std::string::npos : samplesEnd - medianEnd - 1));
+				double             sample;
+				while (samples >> sample)
+				{
+					entry.Samples.push_back(sample);
+				}
+				if (samplesEnd != std::string::npos)
+				{
+					std::istringstream counters(line.substr(samplesEnd + 1));
+					counters >> entry.Counters.Cycles >> entry.Counters.Instructions >> entry.Counters.CacheMisses >> entry.Counters.BranchMisses;
+				}
+				baseline[line.substr(0, nameEnd)] = std::move(entry);
+			}
+			return true;
+		};
+
+		inline static bool SaveBenchmarkBaseline(const std::string& filename, const std::map<std::string, DBenchmarkBaseline>& baseline)
+		{
+			std::ofstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file << "# Bitter benchmark baseline: name, median ns per iteration, samples, cycles instructions cache misses branch misses per iteration" << ENDLINE;
+			file << std::setprecision(std::numeric_limits<double>::max_digits10);
+			for (const auto& entry : baseline)
+			{
+				file << entry.first << '\t' << entry.second.Median << '\t';
+				for (size_t i = 0; i < entry.second.Samples.size(); i++)
+				{
+					file << (i ? " " : "") << entry.second.Samples[i];
+				}
+				const DHardwareCounters& counters = entry.second.Counters;
+				if (counters.HasAny())
+				{
+					file << '\t' << counters.Cycles << ' ' << counters.Instructions << ' ' << counters.CacheMisses << ' ' << counters.BranchMisses;
+				}
+				file << ENDLINE;
+			}
+			return file.good();
+		};
+
+		/*Read the results written by SaveResults. A class line: class<tab>complete<tab>fingerprint<tab>name, followed by its log line:
+		log<tab>text and a line per case: case<tab>status<tab>nanoseconds<tab>name<tab>messages. The fields are escaped with __escapeField*/
+		inline static bool LoadResults(const std::string& filename, std::map<std::string, DRecordedClass>& results)
+		{
+			std::ifstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			DRecordedClass* current = nullptr;
+			std::string     line;
+			while (std::getline(file, line))
+			{
+				std::vector<std::string> fields;
+				for (size_t start = 0;;)
+				{
+					const size_t end = line.find('\t', start);
+					fields.push_back(__unescapeField(line.substr(start, end - start)));
+					if (end == std::string::npos)
+					{
+						break;
+					}
+					start = end + 1;
+				}
+				if (fields[0] == "class" && fields.size() == 4)
+				{
+					current              = &results[fields[3]];
+					*current             = DRecordedClass();
+					current->Complete    = fields[1] == "1";
+					current->Fingerprint = fields[2];
+				}
+				else if (fields[0] == "log" && fields.size() == 2 && current)
+				{
+					current->Log = fields[1];
+				}
+				else if (fields[0] == "case" && fields.size() == 5 && current)
+				{
+					DCaseResult result;
+					result.Status   = __parseStatus(fields[1]);
+					result.Duration = std::chrono::nanoseconds(std::strtoll(fields[2].c_str(), nullptr, 10));
+					result.Name     = fields[3];
+					result.Messages = fields[4];
+					current->Cases.push_back(std::move(result));
+				}
+			}
+			return true;
+		};
+
+		inline static bool SaveResults(const std::string& filename, const std::map<std::string, DRecordedClass>& results)
+		{
+			std::ofstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file << "# Bitter results" << ENDLINE;
+			for (const auto& entry : results)
+			{
+				file << "class\t" << (entry.second.Complete ? 1 : 0) << '\t' << __escapeField(entry.second.Fingerprint) << '\t' << __escapeField(entry.first) << ENDLINE;
+				file << "log\t" << __escapeField(entry.second.Log) << ENDLINE;
+				for (const DCaseResult& result : entry.second.Cases)
+				{
+					file << "case\t" << __statusName(result.Status) << '\t' << result.Duration.count() << '\t' << __escapeField(result.Name) << '\t'
+						 << __escapeField(result.Messages) << ENDLINE;
+				}
+			}
+			return file.good();
+		};
+
+		/*Read the case durations written by SaveDurations, every line is: Class.Case<tab>nanoseconds*/
+		inline static bool LoadDurations(const std::string& filename, std::map<std::string, std::chrono::nanoseconds>& durations)
+		{
+			std::ifstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			std::string line;
+			while (std::getline(file, line))
+			{
+				const size_t nameEnd = line.rfind('\t');
+				if (line.empty() || line[0] == '#' || nameEnd == std::string::npos)
+				{
+					continue;
+				}
+				durations[line.substr(0, nameEnd)] = std::chrono::nanoseconds(std::strtoll(line.c_str() + nameEnd + 1, nullptr, 10));
+			}
+			return true;
+		};
+
+		inline static bool SaveDurations(const std::string& filename, const std::map<std::string, std::chrono::nanoseconds>& durations)
+		{
+			std::ofstream file(filename);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file << "# Bitter case durations: name, nanoseconds" << ENDLINE;
+			for (const auto& entry : durations)
+			{
+				file << entry.first << '\t' << entry.second.count() << ENDLINE;
+			}
+			return file.good();
+		};
+
+	private:
+		/*A class that can be run, added with AddTest or registered statically*/
+		struct DTestClass
+		{
+			std::string Name;
+			AutomatedTestInstance* (*Create)(void);
+			const TestFactory* Factory;
+			FixturesDeclare    DeclareFixtures;
+
+			inline AutomatedTestInstance* Construct() const { return Create ? Create() : (*Factory)(); };
+		};
+
+		/*A class added with AddTest*/
+		struct DAddedClass
+		{
+			TestFactory     Factory;
+			FixturesDeclare DeclareFixtures;
+		};
+
+		explicit AutomationTester(bool useStaticRegistry) : _useStaticRegistry(useStaticRegistry) {};
+
+		/*Sort the classes added with AddTest and the static registry by name*/
+		inline void IndexTestClasses()
+		{
+			_classes.clear();
+			_classes.reserve(_tests.size());
+			for (const auto& test : _tests)
+			{
+				_classes.push_back({ test.first, nullptr, &test.second.Factory, test.second.DeclareFixtures });
+			}
+			const size_t numAdded = _classes.size();
+			for (DTestRegistration* registration = _useStaticRegistry ? __testRegistryHead() : nullptr; registration; registration = registration->Next)
+			{
+				_classes.push_back({ registration->Name, registration->Create, nullptr, registration->DeclareFixtures });
+			}
+			// Both sorts are stable so that a duplicated name keeps the last registration like AddTest overwrites a class,
+			// the classes added with AddTest come first and the list starts with the last static registration
+			std::stable_sort(_classes.begin() + static_cast<std::ptrdiff_t>(numAdded), _classes.end(),
+							 [](const DTestClass& a, const DTestClass& b) { return a.Name < b.Name; });
+			std::inplace_merge(_classes.begin(), _classes.begin() + static_cast<std::ptrdiff_t>(numAdded), _classes.end(),
+							   [](const DTestClass& a, const DTestClass& b) { return a.Name < b.Name; });
+
+			const auto sameName  = [](const DTestClass& a, const DTestClass& b) { return a.Name == b.Name; };
+			bool       duplicate = false;
+			for (auto it = std::adjacent_find(_classes.begin(), _classes.end(), sameName); it != _classes.end(); it = std::adjacent_find(it + 1, _classes.end(), sameName))
+			{
+				if (it == _classes.begin() || (it - 1)->Name != it->Name)
+				{
+					std::cerr << "Test class registered more than once, the last registration replaces the others:" << it->Name << ENDLINE;
+				}
+				duplicate = true;
+			}
+			if (duplicate)
+			{
+				_classes.erase(std::unique(_classes.begin(), _classes.end(), sameName), _classes.end());
+			}
+		};
+
+		std::ofstream                      _outstream;
+		std::unique_ptr<AsyncStreamBuffer> _bufferedOutput;
+		std::unique_ptr<std::ostream>      _bufferedStream;
+#if defined(BITTER_HAS_FORK)
+		int _crashFd{ -1 }; // Where the buffered output is written on a crash, -1 when the log couldn't be opened again
+#endif
+
+		inline std::ostream& GetDestination()
+		{
+			if (_outstream.is_open())
+			{
+				return _outstream;
+			}
+
+			return std::cerr;
+		};
+
+		inline void SetupOutstream(const DRunOptions& options)
+		{
+			if (!options.LogFilename.empty())
+			{
+				_outstream.open(options.LogFilename);
+				if (_outstream.is_open())
+				{
+					std::cerr << "Writing to file:" << options.LogFilename;
+				}
+				else
+				{
+					std::cerr << "Could not create log with filename:" << options.LogFilename;
+				}
+			}
+#if defined(BITTER_HAS_FORK)
+			// with --isolate the workers are forked all along the run, the runner then has no other thread that could hold a lock in the child
+			const bool background = !options.Isolate;
+			// the crash handler appends to the log through its own descriptor, after what the stream already wrote
+			_crashFd              = _outstream.is_open() ? ::open(options.LogFilename.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC) : STDERR_FILENO;
+			const int crashFd     = _crashFd;
+#else
+			const bool background = true;
+			const int  crashFd    = -1;
+#endif
+			_bufferedOutput.reset(new AsyncStreamBuffer(GetDestination().rdbuf(), 1 << 20, std::chrono::milliseconds(250), background, crashFd));
+			_bufferedStream.reset(new std::ostream(_bufferedOutput.get()));
+		};
+
+		inline void EndOutputStream()
+		{
+			GetOutstream().flush();
+			_bufferedStream.reset();
+			_bufferedOutput.reset();
+			GetDestination().flush();
+#if defined(BITTER_HAS_FORK)
+			if (_crashFd > STDERR_FILENO)
+			{
+				::close(_crashFd);
+			}
+			_crashFd = -1;
+#endif
+			if (_outstream.is_open())
+			{
+				_outstream.close();
+			}
+		};
+
+		/*Returns nullptr when no filename is given*/
+		inline static std::ostream* OpenReportFile(const std::string& filename, std::vector<std::unique_ptr<std::ofstream>>& files)
+		{
+			if (filename.empty())
+			{
+				return nullptr;
+			}
+			files.emplace_back(new std::ofstream(filename));
+			if (!files.back()->is_open())
+			{
+				std::cerr << "Could not create report with filename:" << filename << ENDLINE;
+				files.pop_back();
+				return nullptr;
+			}
+			return files.back().get();
+		};
+
+		/*True when some cases may not run, because of the filter, of the sharding or of --rerun-failed*/
+		inline bool IsSelecting() const { return _filter.IsActive() || _options.ShardCount > 1 || !_rerunCases.empty(); };
+
+		/*True when a case matches the filter and is in the run, also used on the recorded cases of a class replayed by --cache*/
+		inline bool IsCaseSelected(const std::string& className, const std::string& caseName) const
+		{
+			return (!_filter.IsActive() || _filter.MatchesCase(className, caseName)) && IsCaseInRun(className, caseName);
+		};
+
+		/*True when the filter matches a case, or one of the parameters of a chunk of TestCaseP. A parameter runs when the filter matches it, or
+		matches the chunk and no negative pattern excludes the parameter. The parameter names are only formatted when a pattern can tell them apart*/
+		inline bool MatchesFilter(const std::string& className, AutomatedTestInstance& testInstance, size_t index) const
+		{
+			if (!_filter.IsActive())
+			{
+				return true;
+			}
+			const std::string                       caseName = testInstance.GetTestName(index);
+			const bool                              matches  = _filter.MatchesCase(className, caseName);
+			AutomatedTestInstance::DParameterChunk* chunk    = testInstance.FindParameterChunk(index);
+			if (!chunk || (matches && !_filter.HasNegative()))
+			{
+				return matches;
+			}
+			// a chunk excluded as a whole doesn't look at its parameters
+			if (!matches && (_filter.Excludes(className, caseName) || !_filter.MayMatchCasePrefix(className, chunk->Name + "/")))
+			{
+				return false;
+			}
+			chunk->Matches                     = matches;
+			testInstance._parameterFilter      = &_filter;
+			testInstance._parameterFilterClass = className;
+			for (size_t i = chunk->Begin; i < chunk->End; i++)
+			{
+				if (testInstance.MatchesParameter(*chunk, i))
+				{
+					chunk->FilterParameters = true;
+					return true;
+				}
+			}
+			return false;
+		};
+
+		/*With --rerun-failed only the cases that failed in the results file are in the run. With sharding a case belongs to a shard by the hash
+		of its Class.Case name, so every node computes the same partition without talking to the others, or to the shard of the partition
+		planned by PlanShards with --shard-balance*/
+		inline bool IsCaseInRun(const std::string& className, const std::string& caseName) const
+		{
+			if (!_rerunCases.empty() && _rerunCases.count(className + "." + caseName) == 0)
+			{
+				return false;
+			}
+			if (_options.ShardCount <= 1)
+			{
+				return true;
+			}
+			if (_options.ShardBalance)
+			{
+				return _shardCases.count(className + "." + caseName) != 0;
+			}
+			const uint64_t hash = __hashString(caseName.data(), caseName.size(), __hashString(".", 1, __hashString(className.data(), className.size())));
+			return hash % _options.ShardCount == _options.ShardIndex;
+		};
+
+		/*Split the cases matching the filter between the shards so their summed durations are close: the longest case goes to the least loaded
+		shard first. A case without a recorded duration weighs the mean of the recorded ones. Every node must read the same durations file*/
+		inline void PlanShards(const std::vector<const DTestClass*>& classes)
+		{
+			std::vector<std::pair<std::string, int64_t>> cases;
+			int64_t                                      knownTotal{};
+			size_t                                       numKnown{};
+			_definedInstances.resize(_classes.size());
+			for (const DTestClass* testClass : classes)
+			{
+				// kept for the run, so that no class is defined twice
+				std::unique_ptr<AutomatedTestInstance>& testInstance = _definedInstances[static_cast<size_t>(testClass - _classes.data())];
+				if (!testInstance)
+				{
+					testInstance.reset(testClass->Construct());
+					testInstance->DefineCases();
+				}
+				for (size_t i = 0; i < testInstance->GetNumTests(); i++)
+				{
+					std::string name = testClass->Name + "." + testInstance->GetTestName(i);
+					if (!MatchesFilter(testClass->Name, *testInstance, i))
+					{
+						continue;
+					}
+					const auto    found  = _durations.find(name);
+					const int64_t weight = found != _durations.end() ? found->second.count() : -1;
+					if (weight >= 0)
+					{
+						knownTotal += weight;
+						numKnown++;
+					}
+					cases.emplace_back(std::move(name), weight);
+				}
+			}
+			const int64_t defaultWeight = numKnown > 0 ? std::max<int64_t>(1, knownTotal / static_cast<int64_t>(numKnown)) : 1;
+			for (auto& entry : cases)
+			{
+				entry.second = entry.second >= 0 ? entry.second : defaultWeight;
+			}
+			std::sort(cases.begin(), cases.end(), [](const std::pair<std::string, int64_t>& a, const std::pair<std::string, int64_t>& b) {
+				return a.second != b.second ? a.second > b.second : a.first < b.first;
+			});
+
+			std::vector<int64_t> loads(_options.ShardCount);
+			_shardCases.clear();
+			for (auto& entry : cases)
+			{
+				const size_t shard = static_cast<size_t>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+				loads[shard] += entry.second;
+				if (shard == _options.ShardIndex)
+				{
+					_shardCases.insert(std::move(entry.first));
+				}
+			}
+		};
+
+		/*Collect the shared fixtures declared by the classes of the run before running any of them, so that a fixture is kept until the last
+		of them ended. No class is constructed, the classes replayed from the results cache declare nothing*/
+		inline void DeclareFixtures(const std::vector<const DTestClass*>& classes)
+		{
+			_declaredFixtures.clear();
+			_declaredFixtures.resize(_classes.size());
+			for (const DTestClass* testClass : classes)
+			{
+				if (testClass->DeclareFixtures && !CachedClass(testClass->Name))
+				{
+					testClass->DeclareFixtures(_declaredFixtures[static_cast<size_t>(testClass - _classes.data())]);
+				}
+			}
+		};
+
+		/*The instance of a class defined by PlanShards, else a newly constructed and defined one, given the fixtures the class declared.
+		Each instance is given once, from any thread*/
+		inline std::unique_ptr<AutomatedTestInstance> DefinedInstance(const DTestClass& testClass)
+		{
+			const size_t                           index = static_cast<size_t>(&testClass - _classes.data());
+			std::unique_ptr<AutomatedTestInstance> testInstance;
+			if (index < _definedInstances.size() && _definedInstances[index])
+			{
+				testInstance = std::move(_definedInstances[index]);
+			}
+			else
+			{
+				testInstance.reset(testClass.Construct());
+				testInstance->DefineCases();
+			}
+			if (index < _declaredFixtures.size())
+			{
+				testInstance->_fixtureUsers = std::move(_declaredFixtures[index]._users);
+			}
+			return testInstance;
+		};
+
+		/*Sum of the recorded durations of the cases of a class in nanoseconds, -1 if none was recorded*/
+		inline int64_t RecordedClassDuration(const std::string& className) const
+		{
+			const std::string prefix = className + ".";
+			int64_t           total  = -1;
+			for (auto it = _durations.lower_bound(prefix); it != _durations.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+			{
+				total = std::max<int64_t>(total, 0) + it->second.count();
+			}
+			return total;
+		};
+
+		/*Recorded duration of a case in nanoseconds, -1 if it wasn't recorded*/
+		inline int64_t RecordedCaseDuration(const std::string& className, const char* caseName) const
+		{
+			const auto found = _durations.find(className + "." + caseName);
+			return found != _durations.end() ? found->second.count() : -1;
+		};
+
+		/*Order of the work for the longest processing time first rule, what has no estimate weighs the mean of the estimates.
+		Without any estimate the order doesn't change*/
+		inline static std::vector<size_t> LongestFirst(const std::vector<int64_t>& estimates)
+		{
+			int64_t knownTotal{};
+			size_t  numKnown{};
+			for (const int64_t estimate : estimates)
+			{
+				if (estimate >= 0)
+				{
+					knownTotal += estimate;
+					numKnown++;
+				}
+			}
+			const int64_t       defaultEstimate = numKnown > 0 ? knownTotal / static_cast<int64_t>(numKnown) : 0;
+			std::vector<size_t> order(estimates.size());
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				order[i] = i;
+			}
+			const auto weight = [&](size_t i) { return estimates[i] >= 0 ? estimates[i] : defaultEstimate; };
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return weight(a) > weight(b); });
+			return order;
+		};
+
+		/*Keep what the durations and the results files need of a completed class*/
+		inline void RecordClass(const DClassResult& classResult, const std::vector<DCaseResult>& cases, bool cached)
+		{
+			if (cached)
+			{
+				return;
+			}
+			if (!_options.DurationsSave.empty())
+			{
+				for (const DCaseResult& caseResult : cases)
+				{
+					_measuredDurations[classResult.Name + "." + caseResult.Name] = caseResult.Duration;
+				}
+			}
+			if (_options.ResultsFilename.empty())
+			{
+				return;
+			}
+			DRecordedClass&   recorded    = _recordedResults[classResult.Name];
+			const auto        found       = _fingerprints.find(classResult.Name);
+			const std::string fingerprint = found != _fingerprints.end() ? found->second : std::string();
+			if (recorded.Fingerprint != fingerprint)
+			{
+				recorded            = DRecordedClass();
+				recorded.Fingerprint = fingerprint;
+			}
+			for (const DCaseResult& caseResult : cases)
+			{
+				const auto previous = std::find_if(recorded.Cases.begin(), recorded.Cases.end(), [&](const DCaseResult& r) { return r.Name == caseResult.Name; });
+				if (previous != recorded.Cases.end())
+				{
+					*previous = caseResult;
+				}
+				else
+				{
+					recorded.Cases.push_back(caseResult);
+				}
+			}
+			recorded.Log      = classResult.Log;
+			recorded.Complete = recorded.Complete || !IsSelecting();
+		};
+
+		/*The recorded results of a class that can be replayed instead of running it, nullptr if its fingerprint changed*/
+		inline const DRecordedClass* CachedClass(const std::string& className) const
+		{
+			const auto fingerprint = _fingerprints.find(className);
+			if (!_options.UseCache || fingerprint == _fingerprints.end() || fingerprint->second.empty())
+			{
+				return nullptr;
+			}
+			const auto recorded = _recordedResults.find(className);
+			if (recorded == _recordedResults.end() || !recorded->second.Complete || recorded->second.Fingerprint != fingerprint->second)
+			{
+				return nullptr;
+			}
+			return &recorded->second;
+		};
+
+
+		/*Returns the index of the cases selected by the filter, the sharding and --rerun-failed*/
+		inline std::vector<size_t> SelectCases(const std::string& className, AutomatedTestInstance& testInstance) const
+		{
+			std::vector<size_t> selected;
+			selected.reserve(testInstance.GetNumTests());
+			const bool selecting = IsSelecting();
+			for (size_t i = 0; i < testInstance.GetNumTests(); i++)
+			{
+				if (!selecting || (MatchesFilter(className, testInstance, i) && IsCaseInRun(className, testInstance.GetTestName(i))))
+				{
+					selected.push_back(i);
+				}
+			}
+			return selected;
+		};
+
+		/*Construct, define and run the selected test cases of a class reporting every case as it completes, returns true if all passed.
+		A class without selected cases isn't reported*/
+		inline bool RunTestClass(const DTestClass& testClass)
+		{
+			const std::string&                     className = testClass.Name;
+			const auto                             start     = std::chrono::steady_clock::now();
+			std::unique_ptr<AutomatedTestInstance> testInstance = DefinedInstance(testClass);
+
+			const std::vector<size_t> selected = SelectCases(className, *testInstance);
+			if (selected.empty() && IsSelecting() && testInstance->_defined)
+			{
+				return false;
+			}
+			CountScheduledCases(selected.size());
+			_classesRun++;
+			{
+				std::lock_guard<std::timed_mutex> lock(_reportMutex);
+				_reportedClass = className;
+				for (Reporter* reporter : _activeReporters)
+				{
+					reporter->OnClassBegin(className);
+				}
+			}
+
+			DClassResult classResult;
+			classResult.Name     = className;
+			classResult.NumTests = selected.size();
+			std::vector<DCaseResult> recorded;
+			const bool               recording = !_options.DurationsSave.empty() || !_options.ResultsFilename.empty();
+			if (!selected.empty())
+			{
+				testInstance->BeginClass();
+				testInstance->RunAsyncTests(selected, _options.Timeout, WatchAsyncCases(className, *testInstance));
+			}
+			for (const size_t i : selected)
+			{
+				{
+					std::lock_guard<std::timed_mutex> lock(_reportMutex);
+					for (Reporter* reporter : _activeReporters)
+					{
+						reporter->OnCaseBegin(className, testInstance->_tests[i].Name);
+					}
+				}
+				// Run the test
+				const bool        result     = RunCase(className, *testInstance, i);
+				const DCaseResult caseResult = MakeCaseResult(*testInstance, i);
+				{
+					std::lock_guard<std::timed_mutex> lock(_reportMutex);
+					for (Reporter* reporter : _activeReporters)
+					{
+						reporter->OnCaseEnd(className, caseResult);
+					}
+				}
+				if (recording)
+				{
+					recorded.push_back(caseResult);
+				}
+				// Increment counter
+				classResult.NumPassed += static_cast<size_t>(result);
+			}
+			classResult.HooksPassed = selected.empty() ? testInstance->_defined : testInstance->EndClass();
+			classResult.Log         = testInstance->GetLog();
+			classResult.Duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			{
+				std::lock_guard<std::timed_mutex> lock(_reportMutex);
+				for (Reporter* reporter : _activeReporters)
+				{
+					reporter->OnClassEnd(classResult);
+				}
+				_reportedClass.clear();
+			}
+			RecordClass(classResult, recorded, false);
+			return classResult.Passed();
+		};
+
+		/*Run the selected cases again and again on --concurrency threads, for --repeat iterations or until --duration elapsed. Every thread
+		constructs its own instances of the classes and an iteration runs each selected case once, in the order they were defined or shuffled
+		by the --seed. A case is reported once with the statistics of its runs and the messages of its first failed iteration*/
+		inline unsigned int RunSoak(const std::vector<const DTestClass*>& classes)
+		{
+			struct DSoakCase
+			{
+				size_t Class;
+				size_t Index;
+			};
+			struct DSoakCaseStats
+			{
+				LatencyHistogram Latencies;
+				uint64_t         Failures{};
+				uint64_t         FirstFailed{};
+				std::string      Messages;
+			};
+
+			// the benchmark cases are left out, their repetitions are their own
+			std::vector<std::unique_ptr<AutomatedTestInstance>> definitions(classes.size());
+			std::vector<DSoakCase>                              cases;
+			for (size_t c = 0; c < classes.size(); c++)
+			{
+				definitions[c] = DefinedInstance(*classes[c]);
+				for (const size_t i : SelectCases(classes[c]->Name, *definitions[c]))
+				{
+					if (!definitions[c]->GetBenchmarkResult(i))
+					{
+						cases.push_back({ c, i });
+					}
+				}
+			}
+
+			const uint64_t              seed     = _options.HasSeed ? _options.Seed : AutomatedTestInstance::NewSeed();
+			const bool                  timed    = _options.SoakDuration > std::chrono::nanoseconds::zero();
+			// a timed soak has no end known in advance, its cases are counted as they run
+			CountScheduledCases(timed ? 0 : cases.size() * _options.Repeat);
+			const auto                  start    = std::chrono::steady_clock::now();
+			const auto                  deadline = start + _options.SoakDuration;
+			std::atomic<uint64_t>       nextIteration{ 1 };
+			std::atomic<uint64_t>       iterations{};
+			std::vector<DSoakCaseStats> stats(cases.size());
+			std::vector<std::mutex>     statsMutexes(64); // Striped by case
+			std::vector<char>           hooksPassed(classes.size(), 1);
+			std::vector<std::string>    logs(classes.size());
+			std::mutex                  classMutex;
+			const auto                  expired  = [&]() { return timed && std::chrono::steady_clock::now() >= deadline; };
+
+			const auto soak = [&]() {
+				std::vector<std::unique_ptr<AutomatedTestInstance>> instances(classes.size());
+				std::vector<size_t>                                 order(cases.size());
+				for (;;)
+				{
+					const uint64_t iteration = nextIteration++;
+					if ((_options.Repeat > 0 && iteration > _options.Repeat) || expired())
+					{
+						break;
+					}
+					for (size_t k = 0; k < order.size(); k++)
+					{
+						order[k] = k;
+					}
+					if (_options.Shuffle)
+					{
+						Random random(Random::Stream(seed, iteration));
+						for (size_t k = order.size(); k > 1; k--)
+						{
+							std::swap(order[k - 1], order[static_cast<size_t>(random.Below(k))]);
+						}
+					}
+					bool complete = true;
+					for (const size_t k : order)
+					{
+						if (expired())
+						{
+							complete = false;
+							break;
+						}
+						const DSoakCase&                        soakCase = cases[k];
+						std::unique_ptr<AutomatedTestInstance>& instance = instances[soakCase.Class];
+						if (!instance)
+						{
+							instance.reset(classes[soakCase.Class]->Construct());
+							instance->DefineCases();
+							instance->BeginClass();
+						}
+						const auto caseStart = std::chrono::steady_clock::now();
+						const bool passed    = RunCase(classes[soakCase.Class]->Name, *instance, soakCase.Index);
+						const auto latency   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - caseStart);
+
+						std::lock_guard<std::mutex> lock(statsMutexes[k % statsMutexes.size()]);
+						DSoakCaseStats&             caseStats = stats[k];
+						caseStats.Latencies.Add(latency);
+						if (!passed && (caseStats.Failures++ == 0 || iteration < caseStats.FirstFailed))
+						{
+							caseStats.FirstFailed = iteration;
+							caseStats.Messages    = instance->GetFailureMessages(soakCase.Index);
+						}
+					}
+					iterations += static_cast<uint64_t>(complete);
+				}
+				for (size_t c = 0; c < instances.size(); c++)
+				{
+					if (instances[c])
+					{
+						const bool                  ended = instances[c]->EndClass();
+						std::lock_guard<std::mutex> lock(classMutex);
+						hooksPassed[c] = static_cast<char>(hooksPassed[c] && ended);
+						logs[c] += instances[c]->GetLog();
+					}
+				}
+			};
+			std::vector<std::thread> threads;
+			for (unsigned int t = 1; t < _options.Concurrency; t++)
+			{
+				threads.emplace_back(soak);
+			}
+			soak();
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+			unsigned int passedClasses{};
+			uint64_t     runs{};
+			for (size_t c = 0, k = 0; c < classes.size(); c++)
+			{
+				const size_t first = k;
+				while (k < cases.size() && cases[k].Class == c)
+				{
+					k++;
+				}
+				if (first == k && IsSelecting() && definitions[c]->_defined)
+				{
+					continue;
+				}
+				_classesRun++;
+				const std::string& className = classes[c]->Name;
+				for (Reporter* reporter : _activeReporters)
+				{
+					reporter->OnClassBegin(className);
+				}
+				DClassResult classResult;
+				classResult.Name     = className;
+				classResult.NumTests = k - first;
+				for (size_t i = first; i < k; i++)
+				{
+					const DSoakCaseStats& caseStats = stats[i];
+					DCaseResult           result;
+					result.Name                      = definitions[c]->_tests[cases[i].Index].Name;
+					result.Soak.Runs                 = caseStats.Latencies.Count();
+					result.Soak.Failures             = caseStats.Failures;
+					result.Soak.FirstFailedIteration = caseStats.Failures > 0 ? static_cast<int64_t>(caseStats.FirstFailed) : -1;
+					result.Soak.P50                  = caseStats.Latencies.Percentile(0.5);
+					result.Soak.P90                  = caseStats.Latencies.Percentile(0.9);
+					result.Soak.P99                  = caseStats.Latencies.Percentile(0.99);
+					result.Soak.Max                  = caseStats.Latencies.Max();
+					result.Status                    = caseStats.Failures > 0 ? ETestStatus::FAILED : (result.Soak.Runs > 0 ? ETestStatus::PASSED : ETestStatus::NOT_TESTED);
+					result.Duration                  = result.Soak.P50;
+					result.Messages                  = caseStats.Messages;
+					runs += result.Soak.Runs;
+					for (Reporter* reporter : _activeReporters)
+					{
+						reporter->OnCaseBegin(className, result.Name);
+						reporter->OnCaseEnd(className, result);
+					}
+					classResult.NumPassed += static_cast<size_t>(result.Status == ETestStatus::PASSED);
+				}
+				classResult.HooksPassed = hooksPassed[c] != 0 && definitions[c]->_defined;
+				classResult.Log         = logs[c];
+				classResult.Duration    = elapsed;
+				for (Reporter* reporter : _activeReporters)
+				{
+					reporter->OnClassEnd(classResult);
+				}
+				passedClasses += static_cast<unsigned int>(classResult.Passed());
+			}
+
+			const double  seconds = std::max(static_cast<double>(elapsed.count()) / 1e9, 1e-9);
+			std::ostream& out     = GetOutstream();
+			const auto    flags   = out.flags();
+			out << TEXT_WHITE << "Soak of " << iterations.load() << " iterations and " << runs << " runs on " << _options.Concurrency << " threads in " << std::fixed
+				<< std::setprecision(3) << seconds << "s, " << static_cast<double>(iterations.load()) / seconds << " iterations/s and " << static_cast<double>(runs) / seconds
+				<< " runs/s";
+			out.flags(flags);
+			if (_options.Shuffle)
+			{
+				out << ", shuffled with --seed=" << seed;
+			}
+			out << ENDLINE;
+			return passedClasses;
+		};
+
+		/*State shared by the tasks running the cases of a single class*/
+		struct DClassRun
+		{
+			std::unique_ptr<AutomatedTestInstance> Instance; // Null with --isolate, the workers construct the classes
+			std::vector<size_t>                    Selected;
+			std::vector<std::string>               CaseNames; // Of the selected cases, received from the worker that defined the class with --isolate
+			std::vector<std::chrono::nanoseconds>  Timeouts;
+			bool                                   Parallel{};
+			std::vector<DCaseResult>               Cases;
+			DClassResult                           Result;
+			std::atomic<size_t>                    Remaining{};
+			std::chrono::steady_clock::time_point  Start{ std::chrono::steady_clock::now() };
+		};
+
+		/*Run the classes as tasks of a work stealing scheduler, the results of a class are reported once it completed and in the class order.
+		With ParallelCases the classes that allow it spawn a task for each of their cases*/
+		inline unsigned int RunTestClassesParallel(const std::vector<const DTestClass*>& classes)
+		{
+			std::vector<std::shared_ptr<DClassRun>> runs(classes.size());
+			std::vector<char>                       finished(classes.size());
+			std::mutex                              finishedMutex;
+			std::condition_variable                 classFinished;
+
+			// Called by the task completing the last case of a class
+			const auto finishClass = [&](size_t i) {
+				DClassRun& run      = *runs[i];
+				run.Result.Name     = classes[i]->Name;
+				run.Result.NumTests = run.Cases.size();
+				for (const DCaseResult& caseResult : run.Cases)
+				{
+					run.Result.NumPassed += static_cast<size_t>(caseResult.Status == ETestStatus::PASSED);
+				}
+				run.Result.HooksPassed = run.Cases.empty() ? run.Instance->_defined : run.Instance->EndClass();
+				run.Result.Log         = run.Instance->GetLog();
+				run.Result.Duration    = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - run.Start);
+				run.Instance.reset();
+				{
+					std::lock_guard<std::mutex> lock(finishedMutex);
+					finished[i] = 1;
+				}
+				classFinished.notify_all();
+			};
+
+			unsigned int testPassed{};
+			{
+				TaskScheduler scheduler(_options.ParallelCases ? _options.Jobs : static_cast<unsigned int>(std::min<size_t>(_options.Jobs, classes.size())));
+				std::vector<int64_t> classEstimates(classes.size());
+				for (size_t i = 0; i < classes.size(); i++)
+				{
+					runs[i]           = std::make_shared<DClassRun>();
+					classEstimates[i] = RecordedClassDuration(classes[i]->Name);
+				}
+				std::vector<std::function<void(void)>> classTasks;
+				classTasks.reserve(classes.size());
+				for (const size_t i : LongestFirst(classEstimates))
+				{
+					if (CachedClass(classes[i]->Name))
+					{
+						continue;
+					}
+					classTasks.push_back([&, i]() {
+						const std::string& className = classes[i]->Name;
+						DClassRun&         run       = *runs[i];
+						run.Start                    = std::chrono::steady_clock::now();
+						run.Instance = DefinedInstance(*classes[i]);
+
+						run.Selected          = SelectCases(className, *run.Instance);
+						const size_t numTests = run.Selected.size();
+						CountScheduledCases(numTests);
+						run.Cases.resize(numTests);
+						if (numTests > 0)
+						{
+							run.Instance->BeginClass();
+						}
+						if (!_options.ParallelCases || !run.Instance->CanRunCasesInParallel() || numTests < 2)
+						{
+							run.Instance->RunAsyncTests(run.Selected, _options.Timeout, WatchAsyncCases(className, *run.Instance));
+							for (size_t c = 0; c < numTests; c++)
+							{
+								RunCase(className, *run.Instance, run.Selected[c]);
+								run.Cases[c] = MakeCaseResult(*run.Instance, run.Selected[c]);
+							}
+							finishClass(i);
+							return;
+						}
+
+						run.Remaining = numTests;
+						std::vector<int64_t> caseEstimates(numTests);
+						for (size_t c = 0; c < numTests; c++)
+						{
+							caseEstimates[c] = RecordedCaseDuration(className, run.Instance->GetTestName(run.Selected[c]));
+						}
+						std::vector<std::function<void(void)>> caseTasks;
+						caseTasks.reserve(numTests);
+						for (const size_t c : LongestFirst(caseEstimates))
+						{
+							caseTasks.push_back([&, i, c]() {
+								DClassRun& caseRun = *runs[i];
+								RunCase(classes[i]->Name, *caseRun.Instance, caseRun.Selected[c]);
+								caseRun.Cases[c] = MakeCaseResult(*caseRun.Instance, caseRun.Selected[c]);
+								if (--caseRun.Remaining == 0)
+								{
+									finishClass(i);
+								}
+							});
+						}
+						scheduler.SubmitBatch(std::move(caseTasks));
+					});
+				}
+				scheduler.SubmitBatch(std::move(classTasks));
+
+				for (size_t i = 0; i < classes.size(); i++)
+				{
+					if (const DRecordedClass* cached = CachedClass(classes[i]->Name))
+					{
+						testPassed += static_cast<unsigned int>(ReplayCachedClass(classes[i]->Name, *cached));
+						runs[i].reset();
+						continue;
+					}
+					{
+						std::unique_lock<std::mutex> lock(finishedMutex);
+						classFinished.wait(lock, [&]() { return finished[i] != 0; });
+					}
+					if (!runs[i]->Cases.empty() || !IsSelecting() || !runs[i]->Result.HooksPassed)
+					{
+						_classesRun++;
+						ReplayClass(*runs[i]);
+						testPassed += static_cast<unsigned int>(runs[i]->Result.Passed());
+					}
+					runs[i].reset();
+				}
+			}
+			return testPassed;
+		};
+
+		/*Deliver the results of a class that already completed to the reporters, the timeout of a case still running waits for the end of the class*/
+		inline void ReplayClass(const DClassRun& run, bool cached = false)
+		{
+			std::unique_lock<std::timed_mutex> lock(_reportMutex);
+			for (Reporter* reporter : _activeReporters)
+			{
+				reporter->OnClassBegin(run.Result.Name);
+			}
+			for (const DCaseResult& caseResult : run.Cases)
+			{
+				for (Reporter* reporter : _activeReporters)
+				{
+					reporter->OnCaseBegin(run.Result.Name, caseResult.Name);
+					reporter->OnCaseEnd(run.Result.Name, caseResult);
+				}
+			}
+			for (Reporter* reporter : _activeReporters)
+			{
+				reporter->OnClassEnd(run.Result);
+			}
+			lock.unlock();
+			RecordClass(run.Result, run.Cases, cached);
+		};
+
+		/*Report the recorded results of a class whose fingerprint didn't change instead of running it, returns true if they all passed*/
+		inline bool ReplayCachedClass(const std::string& className, const DRecordedClass& recorded)
+		{
+			DClassRun run;
+			run.Result.Name = className;
+			run.Result.Log  = recorded.Log;
+			for (const DCaseResult& caseResult : recorded.Cases)
+			{
+				if (!IsSelecting() || IsCaseSelected(className, caseResult.Name))
+				{
+					run.Cases.push_back(caseResult);
+					run.Cases.back().Cached = true;
+					run.Result.NumPassed += static_cast<size_t>(caseResult.Status == ETestStatus::PASSED);
+					run.Result.Duration += caseResult.Duration;
+				}
+			}
+			if (run.Cases.empty() && IsSelecting())
+			{
+				return false;
+			}
+			run.Result.NumTests = run.Cases.size();
+			_classesRun++;
+			ReplayClass(run, true);
+			return run.Result.Passed();
+		};
+
+#if defined(BITTER_HAS_FORK)
+		/*Sent to a worker process to define a class, to run one of its cases or its AfterAll*/
+		struct DWorkerAssignment
+		{
+			static constexpr uint32_t Define   = std::numeric_limits<uint32_t>::max();
+			static constexpr uint32_t EndClass = std::numeric_limits<uint32_t>::max() - 1;
+
+			uint32_t Class;
+			uint32_t Case; // Define to define the class, EndClass to run its AfterAll
+		};
+
+		/*Sent back by a worker once it defined a class, followed by the class log then by a DWorkerCase and the name of every selected case*/
+		struct DWorkerDefinition
+		{
+			int32_t  Defined;
+			int32_t  Parallel;
+			uint64_t NumSelected;
+			uint64_t LogSize;
+		};
+
+		struct DWorkerCase
+		{
+			uint64_t Index;
+			int64_t  Timeout;
+			uint64_t NameSize;
+		};
+
+		/*Sent back by a worker once it ran the AfterAll of a class, followed by the class log*/
+		struct DWorkerHooks
+		{
+			int32_t  Passed;
+			uint64_t LogSize;
+		};
+
+		/*Sent back by a worker once the case completed, followed by the failure messages, the class log and the benchmark samples*/
+		struct DWorkerResult
+		{
+			uint32_t          Class;
+			uint32_t          Case;
+			int32_t           Status;
+			int32_t           IsBenchmark;
+			int64_t           Duration;
+			uint64_t          MessagesSize;
+			uint64_t          LogSize;
+			uint64_t          NumSamples;
+			uint64_t          Iterations;
+			double            Min;
+			double            Median;
+			double            P99;
+			double            Mean;
+			double            StdDev;
+			DAllocationStats  Allocations;
+			DHardwareCounters Counters;
+		};
+
+		/*A class is defined by a job of its own, then its cases run in order on the same worker. A class calling SetRunCasesInParallel(true)
+		has a job per case. Every worker that ran cases of a class runs its AfterAll in a job of its own once no case of the class is left to start*/
+		struct DIsolatedJob
+		{
+			size_t              Class;
+			std::vector<size_t> Cases; // Positions in DClassRun::Selected
+			bool                Define{};
+			bool                End{};
+		};
+
+		struct DWorkerProcess
+		{
+			pid_t                                 Pid{ -1 };
+			int                                   ToWorker{ -1 };
+			int                                   FromWorker{ -1 };
+			size_t                                Job{ NoJob };
+			size_t                                Position{}; // Case of the job in execution
+			std::vector<size_t>                   Begun;      // Classes whose BeforeAll ran in the worker, each owes an AfterAll job
+			std::chrono::steady_clock::time_point Start;
+			std::chrono::steady_clock::time_point Deadline;
+		};
+
+		static constexpr size_t NoJob = std::numeric_limits<size_t>::max();
+
+		inline static bool WriteAll(int fd, const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			while (size > 0)
+			{
+				const ssize_t written = ::write(fd, bytes, size);
+				if (written < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (written <= 0)
+				{
+					return false;
+				}
+				bytes += written;
+				size -= static_cast<size_t>(written);
+			}
+			return true;
+		};
+
+		inline static bool ReadAll(int fd, void* data, size_t size)
+		{
+			char* bytes = static_cast<char*>(data);
+			while (size > 0)
+			{
+				const ssize_t received = ::read(fd, bytes, size);
+				if (received < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				if (received <= 0)
+				{
+					return false;
+				}
+				bytes += received;
+				size -= static_cast<size_t>(received);
+			}
+			return true;
+		};
+
+		/*Run every class in a pool of forked worker processes, a case that crashes or exceeds its timeout takes down only its worker which is
+		replaced. The runner never constructs the classes: a worker defines a class and sends back its selected cases, then runs them on its own
+		instance. The workers are forked while the runner has no other thread. Reported like RunTestClassesParallel*/
+		inline unsigned int RunTestClassesIsolated(const std::vector<const DTestClass*>& classes)
+		{
+			std::vector<std::unique_ptr<DClassRun>> runs(classes.size());
+			std::vector<DIsolatedJob>               jobs;
+			std::vector<int64_t>                    jobEstimates;
+			for (size_t i = 0; i < classes.size(); i++)
+			{
+				runs[i].reset(new DClassRun());
+				if (CachedClass(classes[i]->Name))
+				{
+					continue;
+				}
+				// the cases run in different processes, the class duration is the sum of the case durations
+				runs[i]->Result.Name = classes[i]->Name;
+				runs[i]->Remaining   = 1; // Until the class is defined
+				jobs.push_back({ i, {}, true });
+				jobEstimates.push_back(RecordedClassDuration(classes[i]->Name));
+			}
+			// the longest classes are defined first, their cases follow on the same worker
+			std::deque<size_t> pending;
+			for (const size_t j : LongestFirst(jobEstimates))
+			{
+				pending.push_back(j);
+			}
+
+			// a write to a crashed worker must fail instead of killing the runner
+			void (*previousPipeHandler)(int) = ::signal(SIGPIPE, SIG_IGN);
+			std::vector<DWorkerProcess> workers(std::min<size_t>(std::max(1u, _options.Jobs), std::max<size_t>(jobs.size(), 1)));
+			for (DWorkerProcess& worker : workers)
+			{
+				SpawnWorker(worker, workers, classes);
+			}
+
+			unsigned int testPassed{};
+			size_t       nextReport{};
+			std::vector<pollfd> polled;
+			std::vector<size_t> polledWorkers;
+			for (;;)
+			{
+				for (; nextReport < runs.size() && runs[nextReport]->Remaining == 0; nextReport++)
+				{
+					if (const DRecordedClass* cached = CachedClass(classes[nextReport]->Name))
+					{
+						testPassed += static_cast<unsigned int>(ReplayCachedClass(classes[nextReport]->Name, *cached));
+						runs[nextReport].reset();
+						continue;
+					}
+					DClassRun& run      = *runs[nextReport];
+					run.Result.NumTests = run.Cases.size();
+					for (const DCaseResult& caseResult : run.Cases)
+					{
+						run.Result.NumPassed += static_cast<size_t>(caseResult.Status == ETestStatus::PASSED);
+						run.Result.Duration += caseResult.Duration;
+					}
+					if (!run.Cases.empty() || !IsSelecting() || !run.Result.HooksPassed)
+					{
+						_classesRun++;
+						ReplayClass(run);
+						testPassed += static_cast<unsigned int>(run.Result.Passed());
+						// without the background writer the output is written as the classes complete
+						GetOutstream().flush();
+					}
+					runs[nextReport].reset();
+				}
+				if (nextReport == runs.size())
+				{
+					break;
+				}
+
+				bool anyWorker = false;
+				for (DWorkerProcess& worker : workers)
+				{
+					if (worker.Pid > 0 && worker.Job == NoJob && NextJob(worker, jobs, pending))
+					{
+						DispatchCase(worker, workers, jobs, runs, classes);
+					}
+					anyWorker = anyWorker || worker.Pid > 0;
+				}
+				if (!anyWorker)
+				{
+					// no worker could be started, fail what is left instead of waiting forever
+					for (; !pending.empty(); pending.pop_front())
+					{
+						FailJob(jobs[pending.front()], runs, "could not start a worker process");
+					}
+					continue;
+				}
+
+				auto now      = std::chrono::steady_clock::now();
+				auto deadline = std::chrono::steady_clock::time_point::max();
+				polled.clear();
+				polledWorkers.clear();
+				for (size_t w = 0; w < workers.size(); w++)
+				{
+					if (workers[w].Pid > 0 && workers[w].Job != NoJob)
+					{
+						polled.push_back({ workers[w].FromWorker, POLLIN, 0 });
+						polledWorkers.push_back(w);
+						deadline = std::min(deadline, workers[w].Deadline);
+					}
+				}
+				int waitMs = -1;
+				if (deadline != std::chrono::steady_clock::time_point::max())
+				{
+					waitMs = static_cast<int>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1));
+				}
+				if (::poll(polled.data(), static_cast<nfds_t>(polled.size()), waitMs) < 0 && errno != EINTR)
+				{
+					break;
+				}
+
+				now = std::chrono::steady_clock::now();
+				for (size_t p = 0; p < polled.size(); p++)
+				{
+					DWorkerProcess& worker = workers[polledWorkers[p]];
+					if (polled[p].revents != 0)
+					{
+						if (!ReceiveResult(worker, jobs, pending, runs, classes))
+						{
+							FailWorker(worker, workers, jobs, runs, classes, false);
+						}
+						else if (worker.Job != NoJob)
+						{
+							DispatchCase(worker, workers, jobs, runs, classes);
+						}
+					}
+					else if (now >= worker.Deadline)
+					{
+						FailWorker(worker, workers, jobs, runs, classes, true);
+					}
+				}
+			}
+
+			for (DWorkerProcess& worker : workers)
+			{
+				StopWorker(worker, false);
+			}
+			::signal(SIGPIPE, previousPipeHandler);
+			return testPassed;
+		};
+
+		/*Fork a worker process waiting for assignments on a pipe*/
+		inline bool SpawnWorker(DWorkerProcess& worker, std::vector<DWorkerProcess>& workers, const std::vector<const DTestClass*>& classes)
+		{
+			int toWorker[2];
+			int fromWorker[2];
+			if (::pipe(toWorker) != 0)
+			{
+				return false;
+			}
+			if (::pipe(fromWorker) != 0)
+			{
+				::close(toWorker[0]);
+				::close(toWorker[1]);
+				return false;
+			}
+			// the buffered output must not be duplicated by the child
+			GetOutstream().flush();
+			std::cout.flush();
+			std::fflush(nullptr);
+
+			const pid_t pid = ::fork();
+			if (pid == 0)
+			{
+				for (const DWorkerProcess& other : workers)
+				{
+					if (&other != &worker && other.Pid > 0)
+					{
+						::close(other.ToWorker);
+						::close(other.FromWorker);
+					}
+				}
+				::close(toWorker[1]);
+				::close(fromWorker[0]);
+				// the watchdog thread only exists in the parent, the parent also enforces the timeouts
+				(void)_watchdog.release();
+				if (_telemetry)
+				{
+					_telemetry->SetWorker(static_cast<size_t>(&worker - workers.data()));
+				}
+				WorkerLoop(classes, toWorker[0], fromWorker[1]);
+			}
+			::close(toWorker[0]);
+			::close(fromWorker[1]);
+			if (pid < 0)
+			{
+				::close(toWorker[1]);
+				::close(fromWorker[0]);
+				return false;
+			}
+			worker.Pid        = pid;
+			worker.ToWorker   = toWorker[1];
+			worker.FromWorker = fromWorker[0];
+			return true;
 		};
 
-		/*Overidde this function to define the test cases*/
-		virtual void Define() = 0;
-
-		/*If expression == false it will make the test fail*/
-		inline bool TestTrue(bool expression)
+		/*Body of a worker process, defines the assigned classes and runs their cases and hooks until the runner closes the pipe, then exits
+		without running any destructor. A class is constructed and defined by the first assignment of the worker that concerns it*/
+		[[noreturn]] inline void WorkerLoop(const std::vector<const DTestClass*>& classes, int input, int output)
 		{
-			if (!expression)
+			std::vector<std::unique_ptr<AutomatedTestInstance>> instances(classes.size());
+			std::vector<char>                                   begun(classes.size());
+			DWorkerAssignment                                   assignment;
+			while (ReadAll(input, &assignment, sizeof(assignment)))
 			{
-				_failed = true;
+				std::unique_ptr<AutomatedTestInstance>& instance = instances[assignment.Class];
+				if (!instance)
+				{
+					instance = DefinedInstance(*classes[assignment.Class]);
+					if (assignment.Case != DWorkerAssignment::Define)
+					{
+						// the class was defined by another worker, which already sent its log
+						instance->_log.Clear();
+					}
+				}
+				if (assignment.Case == DWorkerAssignment::Define)
+				{
+					if (!SendDefinition(classes[assignment.Class]->Name, *instance, output))
+					{
+						break;
+					}
+					continue;
+				}
+				if (assignment.Case == DWorkerAssignment::EndClass)
+				{
+					begun[assignment.Class] = 0;
+					const DWorkerHooks hooks = { instance->EndClass() ? 1 : 0, 0 };
+					std::cout.flush();
+					std::cerr.flush();
+					std::fflush(nullptr);
+					if (!SendLog(hooks, *instance, output))
+					{
+						break;
+					}
+					continue;
+				}
+				if (!begun[assignment.Class])
+				{
+					begun[assignment.Class] = 1;
+					instance->BeginClass();
+				}
+				RunCase(classes[assignment.Class]->Name, *instance, assignment.Case);
+				std::cout.flush();
+				std::cerr.flush();
+				std::fflush(nullptr);
+
+				const DCaseResult caseResult = MakeCaseResult(*instance, assignment.Case);
+				const std::string log        = instance->_log.Str();
+				instance->_log.Clear();
+
+				DWorkerResult result{};
+				result.Class        = assignment.Class;
+				result.Case         = assignment.Case;
+				result.Status       = static_cast<int32_t>(caseResult.Status);
+				result.IsBenchmark  = caseResult.IsBenchmark;
+				result.Duration     = caseResult.Duration.count();
+				result.MessagesSize = caseResult.Messages.size();
+				result.LogSize      = log.size();
+				result.NumSamples   = caseResult.Benchmark.Samples.size();
+				result.Iterations   = caseResult.Benchmark.Iterations;
+				result.Min          = caseResult.Benchmark.Min;
+				result.Median       = caseResult.Benchmark.Median;
+				result.P99          = caseResult.Benchmark.P99;
+				result.Mean         = caseResult.Benchmark.Mean;
+				result.StdDev       = caseResult.Benchmark.StdDev;
+				result.Allocations  = caseResult.Allocations;
+				result.Counters     = caseResult.Benchmark.Counters;
+				if (!WriteAll(output, &result, sizeof(result)) || !WriteAll(output, caseResult.Messages.data(), caseResult.Messages.size()) ||
+					!WriteAll(output, log.data(), log.size()) ||
+					!WriteAll(output, caseResult.Benchmark.Samples.data(), caseResult.Benchmark.Samples.size() * sizeof(double)))
+				{
+					break;
+				}
 			}
-			return expression;
+			::_exit(0);
 		};
 
-		/*If expression == true it will make the test fail*/
-		inline bool TestFalse(bool expression)
+		/*Send the result of AfterAll followed by the log of the class*/
+		inline static bool SendLog(DWorkerHooks hooks, AutomatedTestInstance& instance, int output)
 		{
-			if (expression)
-			{
-				_failed = true;
-			}
-			return !expression;
+			const std::string log = instance._log.Str();
+			instance._log.Clear();
+			hooks.LogSize = log.size();
+			return WriteAll(output, &hooks, sizeof(hooks)) && WriteAll(output, log.data(), log.size());
 		};
 
-		/*Compare two values and return true if they are equal, if not the test will fail*/
-		bool TestEqual(char value, char expected)
+		/*Send the selected cases of a class defined by the worker, the runner selects nothing itself since it has no instance*/
+		inline bool SendDefinition(const std::string& className, AutomatedTestInstance& instance, int output)
 		{
-			if (!(value == expected))
+			const std::vector<size_t> selected = SelectCases(className, instance);
+			const std::string         log      = instance._log.Str();
+			instance._log.Clear();
+			const DWorkerDefinition definition = { instance._defined ? 1 : 0, instance.CanRunCasesInParallel() ? 1 : 0, selected.size(), log.size() };
+			if (!WriteAll(output, &definition, sizeof(definition)) || !WriteAll(output, log.data(), log.size()))
 			{
-				_failed = true;
 				return false;
 			}
+			for (const size_t index : selected)
+			{
+				const std::string name   = instance.GetTestName(index);
+				const DWorkerCase workerCase = { index, static_cast<int64_t>(instance.GetTimeout(index).count()), name.size() };
+				if (!WriteAll(output, &workerCase, sizeof(workerCase)) || !WriteAll(output, name.data(), name.size()))
+				{
+					return false;
+				}
+			}
 			return true;
 		};
 
-		bool TestEqual(unsigned char value, unsigned char expected)
+		/*Send the current case of the job to the worker, a worker that can't receive it is treated as crashed*/
+		inline void DispatchCase(DWorkerProcess& worker, std::vector<DWorkerProcess>& workers, std::vector<DIsolatedJob>& jobs,
+								 std::vector<std::unique_ptr<DClassRun>>& runs, const std::vector<const DTestClass*>& classes)
 		{
-			if (!(value == expected))
+			const DIsolatedJob& job = jobs[worker.Job];
+			const DClassRun&    run = *runs[job.Class];
+			std::chrono::nanoseconds timeout = _options.Timeout;
+			DWorkerAssignment        assigned = { static_cast<uint32_t>(job.Class), job.End ? DWorkerAssignment::EndClass : DWorkerAssignment::Define };
+			if (!job.Define && !job.End)
 			{
-				_failed = true;
-				return false;
+				const size_t position = job.Cases[worker.Position];
+				assigned.Case         = static_cast<uint32_t>(run.Selected[position]);
+				timeout               = run.Timeouts[position] > std::chrono::nanoseconds::zero() ? run.Timeouts[position] : timeout;
+				if (std::find(worker.Begun.begin(), worker.Begun.end(), job.Class) == worker.Begun.end())
+				{
+					// the worker runs BeforeAll before the case, the class is complete once its AfterAll ran too
+					worker.Begun.push_back(job.Class);
+					runs[job.Class]->Remaining++;
+				}
+			}
+			worker.Start    = std::chrono::steady_clock::now();
+			worker.Deadline = timeout > std::chrono::nanoseconds::zero() ? worker.Start + timeout : std::chrono::steady_clock::time_point::max();
+			if (!WriteAll(worker.ToWorker, &assigned, sizeof(assigned)))
+			{
+				FailWorker(worker, workers, jobs, runs, classes, false);
 			}
-			return true;
 		};
 
-		/*Compare two values and return true if they are equal, if not the test will fail*/
-		bool TestEqual(int value, int expected)
+		/*Read the definition of a class and queue its cases, the first job continues on the worker that constructed the class*/
+		inline bool ReceiveDefinition(DWorkerProcess& worker, std::vector<DIsolatedJob>& jobs, std::deque<size_t>& pending, DClassRun& run)
 		{
-			if (!(value == expected))
+			DWorkerDefinition definition;
+			if (!ReadAll(worker.FromWorker, &definition, sizeof(definition)))
+			{
+				return false;
+			}
+			std::string log(definition.LogSize, '\0');
+			if (!ReadAll(worker.FromWorker, &log[0], log.size()))
 			{
-				_failed = true;
 				return false;
 			}
+			for (uint64_t c = 0; c < definition.NumSelected; c++)
+			{
+				DWorkerCase workerCase;
+				if (!ReadAll(worker.FromWorker, &workerCase, sizeof(workerCase)))
+				{
+					return false;
+				}
+				std::string name(workerCase.NameSize, '\0');
+				if (!ReadAll(worker.FromWorker, &name[0], name.size()))
+				{
+					return false;
+				}
+				run.Selected.push_back(static_cast<size_t>(workerCase.Index));
+				run.Timeouts.push_back(std::chrono::nanoseconds(workerCase.Timeout));
+				run.CaseNames.push_back(std::move(name));
+			}
+			run.Result.HooksPassed = definition.Defined != 0;
+			run.Result.Log += log;
+			run.Parallel = definition.Parallel != 0;
+			run.Cases.resize(run.Selected.size());
+			CountScheduledCases(run.Selected.size());
+
+			const size_t classIndex = jobs[worker.Job].Class;
+			const size_t firstJob   = jobs.size();
+			for (size_t c = 0; c < run.Selected.size(); c++)
+			{
+				if (c == 0 || run.Parallel)
+				{
+					jobs.push_back({ classIndex, {}, false });
+				}
+				jobs.back().Cases.push_back(c);
+			}
+			for (size_t j = firstJob + 1; j < jobs.size(); j++)
+			{
+				pending.push_back(j);
+			}
+			worker.Job      = jobs.size() > firstJob ? firstJob : NoJob;
+			worker.Position = 0;
+			run.Remaining   = run.Selected.size();
 			return true;
 		};
 
-		/*Compare two values and return true if they are equal, if not the test will fail*/
-		bool TestEqual(unsigned int value, unsigned int expected)
+		/*Read the result of the current case and move the worker to the next case of its job*/
+		inline bool ReceiveResult(DWorkerProcess& worker, std::vector<DIsolatedJob>& jobs, std::deque<size_t>& pending, std::vector<std::unique_ptr<DClassRun>>& runs,
+								  const std::vector<const DTestClass*>& classes)
 		{
-			if (!(value == expected))
+			if (jobs[worker.Job].Define)
+			{
+				return ReceiveDefinition(worker, jobs, pending, *runs[jobs[worker.Job].Class]);
+			}
+			if (jobs[worker.Job].End)
+			{
+				return ReceiveHooks(worker, *runs[jobs[worker.Job].Class]);
+			}
+			DWorkerResult result;
+			if (!ReadAll(worker.FromWorker, &result, sizeof(result)))
+			{
+				return false;
+			}
+			const DIsolatedJob& job      = jobs[worker.Job];
+			DClassRun&          run      = *runs[job.Class];
+			const size_t        position = job.Cases[worker.Position];
+			DCaseResult&        caseResult = run.Cases[position];
+			std::string         log(result.LogSize, '\0');
+			caseResult.Name     = run.CaseNames[position];
+			caseResult.Status   = static_cast<ETestStatus>(result.Status);
+			caseResult.Duration = std::chrono::nanoseconds(result.Duration);
+			caseResult.Messages.resize(result.MessagesSize);
+			caseResult.IsBenchmark = result.IsBenchmark != 0;
+			caseResult.Benchmark   = { result.Iterations, std::vector<double>(result.NumSamples), result.Min, result.Median, result.P99, result.Mean, result.StdDev, result.Counters };
+			caseResult.Allocations = result.Allocations;
+			if (!ReadAll(worker.FromWorker, &caseResult.Messages[0], caseResult.Messages.size()) || !ReadAll(worker.FromWorker, &log[0], log.size()) ||
+				!ReadAll(worker.FromWorker, caseResult.Benchmark.Samples.data(), caseResult.Benchmark.Samples.size() * sizeof(double)))
 			{
-				_failed = true;
 				return false;
 			}
+			run.Result.Log += log;
+			if (caseResult.IsBenchmark && !caseResult.Benchmark.Samples.empty() && (!_options.BenchmarkBaseline.empty() || !_options.BenchmarkSave.empty()))
+			{
+				_benchmarkMeasures[classes[job.Class]->Name + "." + caseResult.Name] = { caseResult.Benchmark.Median, caseResult.Benchmark.Samples, caseResult.Benchmark.Counters };
+			}
+			run.Remaining--;
+			AdvanceWorker(worker, jobs);
 			return true;
 		};
 
-		/*Compare two values and return true if they are equal, if not the test will fail*/
-		bool TestEqual(float value, float expected)
+		/*Read the result of the AfterAll of a class, the class fails if it failed in any worker*/
+		inline static bool ReceiveHooks(DWorkerProcess& worker, DClassRun& run)
 		{
-			if (!__floatsAlmostSame(value, expected))
+			DWorkerHooks hooks;
+			if (!ReadAll(worker.FromWorker, &hooks, sizeof(hooks)))
+			{
+				return false;
+			}
+			std::string log(hooks.LogSize, '\0');
+			if (!ReadAll(worker.FromWorker, &log[0], log.size()))
 			{
-				_failed = true;
 				return false;
 			}
+			run.Result.HooksPassed = run.Result.HooksPassed && hooks.Passed != 0;
+			run.Result.Log += log;
+			run.Remaining--;
+			worker.Job = NoJob;
 			return true;
 		};
 
-		/*Compare two values and return true if they are equal, if not the test will fail*/
-		bool TestEqual(double value, double expected)
+		/*Give an idle worker its next job: the AfterAll of a class it ran cases of once no job of the class is pending, else the next pending job*/
+		inline static bool NextJob(DWorkerProcess& worker, std::vector<DIsolatedJob>& jobs, std::deque<size_t>& pending)
 		{
-			if (!__doublesAlmostSame(value, expected))
+			for (auto begun = worker.Begun.begin(); begun != worker.Begun.end(); ++begun)
+			{
+				const size_t classIndex = *begun;
+				if (std::none_of(pending.begin(), pending.end(), [&](size_t j) { return jobs[j].Class == classIndex; }))
+				{
+					worker.Begun.erase(begun);
+					jobs.push_back({ classIndex, {}, false, true });
+					worker.Job      = jobs.size() - 1;
+					worker.Position = 0;
+					return true;
+				}
+			}
+			if (pending.empty())
 			{
-				_failed = true;
 				return false;
 			}
+			worker.Job      = pending.front();
+			worker.Position = 0;
+			pending.pop_front();
 			return true;
 		};
 
-		/*Return a vector of test names*/
-		inline std::vector<std::string> GetTestNames() const
+		inline void AdvanceWorker(DWorkerProcess& worker, const std::vector<DIsolatedJob>& jobs)
 		{
-			std::vector<std::string> names;
-			names.reserve(_tests.size());
-			std::transform(_tests.begin(), _tests.end(), std::back_inserter(names), [](const DTestCase& test) { return test.Name; });
-			return names;
+			if (++worker.Position >= jobs[worker.Job].Cases.size())
+			{
+				worker.Job = NoJob;
+			}
 		};
 
-		/*Will run a particular test case by it's name*/
-		inline bool RunTest(const std::string& name)
+		/*The worker crashed or its case timed out: fail the case, replace the worker and continue the job on the new one.
+		A class whose definition took the worker down fails without cases*/
+		inline void FailWorker(DWorkerProcess& worker, std::vector<DWorkerProcess>& workers, std::vector<DIsolatedJob>& jobs,
+							   std::vector<std::unique_ptr<DClassRun>>& runs, const std::vector<const DTestClass*>& classes, bool timedOut)
 		{
-			ResetFlags();
-			auto found = std::find_if(_tests.begin(), _tests.end(), [name](const DTestCase& test) { return test.Name == name; });
-			assert(found != _tests.end());
-			_currentRunningTest = static_cast<signed int>(std::distance(_tests.begin(), found));
-			try
+			const DIsolatedJob& job     = jobs[worker.Job];
+			DClassRun&          run     = *runs[job.Class];
+			const std::string   name    = job.Define ? "Define" : job.End ? "AfterAll" : run.CaseNames[job.Cases[worker.Position]];
+			const auto          elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - worker.Start);
+			const int           status  = StopWorker(worker, timedOut);
+			// the AfterAll owed by the worker can't run anymore, a new worker runs BeforeAll again
+			for (const size_t begun : worker.Begun)
 			{
-				found->DoWork();
-				_testStatus[_currentRunningTest] = _failed ? ETestStatus::FAILED : ETestStatus::PASSED;
+				runs[begun]->Remaining--;
 			}
-			catch (...)
+			worker.Begun.clear();
+
+			std::ostringstream reason;
+			if (timedOut)
 			{
-				_testStatus[_currentRunningTest] = ETestStatus::FAILED;
+				reason << "did not complete within " << std::fixed << std::setprecision(3) << std::chrono::duration<double, std::milli>(elapsed).count() << "ms";
+				std::cerr << "Timeout:" << classes[job.Class]->Name << "." << name << " " << reason.str() << ENDLINE;
+			}
+			else if (WIFSIGNALED(status))
+			{
+				reason << "crashed the worker process with signal " << WTERMSIG(status) << " (" << ::strsignal(WTERMSIG(status)) << ")";
+			}
+			else
+			{
+				reason << "ended the worker process with exit code " << (WIFEXITED(status) ? WEXITSTATUS(status) : status);
+			}
+			if (job.Define || job.End)
+			{
+				FailJob(job, runs, reason.str());
+				worker.Job = NoJob;
+			}
+			else
+			{
+				const size_t position = job.Cases[worker.Position];
+				CompleteIsolatedCase(run, position, reason.str());
+				run.Cases[position].Duration = elapsed;
+				AdvanceWorker(worker, jobs);
+			}
+			if (_telemetry)
+			{
+				_telemetry->ClearWorker(static_cast<size_t>(&worker - workers.data()));
+				_telemetry->AddFailure();
 			}
-			return !_failed;
-		}
 
-		/*Run all tests, return true if they all passed, false otherwise*/
-		inline bool RunAll()
-		{
-			unsigned int passed{};
-			for (int i = 0; i < _tests.size(); i++)
+			if (!SpawnWorker(worker, workers, classes))
 			{
-				ResetFlags();
-				const auto& test = _tests[i];
-				try
-				{
-					passed += static_cast<unsigned int>(RunTest(test.Name));
-				}
-				catch (...)
+				// the rest of the job can't run anywhere
+				for (; worker.Job != NoJob; AdvanceWorker(worker, jobs))
 				{
+					CompleteIsolatedCase(*runs[jobs[worker.Job].Class], jobs[worker.Job].Cases[worker.Position], "could not start a worker process");
+					if (_telemetry)
+					{
+						_telemetry->AddFailure();
+					}
 				}
+				return;
 			}
+			if (worker.Job != NoJob)
+			{
+				DispatchCase(worker, workers, jobs, runs, classes);
+			}
+		};
 
-			return (passed == _tests.size());
-		}
-
-		/*Get the status of a particular test by name*/
-		inline ETestStatus GetResult(const std::string& name) const
+		/*Fail the cases of a job that can't run, a definition that fails leaves the class without cases*/
+		inline static void FailJob(const DIsolatedJob& job, std::vector<std::unique_ptr<DClassRun>>& runs, const std::string& reason)
 		{
-			for (int i = 0; i < _tests.size(); i++)
+			DClassRun& run = *runs[job.Class];
+			if (job.Define || job.End)
 			{
-				const auto& test = _tests[i];
-				if (test.Name == name)
+				run.Result.HooksPassed = false;
+				if (job.Define)
 				{
-					return _testStatus[i];
+					run.Result.Log += "Define " + reason + ENDLINE;
+					run.Remaining = 0;
 				}
+				else
+				{
+					run.Result.Log += "AfterAll " + reason + ENDLINE;
+					run.Remaining--;
+				}
+				return;
 			}
-			assert(0);//Test name does not exists
-			return ETestStatus::NOT_TESTED;
-		}
+			for (const size_t c : job.Cases)
+			{
+				CompleteIsolatedCase(run, c, reason);
+			}
+		};
 
-		/*Get a vector of status for all the tests*/
-		inline std::vector<ETestStatus> GetResults() const { return _testStatus; }
+		inline static void CompleteIsolatedCase(DClassRun& run, size_t position, const std::string& reason)
+		{
+			DCaseResult& caseResult = run.Cases[position];
+			caseResult.Name         = run.CaseNames[position];
+			caseResult.Status       = ETestStatus::FAILED;
+			caseResult.Messages     = "In:" + caseResult.Name + " " + reason + ENDLINE;
+			run.Remaining--;
+		};
 
-		/*Used to define a test case*/
-		inline void TestCase(const std::string& name, std::function<void(void)> testFunc)
+		/*Close the pipes and reap the worker, killing it first if asked. Returns the wait status*/
+		inline static int StopWorker(DWorkerProcess& worker, bool kill)
 		{
-			// check that does not exists with same name
-			assert(std::find_if(_tests.begin(), _tests.end(), [name](const DTestCase& test) { return test.Name == name; }) == _tests.end());
-			assert(_tests.size() < std::numeric_limits<signed int>().max());
-			try
+			if (worker.Pid <= 0)
 			{
-				_tests.push_back(DTestCase(name, std::move(testFunc)));
-				_testStatus.push_back(ETestStatus::NOT_TESTED);
+				return 0;
 			}
-			catch (...)
+			if (kill)
 			{
-				assert(0); // Failed to allocate test case
+				::kill(worker.Pid, SIGKILL);
 			}
+			::close(worker.ToWorker);
+			::close(worker.FromWorker);
+			int status = 0;
+			while (::waitpid(worker.Pid, &status, 0) < 0 && errno == EINTR)
+			{
+			}
+			worker.Pid        = -1;
+			worker.ToWorker   = -1;
+			worker.FromWorker = -1;
+			return status;
 		};
-
-		/*Returns the index of the current running test. Returns -1 if no tests are running*/
-		inline signed int GetCurrentRunningTest() const { return _currentRunningTest; };
-
-		inline std::string        GetLog() const { return _log.str(); };
-		inline void               ResetLog() { _log.clear(); };
-		inline std::stringstream& OutLog() { return _log; };
-
-	private:
-		std::vector<DTestCase>   _tests;
-		std::vector<ETestStatus> _testStatus;
-		bool                     _failed{};
-		std::stringstream        _log;
-		signed int               _currentRunningTest = -1;
-	};
-
-	class AutomationTester
-	{
-	public:
-		AutomationTester() = default;
-
-		// Define it as a singleton
-		inline static AutomationTester& GetInstance()
+#else
+		/*Without fork the classes run in process*/
+		inline unsigned int RunTestClassesIsolated(const std::vector<const DTestClass*>& classes)
 		{
-			static AutomationTester tester;
-			return tester;
+			unsigned int testPassed{};
+			for (const DTestClass* testClass : classes)
+			{
+				const DRecordedClass* cached = CachedClass(testClass->Name);
+				testPassed += static_cast<unsigned int>(cached ? ReplayCachedClass(testClass->Name, *cached) : RunTestClass(*testClass));
+			}
+			return testPassed;
 		};
+#endif
 
-		template<class T>
-		void AddTest(const std::string& testName)
+		inline static DCaseResult MakeCaseResult(const AutomatedTestInstance& testInstance, size_t index)
 		{
-			_tests[testName] = []() -> AutomatedTestInstance* { return new T; };
+			DCaseResult result;
+			result.Name                       = testInstance._tests[index].Name;
+			result.Status                     = testInstance.GetResult(index);
+			result.Duration                   = testInstance.GetDuration(index);
+			result.Messages                   = testInstance.GetFailureMessages(index);
+			result.Allocations                = testInstance.GetAllocations(index);
+			const DBenchmarkResult* benchmark = testInstance.GetBenchmarkResult(index);
+			if (benchmark)
+			{
+				result.IsBenchmark = true;
+				result.Benchmark   = *benchmark;
+			}
+			return result;
 		};
 
-		bool RunAllTests(int argc = 0, char* argv[] = nullptr)
+		inline void CountScheduledCases(size_t count) const
 		{
-			SetupOutstream(argc, argv);
-
-			unsigned int testPassed{};
-			for (const auto& newTest : _tests)
+			if (_telemetry)
 			{
-
-				GetOutstream() << TEXT_WHITE << ENDLINE << "Begin testing:" << newTest.first << ENDLINE;
-				GetOutstream().flush();
-
-				AutomatedTestInstance* testInstance = newTest.second();
-				testInstance->Define();
-				unsigned int subTestNumPassed = 0;
-				for (const auto& n : testInstance->GetTestNames())
-				{
-					GetOutstream() << TEXT_WHITE << "Running:" << n << ENDLINE;
-					GetOutstream().flush();
-					// Run the test
-					const bool result = testInstance->RunTest(n);
-					OutResult(result);
-					GetOutstream() << ENDLINE;
-					GetOutstream().flush();
-					// Increment counter
-					subTestNumPassed += static_cast<unsigned int>(result);
-				}
-				GetOutstream() << TEXT_RED << testInstance->GetLog() << ENDLINE;
-				GetOutstream() << TEXT_GREEN << "Result completed tests [" << subTestNumPassed << "/" << testInstance->GetTestNames().size() << "]" << ENDLINE;
-
-				GetOutstream() << TEXT_WHITE << newTest.first << " Completed with result" << ENDLINE;
-				OutResult((subTestNumPassed == testInstance->GetTestNames().size()));
-				testPassed += (static_cast<unsigned int>(subTestNumPassed == testInstance->GetTestNames().size()));
-
-				GetOutstream() << ENDLINE << ENDLINE;
-				GetOutstream().flush();
-				delete testInstance;
+				_telemetry->AddCases(count);
 			}
+		};
 
-			GetOutstream() << TEXT_WHITE << "Testing ended with result" << ENDLINE;
-			OutResult(testPassed == _tests.size());
-			GetOutstream() << ENDLINE;
-
-			GetOutstream() << TEXT_WHITE;
-			EndOutputStream();
+		/*Run a test case published in the --telemetry block*/
+		inline bool RunCase(const std::string& className, AutomatedTestInstance& testInstance, size_t index)
+		{
+			if (!_telemetry)
+			{
+				return RunMeasuredCase(className, testInstance, index);
+			}
+			_telemetry->BeginCase(className, testInstance._tests[index].Name);
+			const bool result = RunMeasuredCase(className, testInstance, index);
+			_telemetry->EndCase(result);
+			return result;
+		};
 
-			return (testPassed == _tests.size());
+		/*The watchdog of a batch of async cases. The batch cancels a case at its timeout, the watchdog gets it a second later when it blocks the loop*/
+		inline AutomatedTestInstance::DAsyncWatch WatchAsyncCases(const std::string& className, AutomatedTestInstance& testInstance)
+		{
+			if (!_watchdog)
+			{
+				return {};
+			}
+			return { [this, &className, &testInstance](size_t index, std::chrono::nanoseconds timeout) {
+						return _watchdog->Watch({ &className, &testInstance, index, timeout }, std::chrono::seconds(1));
+					},
+					 [this](uint64_t id) { _watchdog->Unwatch(id); } };
 		};
 
-		inline std::ostream& GetOutstream()
+		/*Run a test case, benchmark cases are also compared against the baseline*/
+		inline bool RunMeasuredCase(const std::string& className, AutomatedTestInstance& testInstance, size_t index)
 		{
-			if (_outstream.is_open())
+			if (!testInstance._classReady)
 			{
-				return _outstream;
+				testInstance.FailWithoutRunning(index);
+				return false;
+			}
+			const std::chrono::nanoseconds timeout = testInstance.GetTimeout(index) > std::chrono::nanoseconds::zero() ? testInstance.GetTimeout(index) : _options.Timeout;
+			bool                           result;
+			if (timeout > std::chrono::nanoseconds::zero() && _watchdog)
+			{
+				const uint64_t watched = _watchdog->Watch({ &className, &testInstance, index, timeout });
+				result                 = testInstance.RunTest(index);
+				_watchdog->Unwatch(watched);
+			}
+			else
+			{
+				result = testInstance.RunTest(index);
+			}
+			const DBenchmarkResult* const benchmark = testInstance.GetBenchmarkResult(index);
+			if (!benchmark || benchmark->Samples.empty() || (_options.BenchmarkBaseline.empty() && _options.BenchmarkSave.empty()))
+			{
+				return result;
 			}
 
-			return std::cerr;
-		};
+			const std::string           name = className + "." + testInstance._tests[index].Name;
+			std::lock_guard<std::mutex> lock(_benchmarkMutex);
+			_benchmarkMeasures[name] = { benchmark->Median, benchmark->Samples, benchmark->Counters };
 
-	private:
-		static constexpr unsigned int _resultOffset = 60;
-		std::ofstream                 _outstream;
+			const auto baseline = _benchmarkBaseline.find(name);
+			if (result && baseline != _benchmarkBaseline.end() && IsBenchmarkRegression(*benchmark, baseline->second))
+			{
+				// formatted apart so that the log keeps its own format
+				std::ostringstream message;
+				message << "In:" << testInstance._tests[index].Name << " benchmark regression, median " << std::fixed << std::setprecision(2) << benchmark->Median
+						<< "ns against a baseline of " << baseline->second.Median << "ns" << ENDLINE;
+				testInstance.OutLog() << message.str();
+				testInstance.FailTest(index);
+				result = false;
+			}
+			if (result && baseline != _benchmarkBaseline.end() && IsInstructionRegression(*benchmark, baseline->second))
+			{
+				std::ostringstream message;
+				message << "In:" << testInstance._tests[index].Name << " benchmark regression, " << std::fixed << std::setprecision(2) << benchmark->Counters.Instructions
+						<< " instructions per iteration against a baseline of " << baseline->second.Counters.Instructions << ENDLINE;
+				testInstance.OutLog() << message.str();
+				testInstance.FailTest(index);
+				result = false;
+			}
+			return result;
+		};
 
-		inline void SetupOutstream(int argc, char* argv[])
+		/*Called by the watchdog thread when a case exceeds its timeout. A case can't be interrupted inside the process, so the run stops
+		right away with the name of the case instead of hanging until the CI kills it. The state of the case belongs to the thread running it,
+		the timeout is only given to the reporters as a failed case that ends the class and the run, then the process exits with a failure*/
+		inline void OnCaseTimeout(const Watchdog::DWatchedCase& watched)
 		{
-			if (argc > 1)
+			std::ostringstream message;
+			message << "Timeout:" << *watched.ClassName << "." << watched.Instance->GetTestName(watched.Index) << " did not complete within " << std::fixed
+					<< std::setprecision(3) << std::chrono::duration<double, std::milli>(watched.Timeout).count() << "ms" << ENDLINE;
+			std::cerr << message.str();
+
+			// a reporter stuck on the main thread doesn't stop the exit
+			const bool  locked = _reportMutex.try_lock_for(std::chrono::seconds(1));
+			DCaseResult timedOut;
+			timedOut.Name     = watched.Instance->GetTestName(watched.Index);
+			timedOut.Status   = ETestStatus::FAILED;
+			timedOut.Messages = message.str();
+			timedOut.Duration = watched.Timeout;
+			DClassResult classResult;
+			classResult.Name     = *watched.ClassName;
+			classResult.NumTests = 1;
+			classResult.Duration = watched.Timeout;
+			const bool begun     = _reportedClass == classResult.Name;
+			for (Reporter* reporter : _activeReporters)
 			{
-				_outstream.open(argv[1]);
-				if (_outstream.is_open())
-				{
-					std::cerr << "Writing to file:" << argv[1];
-				}
-				else
+				// the serial run already began the case
+				if (!begun)
 				{
-					std::cerr << "Could not create log with filename:" << argv[1];
+					reporter->OnClassBegin(classResult.Name);
+					reporter->OnCaseBegin(classResult.Name, timedOut.Name);
 				}
+				reporter->OnCaseEnd(classResult.Name, timedOut);
+				reporter->OnClassEnd(classResult);
+				reporter->OnRunEnd(false, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _runStart));
 			}
-		};
-
-		inline void EndOutputStream()
-		{
 			GetOutstream().flush();
-			if (_outstream.is_open())
+			GetDestination().flush();
+			std::cout.flush();
+			std::fflush(nullptr);
+			if (locked)
 			{
-				_outstream.close();
+				_reportMutex.unlock();
 			}
+			std::_Exit(EXIT_FAILURE);
 		};
 
-		inline void OutSuccess() { GetOutstream() << std::setfill('-') << std::setw(_resultOffset) << "[" << TEXT_GREEN << "PASSED" << TEXT_WHITE << "]"; };
-		inline void OutFailure() { GetOutstream() << std::setfill('-') << std::setw(_resultOffset) << "[" << TEXT_RED << "FAILED" << TEXT_WHITE << "]"; };
-
-		inline void OutResult(bool result)
+		/*A regression is a median above the tolerance whose samples are also significantly slower than the baseline ones*/
+		inline bool IsBenchmarkRegression(const DBenchmarkResult& benchmark, const DBenchmarkBaseline& baseline) const
 		{
-			if (result)
-			{
-				GetOutstream() << std::setfill('-') << std::setw(_resultOffset) << "[" << TEXT_GREEN << "PASSED" << TEXT_WHITE << "]";
-			}
-			else
+			if (benchmark.Median <= baseline.Median * (1. + _options.BenchmarkTolerance / 100.))
 			{
-				GetOutstream() << std::setfill('-') << std::setw(_resultOffset) << "[" << TEXT_RED << "FAILED" << TEXT_WHITE << "]";
+				return false;
 			}
+			return baseline.Samples.empty() || __mannWhitneyGreater(benchmark.Samples, baseline.Samples) < _options.BenchmarkSignificance;
+		};
+
+		/*The instructions retired per iteration barely depend on the load of the machine, more than the tolerance is a regression*/
+		inline bool IsInstructionRegression(const DBenchmarkResult& benchmark, const DBenchmarkBaseline& baseline) const
+		{
+			return baseline.Counters.Instructions >= 0. && benchmark.Counters.Instructions >= 0. &&
+				   benchmark.Counters.Instructions > baseline.Counters.Instructions * (1. + _options.BenchmarkTolerance / 100.);
 		};
 
 	private:
-		std::map<std::string, std::function<AutomatedTestInstance* (void)>> _tests;
+		std::map<std::string, DAddedClass>                  _tests;
+		std::vector<DTestClass>                             _classes;
+		std::vector<std::unique_ptr<AutomatedTestInstance>> _definedInstances; // By index in _classes, defined to plan the shards
+		std::vector<SharedFixtureUsers>                     _declaredFixtures; // By index in _classes, given to the instance of the class
+		bool                                                _useStaticRegistry{};
+		DRunOptions                                         _options;
+		std::vector<std::shared_ptr<Reporter>>              _reporters;
+		std::vector<Reporter*>                              _activeReporters;
+		std::timed_mutex                                    _reportMutex;   // Serializes the reporters with the timeout of the watchdog thread
+		std::string                                         _reportedClass; // The class begun in the reporters by the serial run
+		std::chrono::steady_clock::time_point               _runStart;
+		TestFilter                                          _filter;
+		unsigned int                                        _classesRun{};
+		std::map<std::string, DBenchmarkBaseline>           _benchmarkBaseline;
+		std::map<std::string, DBenchmarkBaseline>           _benchmarkMeasures;
+		std::mutex                                          _benchmarkMutex;
+		std::unique_ptr<Watchdog>                           _watchdog;
+		std::unique_ptr<Telemetry>                          _telemetry;
+		std::map<std::string, std::chrono::nanoseconds>     _durations;
+		std::map<std::string, std::chrono::nanoseconds>     _measuredDurations;
+		std::unordered_set<std::string>                     _shardCases;
+		std::map<std::string, std::string>                  _fingerprints;
+		std::map<std::string, DRecordedClass>               _recordedResults;
+		std::unordered_set<std::string>                     _rerunCases;
 	};
 
+	BITTER_API void __addTestClass(const std::string& className, AutomatedTestInstance* (*create)(void), void (*declareFixtures)(SharedFixtureUsers&))
+	{
+		AutomationTester::GetInstance().AddTest(className, create, declareFixtures);
+	}
+#endif
+
 	template<class T>
 	class TestInserter
 	{
 	public:
-		TestInserter(const std::string& className) { AutomationTester::GetInstance().AddTest<T>(className); };
+		/*Registers in the static registry without allocating, the name must outlive the run like a string literal does.
+		The inserter is meant to be a static object, destroying it removes the class from the registry*/
+		TestInserter(const char* className) noexcept : _registration{ className, &__createTestInstance<T>, &T::DeclareSharedFixtures, nullptr } { TestRegistrar registrar(_registration); };
+		TestInserter(const std::string& className) : _registration{ nullptr, nullptr, nullptr, nullptr } { __addTestClass(className, &__createTestInstance<T>, &T::DeclareSharedFixtures); };
+		~TestInserter()
+		{
+			if (_registration.Create)
+			{
+				TestRegistrar::Unlink(_registration);
+			}
+		};
+
+		TestInserter(const TestInserter&) = delete;
+		TestInserter& operator=(const TestInserter&) = delete;
+
+	private:
+		DTestRegistration _registration;
 	};
 
 } // namespace Fox
 
-#define ADD_TEST(testClass) static bitter::TestInserter<testClass> __testInserted##testClass(#testClass);
+#define ADD_TEST(testClass) \
+    static bitter::DTestRegistration __testRegistration##testClass{ #testClass, &bitter::__createTestInstance<testClass>, &testClass::DeclareSharedFixtures, nullptr }; \
+    static const bitter::TestRegistrar __testRegistrar##testClass(__testRegistration##testClass);
 
 #define TEST_DEFINE_CLASS(className) \
     class className final : public bitter::AutomatedTestInstance \
@@ -475,13 +8487,14 @@ namespace bitter
 #define TEST_END_CLASS(className) \
     } \
     ; \
-    static bitter::TestInserter<className> __testInserted##className(#className);
+    static bitter::DTestRegistration __testRegistration##className{ #className, &bitter::__createTestInstance<className>, &className::DeclareSharedFixtures, nullptr }; \
+    static const bitter::TestRegistrar __testRegistrar##className(__testRegistration##className);
 
 #define TEST_TRUE_OR_QUIT(expression) \
     { \
         if (!TestTrue((expression))) \
             { \
-                std::cerr << "In:" << GetTestNames()[GetCurrentRunningTest()] << "[line " << __LINE__ << "]" \
+                OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << __LINE__ << "]" \
                           << " TEST_TRUE_OR_QUIT(" << #expression << ")" \
                           << " was expected to be true but it was false" << ENDLINE; \
                 return; \
@@ -492,7 +8505,7 @@ namespace bitter
     { \
         if (!TestTrue((expression))) \
             { \
-                std::cerr << "In:" << GetTestNames()[GetCurrentRunningTest()] << "[line " << __LINE__ << "]" \
+                OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << __LINE__ << "]" \
                           << " TEST_TRUE(" << #expression << ")" \
                           << " was expected to be true but it was false" << ENDLINE; \
             } \
@@ -500,33 +8513,164 @@ namespace bitter
 
 #define TEST_FALSE(expression) \
     { \
-        if (TestFalse((expression))) \
+        if (!TestFalse((expression))) \
             { \
-                std::cerr << "In:" << GetTestNames()[GetCurrentRunningTest()] << "[line " << __LINE__ << "]" \
+                OutFailureMessage() << "In:" << GetCurrentTestName() << "[line " << __LINE__ << "]" \
                           << " TEST_FALSE(" << #expression << ")" \
-                          << " was expected to be true but it was false" << ENDLINE; \
+                          << " was expected to be false but it was true" << ENDLINE; \
+            } \
+    }
+
+// The operands are evaluated once and formatted with bitter::Formatter only when the comparison fails
+#define BITTER_TEST_COMPARE(check, assertion, expectation, a, b) \
+    { \
+        const auto& bitterValue_    = (a); \
+        const auto& bitterExpected_ = (b); \
+        if (!check(bitterValue_, bitterExpected_)) \
+            { \
+                ReportComparisonFailure(__LINE__, assertion, expectation, bitterValue_, bitterExpected_); \
+            } \
+    }
+
+#define TEST_EQUAL(a, b) BITTER_TEST_COMPARE(TestEqual, "TEST_EQUAL(" #a "," #b ")", "was expected to be equal but they are not", a, b)
+
+#define TEST_NEQUAL(a, b) BITTER_TEST_COMPARE(TestNotEqual, "TEST_NEQUAL(" #a "," #b ")", "was expected to be different but they are the same", a, b)
+
+#define TEST_LT(a, b) BITTER_TEST_COMPARE(TestLess, "TEST_LT(" #a "," #b ")", "was expected to be less", a, b)
+
+#define TEST_LE(a, b) BITTER_TEST_COMPARE(TestLessEqual, "TEST_LE(" #a "," #b ")", "was expected to be less or equal", a, b)
+
+#define TEST_GT(a, b) BITTER_TEST_COMPARE(TestGreater, "TEST_GT(" #a "," #b ")", "was expected to be greater", a, b)
+
+#define TEST_GE(a, b) BITTER_TEST_COMPARE(TestGreaterEqual, "TEST_GE(" #a "," #b ")", "was expected to be greater or equal", a, b)
+
+#define TEST_NEAR(a, b, tolerance) \
+    { \
+        const auto& bitterValue_     = (a); \
+        const auto& bitterExpected_  = (b); \
+        const auto& bitterTolerance_ = (tolerance); \
+        if (!TestNear(bitterValue_, bitterExpected_, bitterTolerance_)) \
+            { \
+                ReportComparisonFailure(__LINE__, "TEST_NEAR(" #a "," #b "," #tolerance ")", "was expected to be within the tolerance", bitterValue_, \
+                                        bitterExpected_); \
             } \
     }
 
-#define TEST_EQUAL(a, b) \
+// Fails when the expression makes more than n allocations on the calling thread, it needs BITTER_TRACK_ALLOCS. Skipped in sanitized builds
+#define TEST_MAX_ALLOCS(n, expression) \
     { \
-		if (!TestEqual((a), (b)))\
-			{\
-					std::cerr << "In:" << GetTestNames()[GetCurrentRunningTest()] << "[line " << __LINE__ << "]" \
-							<< " TEST_EQUAL(" << #a << "," << #b << ")" \
-							<< " was expected to be equal but they are not" << ENDLINE; \
-			} \
+        const bitter::DAllocationStats bitterAllocations_ = bitter::GetThreadAllocations(); \
+        expression; \
+        TestMaxAllocations(bitter::GetThreadAllocations().Allocations - bitterAllocations_.Allocations, (n), __LINE__, "TEST_MAX_ALLOCS(" #n "," #expression ")"); \
     }
 
-#define TEST_NEQUAL(a, b) \
+#define TEST_NO_ALLOCS(expression) TEST_MAX_ALLOCS(0, expression)
+
+// Compares count elements by their bytes, a mismatch reports how many differ, the first one and the largest difference
+#define TEST_BUFFER_EQUAL(a, b, count) \
+    { \
+        const auto                      bitterValue_      = (a); \
+        const auto                      bitterExpected_   = (b); \
+        const size_t                    bitterCount_      = (count); \
+        const bitter::DBufferComparison bitterComparison_ = bitter::CompareBuffers(bitterValue_, bitterExpected_, bitterCount_); \
+        if (!TestBuffers(bitterComparison_)) \
+            { \
+                ReportBufferFailure(__LINE__, "TEST_BUFFER_EQUAL(" #a "," #b "," #count ")", bitterComparison_, bitterCount_, bitterValue_, bitterExpected_); \
+            } \
+    }
+
+// Compares count floats or doubles within an absolute tolerance or bitter::Ulps(n)
+#define TEST_ARRAY_NEAR(a, b, count, tolerance) \
     { \
-		if (TestEqual((a), (b)))\
-			{\
-					std::cerr << "In:" << GetTestNames()[GetCurrentRunningTest()] << "[line " << __LINE__ << "]" \
-							<< " TEST_NEQUAL(" << #a << "," << #b << ")" \
-							<< " was expected to be different but they are the same" << ENDLINE; \
-			} \
+        const auto                      bitterValue_      = (a); \
+        const auto                      bitterExpected_   = (b); \
+        const size_t                    bitterCount_      = (count); \
+        const bitter::DBufferComparison bitterComparison_ = bitter::CompareArraysNear(bitterValue_, bitterExpected_, bitterCount_, (tolerance)); \
+        if (!TestBuffers(bitterComparison_)) \
+            { \
+                ReportBufferFailure(__LINE__, "TEST_ARRAY_NEAR(" #a "," #b "," #count "," #tolerance ")", bitterComparison_, bitterCount_, bitterValue_, \
+                                    bitterExpected_); \
+            } \
     }
 
+// Compares size bytes at data with the golden file name in the --snapshot-dir
+#define TEST_MATCHES_SNAPSHOT(name, data, size) TestSnapshot((name), (data), (size), __LINE__, "TEST_MATCHES_SNAPSHOT(" #name "," #data "," #size ")")
+
 // Returns 0  when all tests succed or 1 when at least one test has failed
-#define RUN_ALL_TESTS(argc, argv) return !bitterAutomationTester::GetInstance().RunAllTests(argc, argv);
\ No newline at end of file
+#define RUN_ALL_TESTS(argc, argv) return !bitter::AutomationTester::GetInstance().RunAllTests(argc, argv);
+
+// Define BITTER_TRACK_ALLOCS before including bitter.h in exactly one translation unit, usually the one with main, to replace the global
+// operator new and delete. Every block carries a header with its size so the frees are counted in bytes.
+// The sanitizers replace them too, in their builds the allocations aren't tracked
+
+#if defined(BITTER_TRACK_ALLOCS) && !defined(BITTER_SANITIZED)
+namespace bitter
+{
+	struct DAllocationHeader
+	{
+		void*  Block;
+		size_t Size;
+	};
+
+	inline void* __trackedAllocate(size_t size, size_t alignment)
+	{
+		alignment = std::max(alignment, alignof(std::max_align_t));
+		if (size > std::numeric_limits<size_t>::max() - alignment - sizeof(DAllocationHeader))
+		{
+			// the padded size would wrap around to a small block
+			throw std::bad_alloc();
+		}
+		void* block;
+		while ((block = std::malloc(size + alignment + sizeof(DAllocationHeader))) == nullptr)
+		{
+			const std::new_handler handler = std::get_new_handler();
+			if (!handler)
+			{
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+		const uintptr_t    address = (reinterpret_cast<uintptr_t>(block) + sizeof(DAllocationHeader) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		DAllocationHeader* header  = reinterpret_cast<DAllocationHeader*>(address) - 1;
+		header->Block              = block;
+		header->Size               = size;
+
+		DAllocationStats& stats = __threadAllocations();
+		stats.Allocations++;
+		stats.Bytes += size;
+		stats.Live += static_cast<int64_t>(size);
+		stats.Peak = std::max(stats.Peak, stats.Live);
+		return reinterpret_cast<void*>(address);
+	}
+
+	inline void __trackedFree(void* pointer) noexcept
+	{
+		if (!pointer)
+		{
+			return;
+		}
+		const DAllocationHeader* header = static_cast<const DAllocationHeader*>(pointer) - 1;
+		DAllocationStats&        stats  = __threadAllocations();
+		stats.Frees++;
+		stats.Live -= static_cast<int64_t>(header->Size);
+		std::free(header->Block);
+	}
+
+	static const bool __allocationTrackingInstalled = (__allocationTracking() = true);
+} // namespace bitter
+
+void* operator new(std::size_t size) { return bitter::__trackedAllocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return bitter::__trackedAllocate(size, alignof(std::max_align_t)); }
+void  operator delete(void* pointer) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete[](void* pointer) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete(void* pointer, std::size_t) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete[](void* pointer, std::size_t) noexcept { bitter::__trackedFree(pointer); }
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment) { return bitter::__trackedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return bitter::__trackedAllocate(size, static_cast<size_t>(alignment)); }
+void  operator delete(void* pointer, std::align_val_t) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete[](void* pointer, std::align_val_t) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { bitter::__trackedFree(pointer); }
+void  operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { bitter::__trackedFree(pointer); }
+#endif
+#endif
@@ -0,0 +1,88 @@
+#!/bin/sh
+# Measures the build time of a generated suite of N test files, header only and with BITTER_SPLIT.
+# Every file defines a class with a few cases, main.cpp runs them. Both executables are run to check they register every class.
+#
+#   test/compile_benchmark.sh [N] [compiler flags]
+#   CXX=clang++ test/compile_benchmark.sh 100 -O2
+
+set -e
+
+COUNT=${1:-50}
+if [ $# -gt 0 ]; then
+	shift
+fi
+FLAGS=${*:-"-std=c++17 -O0"}
+CXX=${CXX:-c++}
+HEADER=$(cd "$(dirname "$0")/.." && pwd)/bitter.h
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+i=0
+while [ $i -lt "$COUNT" ]; do
+	cat > "$WORK/case$i.test.cpp" << EOF
+#include "$HEADER"
+
+TEST_DEFINE_CLASS(Generated$i)
+	std::vector<int> Values;
+TEST_END_CLASS(Generated$i)
+
+void Generated$i::Define()
+{
+	Values = { $i, $i + 1, $i + 2 };
+	TestCase("Equal", [this]() { TEST_EQUAL(Values[0] + 1, Values[1]); });
+	TestCase("Compare", [this]() { TEST_LT(Values[0], Values[2]); TEST_NEAR(0.1 * $i, 0.1 * $i, 1e-9); });
+	TestCase("Strings", [this]() { TEST_NEQUAL(std::to_string(Values[0]), std::string("x")); });
+}
+EOF
+	i=$((i + 1))
+done
+
+cat > "$WORK/main.cpp" << EOF
+#define BITTER_IMPLEMENTATION
+#include "$HEADER"
+
+int main(int argc, char* argv[])
+{
+	RUN_ALL_TESTS(argc, argv);
+};
+EOF
+
+now() {
+	date +%s%N
+}
+
+# build_suite <name> <extra flags>, prints the seconds spent compiling the test files and main.cpp
+build_suite() {
+	mkdir -p "$WORK/$1"
+	start=$(now)
+	i=0
+	while [ $i -lt "$COUNT" ]; do
+		# shellcheck disable=SC2086
+		$CXX $FLAGS $2 -c "$WORK/case$i.test.cpp" -o "$WORK/$1/case$i.o"
+		i=$((i + 1))
+	done
+	middle=$(now)
+	# shellcheck disable=SC2086
+	$CXX $FLAGS $2 -c "$WORK/main.cpp" -o "$WORK/$1/main.o"
+	end=$(now)
+	# shellcheck disable=SC2086
+	$CXX $FLAGS "$WORK/$1"/*.o -o "$WORK/$1/suite" -pthread
+	"$WORK/$1/suite" --slowest=0 > "$WORK/$1/output.txt" 2>&1 || {
+		echo "The $1 suite failed" >&2
+		exit 1
+	}
+	passed=$(grep -c "Running:" "$WORK/$1/output.txt" || true)
+	if [ "$passed" -ne $((COUNT * 3)) ]; then
+		echo "The $1 suite ran $passed cases instead of $((COUNT * 3))" >&2
+		exit 1
+	fi
+	awk -v files="$((middle - start))" -v main="$((end - middle))" -v count="$COUNT" -v name="$1" \
+		'BEGIN { printf "%-12s %8.2fs for %d test files, %6.3fs per file, %6.2fs for main.cpp\n", name, files / 1e9, count, files / 1e9 / count, main / 1e9 }'
+	echo "$((middle - start))" > "$WORK/$1/time"
+}
+
+echo "$CXX $FLAGS, $COUNT test files"
+build_suite header-only ""
+build_suite split "-DBITTER_SPLIT"
+awk -v full="$(cat "$WORK/header-only/time")" -v lean="$(cat "$WORK/split/time")" \
+	'BEGIN { printf "BITTER_SPLIT compiles the test files %.1fx faster\n", full / lean }'
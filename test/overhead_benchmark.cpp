@@ -0,0 +1,332 @@
+// Copyright 2022-2023 WildFox Studio - Kirichenko Stanislav
+// No warranty implied. Use it at your own risk
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Measures the cost of the framework itself on synthetic suites: the static registration of the classes, Define(), the dispatch of an empty case,
+// a passing and a failing assertion and the peak memory of the run. The report of the runs goes to std::cerr, counted and discarded.
+// On POSIX systems every suite runs in its own process so that its peak memory is its own.
+//
+//  g++ -std=c++17 -O2 -pthread test/overhead_benchmark.cpp -o overhead_benchmark && ./overhead_benchmark [scale]
+//
+// The scale multiplies the size of the suites, 0.1 runs a tenth of them.
+
+#include "../bitter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#if defined(BITTER_HAS_FORK)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+enum class ESyntheticKind
+{
+	EMPTY,
+	ASSERTIONS,
+	FAILURES
+};
+
+struct DSuite
+{
+	const char*              Name;
+	size_t                   Classes;
+	size_t                   Cases; // Per class
+	ESyntheticKind           Kind;
+	size_t                   Assertions; // Per case
+	std::vector<std::string> Arguments;
+};
+
+/*Shape of the classes constructed by the running suite*/
+struct DSyntheticShape
+{
+	ESyntheticKind           Kind{};
+	size_t                   Assertions{};
+	std::vector<std::string> CaseNames;
+};
+
+static DSyntheticShape Shape;
+
+/*The value read back through a volatile, the compiler can't relate it to the loop condition and fold the assertion away*/
+static size_t Opaque(size_t value)
+{
+	volatile size_t copy = value;
+	return copy;
+}
+
+class Synthetic final : public bitter::AutomatedTestInstance {
+public:
+	virtual void Define() override {
+		SetRunCasesInParallel(true);
+		const size_t assertions = Shape.Assertions;
+		for (size_t i = 0; i < Shape.CaseNames.size(); i++)
+		{
+			switch (Shape.Kind)
+			{
+				case ESyntheticKind::EMPTY:
+					TestCase(Shape.CaseNames[i], []() {});
+					break;
+				case ESyntheticKind::ASSERTIONS:
+					// the loop alone then the three macros in turn, the loops are the same apart from the assertion
+					if (i % 4 == 0)
+					{
+						TestCase(Shape.CaseNames[i], [assertions]() {
+							for (size_t k = 0; k < assertions; k++)
+							{
+								bitter::DoNotOptimize(Opaque(k));
+							}
+						});
+					}
+					else if (i % 4 == 1)
+					{
+						TestCase(Shape.CaseNames[i], [this, assertions]() {
+							for (size_t k = 0; k < assertions; k++)
+							{
+								TEST_TRUE(Opaque(k) < assertions);
+							}
+						});
+					}
+					else if (i % 4 == 2)
+					{
+						TestCase(Shape.CaseNames[i], [this, assertions]() {
+							for (size_t k = 0; k < assertions; k++)
+							{
+								TEST_EQUAL(Opaque(k), k);
+							}
+						});
+					}
+					else
+					{
+						TestCase(Shape.CaseNames[i], [this, assertions]() {
+							for (size_t k = 0; k < assertions; k++)
+							{
+								TEST_NEAR(static_cast<double>(Opaque(k)), static_cast<double>(k) + 1e-9, 1e-6);
+							}
+						});
+					}
+					break;
+				case ESyntheticKind::FAILURES:
+					TestCase(Shape.CaseNames[i], [this, assertions]() {
+						for (size_t k = 0; k < assertions; k++)
+						{
+							TEST_EQUAL(k, k + 1);
+						}
+					});
+					break;
+			}
+		}
+	}
+};
+
+/*Collects the durations spent inside the cases to tell them apart from the dispatch*/
+class DurationRecorder final : public bitter::Reporter {
+public:
+	std::chrono::nanoseconds InCases{};
+	std::chrono::nanoseconds ByCase[4]{};
+	size_t                   Cases{};
+	size_t                   Failed{};
+
+	void OnCaseEnd(const std::string&, const bitter::DCaseResult& result) override
+	{
+		InCases += result.Duration;
+		ByCase[Cases % 4] += result.Duration;
+		Failed += result.Status == bitter::ETestStatus::FAILED;
+		Cases++;
+	}
+};
+
+/*Discards what is written to std::cerr counting the bytes*/
+class CountingBuffer final : public std::streambuf {
+public:
+	size_t Bytes{};
+
+protected:
+	int_type overflow(int_type c) override
+	{
+		Bytes += traits_type::eq_int_type(c, traits_type::eof()) ? 0 : 1;
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char*, std::streamsize count) override
+	{
+		Bytes += static_cast<size_t>(count);
+		return count;
+	}
+};
+
+static double Nanoseconds(std::chrono::steady_clock::duration duration)
+{
+	return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+static double PeakMegabytes()
+{
+#if defined(BITTER_HAS_FORK)
+	struct rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return static_cast<double>(usage.ru_maxrss) / (1024. * 1024.);
+#else
+	return static_cast<double>(usage.ru_maxrss) / 1024.;
+#endif
+#else
+	return 0.;
+#endif
+}
+
+static void RunSuite(const DSuite& suite)
+{
+	const size_t totalCases = suite.Classes * suite.Cases;
+	Shape.Kind              = suite.Kind;
+	Shape.Assertions        = suite.Assertions;
+	Shape.CaseNames.clear();
+	for (size_t i = 0; i < suite.Cases; i++)
+	{
+		Shape.CaseNames.push_back("Case " + std::to_string(i));
+	}
+	std::vector<std::string> classNames;
+	for (size_t c = 0; c < suite.Classes; c++)
+	{
+		classNames.push_back("Class" + std::to_string(c));
+	}
+
+	// the classes are linked in the static registry like TEST_END_CLASS does, the names outlive the run.
+	// Only the singleton runs the registry, in a single process the recorders of the previous suites keep counting unread
+	std::vector<bitter::DTestRegistration> registrations(suite.Classes);
+	const auto                             registrationStart = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < suite.Classes; c++)
+	{
+		registrations[c] = { classNames[c].c_str(), &bitter::__createTestInstance<Synthetic>, nullptr, nullptr };
+		const bitter::TestRegistrar registrar(registrations[c]);
+	}
+	const double registration = Nanoseconds(std::chrono::steady_clock::now() - registrationStart);
+
+	auto                      recorder = std::make_shared<DurationRecorder>();
+	bitter::AutomationTester& tester   = bitter::AutomationTester::GetInstance();
+	tester.AddReporter(recorder);
+
+	// Define() alone, the run defines the classes again
+	const auto defineStart = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < suite.Classes; c++)
+	{
+		Synthetic instance;
+		instance.Define();
+	}
+	const double define = Nanoseconds(std::chrono::steady_clock::now() - defineStart);
+
+	std::vector<std::string> arguments{ "overhead_benchmark" };
+	arguments.insert(arguments.end(), suite.Arguments.begin(), suite.Arguments.end());
+	std::vector<char*> argv;
+	for (std::string& argument : arguments)
+	{
+		argv.push_back(&argument[0]);
+	}
+
+	CountingBuffer  discarded;
+	std::streambuf* previous = std::cerr.rdbuf(&discarded);
+	const auto      runStart = std::chrono::steady_clock::now();
+	tester.RunAllTests(static_cast<int>(argv.size()), argv.data());
+	const double run = Nanoseconds(std::chrono::steady_clock::now() - runStart);
+	std::cerr.rdbuf(previous);
+	// the last registration is the head of the list, each unlink is a single step
+	for (size_t c = suite.Classes; c-- > 0;)
+	{
+		bitter::TestRegistrar::Unlink(registrations[c]);
+	}
+
+	const size_t expectedFailures = suite.Kind == ESyntheticKind::FAILURES ? totalCases : 0;
+	if (recorder->Cases != totalCases || recorder->Failed != expectedFailures)
+	{
+		std::cerr << suite.Name << " ran " << recorder->Cases << " cases with " << recorder->Failed << " failures instead of " << totalCases << " with "
+				  << expectedFailures << std::endl;
+		std::exit(1);
+	}
+
+	std::printf("%s\n", suite.Name);
+	std::printf("  %zu classes, %zu cases, run in %.1fms, %zu bytes reported\n", suite.Classes, totalCases, run / 1e6, discarded.Bytes);
+	std::printf("  registration %.1fns per class, Define() %.1fns per case\n", registration / static_cast<double>(suite.Classes), define / static_cast<double>(totalCases));
+	if (suite.Arguments.empty())
+	{
+		std::printf("  dispatch %.1fns per case\n", (run - define - Nanoseconds(recorder->InCases)) / static_cast<double>(totalCases));
+	}
+	else
+	{
+		// the cases overlap, only the wall time compares with the serial run
+		std::printf("  %.1fns of wall time per case\n", run / static_cast<double>(totalCases));
+	}
+	if (suite.Kind == ESyntheticKind::ASSERTIONS)
+	{
+		// the cost of the loop alone is subtracted, a passing assertion is a predicted branch that can be lost in the noise
+		const char*  names[] = { "TEST_TRUE", "TEST_EQUAL", "TEST_NEAR" };
+		const double perName = static_cast<double>(totalCases / 4 * suite.Assertions);
+		const double loop    = Nanoseconds(recorder->ByCase[0]) / perName;
+		for (size_t k = 0; k < 3; k++)
+		{
+			std::printf("  %-10s %.2fns per passing assertion\n", names[k], std::max(0., Nanoseconds(recorder->ByCase[k + 1]) / perName - loop));
+		}
+	}
+	if (suite.Kind == ESyntheticKind::FAILURES)
+	{
+		const double failures = static_cast<double>(totalCases * suite.Assertions);
+		std::printf("  %.1fns per failing assertion in the case, %.1fns per failure reporting it\n", Nanoseconds(recorder->InCases) / failures,
+					(run - define - Nanoseconds(recorder->InCases)) / failures);
+	}
+	std::printf("  peak memory %.1fMB\n", PeakMegabytes());
+	std::fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+	const double scale = argc > 1 ? std::atof(argv[1]) : 1.;
+	const auto   scaled = [scale](size_t count) { return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(count) * scale)); };
+
+	const std::vector<DSuite> suites = {
+		{ "1k classes x 100 cases", scaled(1000), 100, ESyntheticKind::EMPTY, 0, {} },
+		{ "1k classes x 100 cases, --jobs=0", scaled(1000), 100, ESyntheticKind::EMPTY, 0, { "--jobs=0" } },
+		{ "1 class x 100k cases", 1, scaled(100000), ESyntheticKind::EMPTY, 0, {} },
+		{ "1 class x 100k cases, --jobs=0 --parallel-cases", 1, scaled(100000), ESyntheticKind::EMPTY, 0, { "--jobs=0", "--parallel-cases" } },
+		{ "Assertion loops, 4 cases x 10M assertions", 1, 4, ESyntheticKind::ASSERTIONS, scaled(10000000), {} },
+		{ "Failing assertions, 1k cases x 100 failures", 1, scaled(1000), ESyntheticKind::FAILURES, 100, {} },
+	};
+
+	for (const DSuite& suite : suites)
+	{
+#if defined(BITTER_HAS_FORK)
+		const pid_t pid = fork();
+		if (pid == 0)
+		{
+			RunSuite(suite);
+			std::exit(0);
+		}
+		int status = 0;
+		if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			std::cerr << "The suite " << suite.Name << " failed" << std::endl;
+			return 1;
+		}
+#else
+		RunSuite(suite);
+#endif
+	}
+	return 0;
+};
@@ -14,13 +14,52 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+// The allocations of the self tests are counted
+#define BITTER_TRACK_ALLOCS
 #include "../bitter.h"
 
 #include <cassert>
+#include <cstdint>
 #include <limits>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
+static unsigned int staticRegistrationRuns{};
+
+TEST_DEFINE_CLASS(StaticallyRegistered)
+TEST_END_CLASS(StaticallyRegistered)
+
+void StaticallyRegistered::Define()
+{
+	TestCase("Should run from the singleton", []() {
+		staticRegistrationRuns++;
+		});
+}
+
+class InsertedWithoutMacros final : public bitter::AutomatedTestInstance {
+public:
+	virtual void Define() override {
+		TestCase("Should run from the singleton", []() {
+			staticRegistrationRuns++;
+			});
+	}
+};
+
+static bitter::TestInserter<InsertedWithoutMacros> RegisterInsertedWithoutMacros("InsertedWithoutMacros");
 
 void MultipleTestsShouldExecute()
 {
@@ -179,6 +218,2120 @@ void InstanceShouldRunTestByNames()
 	assert(inst.RunTest("C") == true);
 };
 
+void InstanceShouldRunTestByIndex()
+{
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			for (int i = 0; i < 1000; i++)
+			{
+				TestCase(std::to_string(i), [this, i]() {TEST_TRUE(i % 2 == 0); });
+			}
+		}
+	};
+	Instance inst;
+	inst.Define();
+
+	assert(inst.GetNumTests() == 1000);
+	assert(inst.FindTest("999") == 999);
+	assert(inst.FindTest("1000") == bitter::AutomatedTestInstance::NotFound);
+	assert(inst.GetResult(size_t(10)) == bitter::ETestStatus::NOT_TESTED);
+
+	assert(inst.RunTest(size_t(10)) == true);
+	assert(inst.RunTest(size_t(11)) == false);
+	assert(inst.GetResult(size_t(10)) == bitter::ETestStatus::PASSED);
+	assert(inst.GetResult("11") == bitter::ETestStatus::FAILED);
+	assert(inst.RunAll() == false);
+	assert(inst.GetResult("998") == bitter::ETestStatus::PASSED);
+	assert(inst.GetResult("999") == bitter::ETestStatus::FAILED);
+};
+
+void InstanceShouldMeasureDurations()
+{
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Fast", []() {});
+			TestCase("Slow", []() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+		}
+	};
+	Instance inst;
+	inst.Define();
+
+	assert(inst.GetDurations().size() == 2);
+	assert(inst.GetDuration(1) == std::chrono::nanoseconds::zero());
+	assert(inst.RunAll() == true);
+	assert(inst.GetDuration(1) >= std::chrono::milliseconds(5));
+	assert(inst.GetDurations()[0] < inst.GetDurations()[1]);
+};
+
+void InstanceShouldKeepFailureMessagesPerTest()
+{
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("A", [this]() {TEST_TRUE(true); });
+			TestCase("B", [this]() {TEST_TRUE(1 == 2); });
+		}
+	};
+	Instance inst;
+	inst.Define();
+
+	assert(inst.RunAll() == false);
+	assert(inst.GetFailureMessages(0).empty());
+	assert(inst.GetFailureMessages(1).find("TEST_TRUE(1 == 2)") != std::string::npos);
+};
+
+void InstanceShouldStoreManyTestCases()
+{
+	struct Small { int* Counter; void operator()() const { (*Counter)++; } };
+	struct Big { int* Counter; char Padding[128]; void operator()() const { (*Counter)++; } };
+	static_assert(bitter::InlineFunction::IsStoredInline<Small>(), "small callables should be stored inline");
+	static_assert(!bitter::InlineFunction::IsStoredInline<Big>(), "big callables should be stored on the heap");
+
+	static int counter = 0;
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			ReserveTests(1002);
+			for (int i = 0; i < 1000; i++)
+			{
+				TestCase("Case " + std::to_string(i), [this, i]() { TEST_TRUE(i >= 0); counter++; });
+			}
+			std::unique_ptr<int> moveOnly(new int(5));
+			TestCase("MoveOnly", [this, value = std::move(moveOnly)]() { TEST_TRUE(*value == 5); counter++; });
+			Big big{ &counter, {} };
+			TestCase("Big", big);
+		}
+	};
+	Instance inst;
+	inst.Define();
+
+	assert(inst.GetNumTests() == 1002);
+	assert(inst.FindTest("Case 0") == 0);
+	assert(inst.FindTest("Case 999") == 999);
+	assert(inst.FindTest("MoveOnly") == 1000);
+	assert(inst.FindTest("Case 1000") == bitter::AutomatedTestInstance::NotFound);
+	assert(std::string(inst.GetTestName(1001)) == "Big");
+	assert(inst.RunAll() == true);
+	assert(counter == 1002);
+};
+
+void ComparisonMacrosShouldReportOperands()
+{
+	struct Opaque { int Value; bool operator==(const Opaque& other) const { return Value == other.Value; } };
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Passing", [this]() {
+				const size_t size = 3;
+				const int64_t big = int64_t(1) << 40;
+				TEST_EQUAL(size, 3);
+				TEST_EQUAL(big, int64_t(1) << 40);
+				TEST_NEQUAL(1, 2);
+				TEST_LT(-1, 1u);
+				TEST_LE(2u, 2);
+				TEST_GT(big, size);
+				TEST_GE(0.5f, 0.5);
+				TEST_NEAR(1.0, 1.05, 0.1);
+				TEST_NEAR(-1, 2u, 5);
+				TEST_NEAR(2u, int64_t(-1), 3);
+				TEST_NEAR(1, 1.25f, 0.5);
+				TEST_EQUAL(std::string("abc"), "abc");
+				TEST_FALSE(false);
+				TEST_EQUAL(Opaque{ 1 }, Opaque{ 1 });
+			});
+			TestCase("Equal", [this]() { TEST_EQUAL(3, 4); });
+			TestCase("NotEqual", [this]() { TEST_NEQUAL(7u, 7); });
+			TestCase("Signedness", [this]() { TEST_EQUAL(-1, static_cast<unsigned int>(-1)); });
+			TestCase("Less", [this]() { TEST_LT(2, 1); });
+			TestCase("Near", [this]() { TEST_NEAR(1.0, 1.5, 0.1); });
+			TestCase("NearSignedness", [this]() { TEST_NEAR(-1, 2u, 2); });
+			TestCase("False", [this]() { TEST_FALSE(true); });
+			TestCase("Opaque", [this]() { TEST_EQUAL(Opaque{ 1 }, Opaque{ 2 }); });
+		}
+	};
+	Instance inst;
+	inst.Define();
+	inst.RunAll();
+
+	assert(inst.GetResult("Passing") == bitter::ETestStatus::PASSED);
+	assert(inst.GetFailureMessages(inst.FindTest("Passing")).empty());
+	for (const char* failing : { "Equal", "NotEqual", "Signedness", "Less", "Near", "NearSignedness", "False", "Opaque" })
+	{
+		assert(inst.GetResult(failing) == bitter::ETestStatus::FAILED);
+	}
+	assert(inst.GetFailureMessages(inst.FindTest("Equal")).find("In:Equal[line") == 0);
+	assert(inst.GetFailureMessages(inst.FindTest("Equal")).find("3 vs 4") != std::string::npos);
+	assert(inst.GetFailureMessages(inst.FindTest("NotEqual")).find("7 vs 7") != std::string::npos);
+	assert(inst.GetFailureMessages(inst.FindTest("Near")).find("TEST_NEAR(1.0,1.5,0.1)") != std::string::npos);
+	assert(inst.GetFailureMessages(inst.FindTest("False")).find("expected to be false") != std::string::npos);
+	assert(inst.GetFailureMessages(inst.FindTest("Opaque")).find("bytes object") != std::string::npos);
+};
+
+void AllocationsShouldBeCountedPerCase()
+{
+	static int* kept = nullptr;
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Without allocations", [this]() {
+				int value = 0;
+				TEST_NO_ALLOCS(value += 1);
+				TEST_EQUAL(value, 1);
+				});
+			TestCase("Vector", [this]() {
+				std::vector<int> values(100);
+				TEST_MAX_ALLOCS(1, values.push_back(1));
+				});
+			TestCase("Over budget", [this]() {
+				// called directly, a new expression whose pointer doesn't escape can be elided by the optimizer
+				TEST_MAX_ALLOCS(1, {
+					void* a = ::operator new(sizeof(int));
+					void* b = ::operator new(sizeof(int));
+					bitter::DoNotOptimize(a);
+					bitter::DoNotOptimize(b);
+					::operator delete(a);
+					::operator delete(b);
+					});
+				});
+			TestCase("Leaking", []() { kept = new int[4]; });
+		}
+	};
+	Instance inst;
+	inst.Define();
+	if (!bitter::IsTrackingAllocations())
+	{
+		// sanitized builds keep their own operator new, the budgets aren't checked
+		assert(inst.RunTest(2) == true);
+		return;
+	}
+	assert(inst.RunAll() == false);
+	assert(inst.GetResult(0) == bitter::ETestStatus::PASSED && inst.GetAllocations(0).Allocations == 0);
+	assert(inst.GetResult(1) == bitter::ETestStatus::PASSED);
+	assert(inst.GetAllocations(1).Allocations == 2 && inst.GetAllocations(1).Frees == 2);
+	assert(inst.GetAllocations(1).Bytes >= 400 && inst.GetAllocations(1).Peak >= 400 && inst.GetAllocations(1).Live == 0);
+	assert(inst.GetResult(2) == bitter::ETestStatus::FAILED);
+	assert(inst.GetFailureMessages(2).find("made 2 allocations, at most 1") != std::string::npos);
+	// without leak detection the case passes but the bytes it kept are reported
+	assert(inst.GetResult(3) == bitter::ETestStatus::PASSED && inst.GetAllocations(3).Live == 4 * sizeof(int));
+	delete[] kept;
+
+	inst.SetDetectLeaks(true);
+	assert(inst.RunTest(3) == false);
+	assert(inst.GetFailureMessages(3).find("leaked 16 bytes, 1 allocations") != std::string::npos);
+	assert(inst.RunTest(1) == true);
+	delete[] kept;
+
+	// a size that wraps around once padded is refused instead of returning a small block
+	bool                  refused = false;
+	const volatile size_t size    = std::numeric_limits<size_t>::max() - 8; // not a constant the compiler warns about
+	try
+	{
+		bitter::DoNotOptimize(::operator new(size));
+	}
+	catch (const std::bad_alloc&)
+	{
+		refused = true;
+	}
+	assert(refused);
+};
+
+void BufferAssertionsShouldReportTheFirstMismatch()
+{
+	// the vector kernels agree with the scalar loop on values around the tolerance, infinities, NaN and signed zeros
+	std::vector<float>  a(1003), b(1003);
+	std::vector<double> da(1003), db(1003);
+	uint32_t            state = 12345;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		state = state * 1664525u + 1013904223u;
+		a[i]  = static_cast<float>(state % 1000) / 7.f - 70.f;
+		b[i]  = a[i] + static_cast<float>(state % 5) * 0.0005f * (state & 8 ? 1.f : -1.f);
+		da[i] = a[i];
+		db[i] = b[i];
+	}
+	a[10] = b[10] = std::numeric_limits<float>::infinity();
+	a[11] = std::numeric_limits<float>::quiet_NaN();
+	a[12] = 0.f;
+	b[12] = -0.f;
+	b[13] = std::nextafter(a[13], 1e9f);
+	for (const double tolerance : { 0., 0.0005, 0.001, 0.0025 })
+	{
+		bitter::DBufferComparison scalar;
+		bitter::__compareNearScalar(a.data(), b.data(), 0, a.size(), static_cast<float>(tolerance), scalar);
+		const bitter::DBufferComparison vector = bitter::CompareArraysNear(a.data(), b.data(), a.size(), tolerance);
+		assert(vector.NumMismatches == scalar.NumMismatches && vector.FirstMismatch == scalar.FirstMismatch && vector.MaxError == scalar.MaxError);
+
+		bitter::DBufferComparison doubleScalar;
+		bitter::__compareNearScalar(da.data(), db.data(), 0, da.size(), tolerance, doubleScalar);
+		const bitter::DBufferComparison doubleVector = bitter::CompareArraysNear(da.data(), db.data(), da.size(), tolerance);
+		assert(doubleVector.NumMismatches == doubleScalar.NumMismatches && doubleVector.FirstMismatch == doubleScalar.FirstMismatch);
+	}
+	for (const uint32_t ulps : { 0u, 1u, 100u, 5000u })
+	{
+		bitter::DBufferComparison scalar;
+		bitter::__compareNearScalar(a.data(), b.data(), 0, a.size(), bitter::Ulps(ulps), scalar);
+		const bitter::DBufferComparison vector = bitter::CompareArraysNear(a.data(), b.data(), a.size(), bitter::Ulps(ulps));
+		assert(vector.NumMismatches == scalar.NumMismatches && vector.FirstMismatch == scalar.FirstMismatch && vector.MaxError == scalar.MaxError);
+		assert(vector.ErrorInUlps);
+	}
+	const bitter::DBufferComparison oneUlp = bitter::CompareArraysNear(a.data() + 12, b.data() + 12, 2, bitter::Ulps(1));
+	assert(oneUlp.Matches() && oneUlp.MaxError == 1.);
+
+	static std::vector<float> image(1 << 16, 0.5f);
+	static std::vector<float> rendered;
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Same", [this]() {
+				TEST_BUFFER_EQUAL(image.data(), image.data(), image.size());
+				TEST_ARRAY_NEAR(image.data(), rendered.data(), 100, 0.01);
+				});
+			TestCase("Different", [this]() {
+				TEST_BUFFER_EQUAL(rendered.data(), image.data(), image.size());
+				});
+			TestCase("Far", [this]() {
+				TEST_ARRAY_NEAR(rendered.data(), image.data(), image.size(), bitter::Ulps(4));
+				});
+			TestCase("Bytes", [this]() {
+				const char text[] = "abcdef";
+				const char other[] = "abXdeY";
+				TEST_BUFFER_EQUAL(static_cast<const void*>(text), static_cast<const void*>(other), sizeof(text));
+				});
+		}
+	};
+	rendered           = image;
+	rendered[200]      = 0.75f;
+	rendered[60000]    = 0.25f;
+	Instance inst;
+	inst.Define();
+	assert(inst.RunAll() == false);
+	assert(inst.GetResult(0) == bitter::ETestStatus::PASSED);
+	const std::string& different = inst.GetFailureMessages(1);
+	assert(different.find("2 of 65536 elements differ, the first at index 200 0.75 vs 0.5, max error 0.25") != std::string::npos);
+	assert(std::count(different.begin(), different.end(), '\n') == 1);
+	assert(inst.GetFailureMessages(2).find("2 of 65536 elements differ, the first at index 200") != std::string::npos);
+	assert(inst.GetFailureMessages(2).find("ulps") != std::string::npos);
+	assert(inst.GetFailureMessages(3).find("2 of 7 elements differ, the first at index 2 99 vs 88, max error 13") != std::string::npos);
+};
+
+void SnapshotsShouldMatchTheGoldenFiles()
+{
+	static std::vector<uint8_t> output;
+	static std::string          messages;
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		void OnCaseEnd(const std::string&, const bitter::DCaseResult& result) override { messages = result.Messages; }
+	};
+
+	class Snapshots final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Output", [this]() {
+				TEST_MATCHES_SNAPSHOT("selftest.snapshot", output.data(), output.size());
+			});
+		}
+	};
+
+	const auto readFile = [](const std::string& filename) {
+		std::ifstream file(filename, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	};
+
+	std::remove("selftest.snapshot");
+	std::remove("selftest.snapshot.actual");
+	char  program[]   = "selftest";
+	char  directory[] = "--snapshot-dir=.";
+	char  update[]    = "--update-snapshots";
+	char* argv[]      = { program, directory, update };
+
+	// a missing golden file fails and the output is written next to it
+	output = { 1, 2, 3, 4 };
+	{
+		bitter::AutomationTester tester;
+		tester.AddReporter(std::make_shared<Recorder>());
+		tester.AddTest<Snapshots>("Snapshots");
+		assert(tester.RunAllTests(2, argv) == false);
+	}
+	assert(messages.find("no snapshot ./selftest.snapshot, --update-snapshots creates it") != std::string::npos);
+	assert(readFile("selftest.snapshot.actual") == output);
+
+	// the update writes it and removes the stale output
+	{
+		bitter::AutomationTester tester;
+		tester.AddReporter(std::make_shared<Recorder>());
+		tester.AddTest<Snapshots>("Snapshots");
+		assert(tester.RunAllTests(3, argv) == true);
+	}
+	assert(readFile("selftest.snapshot") == output);
+	assert(!std::ifstream("selftest.snapshot.actual").is_open());
+
+	{
+		bitter::AutomationTester tester;
+		tester.AddReporter(std::make_shared<Recorder>());
+		tester.AddTest<Snapshots>("Snapshots");
+		assert(tester.RunAllTests(2, argv) == true);
+
+		output = { 1, 2, 9, 4, 5 };
+		assert(tester.RunAllTests(2, argv) == false);
+	}
+	assert(messages.find("differs from ./selftest.snapshot, 5 bytes against 4, 1 of 4 bytes differ, the first at offset 2 0x9 vs 0x3") !=
+		   std::string::npos);
+	assert(readFile("selftest.snapshot.actual") == output);
+	assert(readFile("selftest.snapshot").size() == 4);
+
+	// an empty output matches an empty golden file
+	output.clear();
+	{
+		bitter::AutomationTester tester;
+		tester.AddReporter(std::make_shared<Recorder>());
+		tester.AddTest<Snapshots>("Snapshots");
+		assert(tester.RunAllTests(3, argv) == true);
+		assert(tester.RunAllTests(2, argv) == true);
+	}
+	assert(readFile("selftest.snapshot").empty());
+	std::remove("selftest.snapshot");
+	std::remove("selftest.snapshot.actual");
+};
+
+void ParameterizedCasesShouldRunEveryParameter()
+{
+	static std::atomic<unsigned int> counter{};
+	static std::atomic<unsigned int> sum{};
+
+	bitter::RangeGenerator<int> range = bitter::Range(0, 10, 3);
+	assert(range.Size() == 4 && range.At(3) == 9);
+	// the distance between the bounds doesn't fit in the signed type
+	const auto wide = bitter::Range(std::numeric_limits<int>::min(), std::numeric_limits<int>::max(), 1 << 30);
+	assert(wide.Size() == 4 && wide.At(0) == std::numeric_limits<int>::min() && wide.At(3) == 1 << 30);
+	assert(bitter::Range<int8_t>(-100, 100, 50).Size() == 4 && bitter::Range<int8_t>(-100, 100, 50).At(3) == 50);
+	assert(bitter::Range<uint64_t>(0, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max() / 2).Size() == 3);
+	// the floating point ranges take every step starting before end
+	const bitter::RangeGenerator<double> fractions = bitter::Range(0., 1., 0.3);
+	assert(fractions.Size() == 4 && std::abs(fractions.At(3) - 0.9) < 1e-12);
+	assert(bitter::Range(0.f, 1.f, 0.25f).Size() == 4 && bitter::Range(0.5, 0.5, 0.1).Size() == 0);
+	const auto product = bitter::Combine(bitter::Values({ 'a', 'b' }), bitter::Range(1, 4));
+	assert(product.Size() == 6 && product.At(0) == std::make_tuple('a', 1) && product.At(4) == std::make_tuple('b', 2));
+	std::ostringstream formatted;
+	bitter::Formatter<std::tuple<char, int>>::Format(formatted, product.At(5));
+	assert(formatted.str() == "(b, 3)");
+
+	{
+		std::ofstream csv("selftest.csv", std::ios::binary);
+		csv << "name,value\n\"quoted, name\",1\n\nplain,\"say \"\"hi\"\"\"\r\nlast,3";
+		std::ofstream binary("selftest.bin", std::ios::binary);
+		for (uint32_t i = 0; i < 10000; i++)
+		{
+			binary.write(reinterpret_cast<const char*>(&i), sizeof(i));
+		}
+	}
+	std::vector<bitter::DCsvRow> rows;
+	const bitter::CsvRows        csv("selftest.csv", true);
+	assert(csv.Error.empty() && csv.Size() == 3);
+	csv.Visit(0, 3, [&](size_t, const bitter::DCsvRow& row) { rows.push_back(row); });
+	assert(rows[0].Fields == std::vector<std::string>({ "quoted, name", "1" }) && rows[0].Line == 2);
+	assert(rows[1].Fields == std::vector<std::string>({ "plain", "say \"hi\"" }) && rows[1].Line == 4);
+	assert(rows[2].Fields[0] == "last" && rows[2].Line == 5);
+	assert(!bitter::CsvRows("selftest.missing").Error.empty());
+	assert(!bitter::BinaryRecords<uint64_t>("selftest.csv").Error.empty());
+
+	class Parameters final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			TestCaseP("Records", bitter::BinaryRecords<uint32_t>("selftest.bin"), [this](uint32_t record) {
+				counter++;
+				sum += record;
+				TEST_TRUE(record != 4321);
+				});
+			TestCaseP("Pairs", bitter::Combine(bitter::Values({ 'a', 'b' }), bitter::Range(1, 4)), [this](const std::tuple<char, int>& pair) {
+				counter++;
+				TEST_TRUE(std::get<1>(pair) != 2 || std::get<0>(pair) != 'b');
+				}, 2);
+			TestCaseP("Rows", bitter::CsvRows("selftest.csv", true), [this](const bitter::DCsvRow& row) {
+				counter++;
+				if (row.Line == 5)
+				{
+					throw std::runtime_error("bad row");
+				}
+				});
+			TestCaseP("Missing", bitter::CsvRows("selftest.missing"), [this](const bitter::DCsvRow&) { counter++; });
+		}
+	};
+
+	Parameters inst;
+	inst.Define();
+	assert(inst.GetNumTests() == 40 + 3 + 1 + 1);
+	assert(std::string(inst.GetTestName(16)) == "Records/4096-4351");
+	assert(std::string(inst.GetTestName(42)) == "Pairs/4-5");
+	counter = 0;
+	sum     = 0;
+	assert(inst.RunAll() == false);
+	assert(counter == 10000 + 6 + 3 && sum == 10000u * 9999u / 2u);
+	assert(inst.GetResult(15) == bitter::ETestStatus::PASSED);
+	assert(inst.GetFailureMessages(16).find("In:Records/4321") != std::string::npos);
+	assert(inst.GetFailureMessages(16).find("  with Records/4321 = 4321") != std::string::npos);
+	assert(inst.GetFailureMessages(42).find("  with Pairs/4 = (b, 2)") != std::string::npos);
+	assert(inst.GetFailureMessages(43).find("In:Rows/2 threw bad row") != std::string::npos);
+	assert(inst.GetFailureMessages(43).find("  with Rows/2 = ") != std::string::npos);
+	assert(inst.GetFailureMessages(44).find("Could not read selftest.missing") != std::string::npos);
+
+	// the cases fan out across the jobs, and a filter can select single parameters inside a chunk
+	char  program[]  = "selftest";
+	char  jobs[]     = "--jobs=4";
+	char  parallel[] = "--parallel-cases";
+	char  filter[]   = "--filter=Parameters.Records/12?:Parameters.Pairs/0";
+	char* argv[]     = { program, jobs, parallel, filter };
+
+	for (int argc = 3; argc <= 4; argc++)
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Parameters>("Parameters");
+		counter = 0;
+		sum     = 0;
+		assert(tester.RunAllTests(argc, argv) == (argc == 4));
+		assert(counter == (argc == 4 ? 10 + 1 : 10009));
+	}
+
+	// a negative filter excludes single parameters of the chunks it doesn't exclude as a whole
+	char  excluding[]     = "--filter=-Parameters.Records/4321:Parameters.Pairs/4:Parameters.Rows/*:Parameters.Missing";
+	char* excludingArgv[] = { program, jobs, parallel, excluding };
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Parameters>("Parameters");
+		counter = 0;
+		sum     = 0;
+		assert(tester.RunAllTests(4, excludingArgv) == true);
+		assert(counter == 9999 + 5 && sum == 10000u * 9999u / 2u - 4321u);
+	}
+	std::remove("selftest.csv");
+	std::remove("selftest.bin");
+};
+
+void PropertyCasesShouldShrinkTheCounterexample()
+{
+	bitter::Random          random(1);
+	const auto              digits = bitter::Integers(-5, 5);
+	std::unordered_set<int> drawn;
+	for (int i = 0; i < 1000; i++)
+	{
+		const int value = digits.Generate(random);
+		assert(value >= -5 && value <= 5);
+		drawn.insert(value);
+	}
+	assert(drawn.size() == 11);
+	std::vector<int> smaller;
+	bitter::Integers(0, 100).Shrink(10, smaller);
+	assert(smaller == std::vector<int>({ 0, 5, 8, 9 }));
+	{
+		// the same threads serve every search
+		bitter::FirstIndexSearch search(4);
+		for (size_t first = 0; first < 64; first += 7)
+		{
+			assert(search.Find(64, [first](size_t i) { return i >= first; }) == first);
+		}
+		assert(search.Find(64, [](size_t) { return false; }) == 64 && search.Find(0, [](size_t) { return true; }) == 0);
+	}
+	assert(bitter::Random::Stream(3, 4) == bitter::Random::Stream(3, 4) && bitter::Random::Stream(3, 4) != bitter::Random::Stream(3, 5));
+
+	static std::atomic<unsigned int> calls{};
+
+	class Properties final : public bitter::AutomatedTestInstance {
+	public:
+		explicit Properties(unsigned int threads = 4) : Threads(threads) {}
+		virtual void Define() override {
+			SetPropertySeed(42);
+			SetPropertyTrials(1000);
+			SetPropertyThreads(Threads);
+			PropertyCase("Commutative", bitter::Integers(-1000, 1000), bitter::Integers(-1000, 1000), [](int a, int b) {
+				calls++;
+				// read back so the sums are computed from the generated values instead of being folded
+				const volatile int first = a, second = b;
+				return first + second == second + first;
+			});
+			PropertyCase("Small", bitter::Integers(0, 100000), [](int value) { return value < 1000; });
+			PropertyCase("Halves", bitter::VectorsOf(bitter::Integers(0, 100)), bitter::Booleans(), [](const std::vector<int>& values, bool) {
+				return std::all_of(values.begin(), values.end(), [](int value) { return value < 50; });
+			});
+			PropertyCase("Throws", bitter::Strings(), bitter::Floats(-10., 10.), [](const std::string& text, double) {
+				if (text.find('q') != std::string::npos)
+				{
+					throw std::runtime_error("no q");
+				}
+				return true;
+			});
+		}
+		unsigned int Threads;
+	};
+
+	Properties inst;
+	inst.Define();
+	calls = 0;
+	assert(inst.RunAll() == false);
+	assert(calls == 1000);
+	assert(inst.GetResult(0) == bitter::ETestStatus::PASSED);
+	const std::string& small = inst.GetFailureMessages(1);
+	assert(small.find("In:Small property falsified by trial ") != std::string::npos);
+	assert(small.find("reproduce with --seed=42") != std::string::npos);
+	assert(small.find("counterexample: (1000)") != std::string::npos);
+	assert(inst.GetFailureMessages(2).find("counterexample: ({50}, 0)") != std::string::npos);
+	assert(inst.GetFailureMessages(3).find("counterexample: (q, 0)") != std::string::npos);
+	assert(inst.GetFailureMessages(3).find("  threw no q") != std::string::npos);
+
+	// the first falsified trial and its shrinking don't depend on the number of threads
+	Properties serial(1);
+	serial.Define();
+	assert(serial.RunAll() == false);
+	for (size_t i = 1; i < 4; i++)
+	{
+		assert(serial.GetFailureMessages(i) == inst.GetFailureMessages(i));
+	}
+
+	char  program[] = "selftest";
+	char  seed[]    = "--seed=7";
+	char  trials[]  = "--trials=10";
+	char  filter[]  = "--filter=Properties.Commutative";
+	char* argv[]    = { program, seed, trials, filter };
+
+	bitter::AutomationTester tester;
+	tester.AddTest<Properties>("Properties");
+	calls = 0;
+	assert(tester.RunAllTests(4, argv) == true);
+	assert(calls == 10);
+};
+
+void AsyncStreamBufferShouldWriteEverything()
+{
+	// Destination that can be inspected while the writer thread is running
+	class Destination final : public std::streambuf {
+	public:
+		std::atomic<size_t> Size{};
+		std::string         Content;
+
+	protected:
+		std::streamsize xsputn(const char* data, std::streamsize count) override
+		{
+			Content.append(data, static_cast<size_t>(count));
+			Size = Content.size();
+			return count;
+		}
+	};
+
+	Destination destination;
+	{
+		bitter::AsyncStreamBuffer buffer(&destination, 64, std::chrono::milliseconds(1));
+		std::ostream              out(&buffer);
+		for (int i = 0; i < 1000; i++)
+		{
+			out << i << ENDLINE;
+		}
+		out.flush();
+		assert(destination.Size == 3890);
+
+		// The pending output is written after the flush interval
+		out << "tail";
+		while (destination.Size != 3894)
+		{
+			std::this_thread::yield();
+		}
+		out << "end";
+	}
+	assert(destination.Content.substr(3890) == "tailend");
+
+#if defined(BITTER_HAS_FORK)
+	// A crash writes the pending output before the process dies
+	class PipeDestination final : public std::streambuf {
+	public:
+		int Fd{ -1 };
+
+	protected:
+		std::streamsize xsputn(const char* data, std::streamsize count) override { return ::write(Fd, data, static_cast<size_t>(count)); }
+	};
+
+	// the handler writes to the descriptor without locking, with a writer thread or with blocks written by the filling thread
+	for (const bool background : { true, false })
+	{
+		int pipeFds[2] = { -1, -1 };
+		assert(::pipe(pipeFds) == 0);
+		const pid_t pid = ::fork();
+		if (pid == 0)
+		{
+			::close(pipeFds[0]);
+			PipeDestination crashing;
+			crashing.Fd = pipeFds[1];
+			bitter::AsyncStreamBuffer buffer(&crashing, background ? 1 << 20 : 8, std::chrono::hours(1), background, pipeFds[1]);
+			std::ostream              out(&buffer);
+			out << "Running:Crashing case";
+			std::raise(SIGSEGV);
+			::_exit(0);
+		}
+		::close(pipeFds[1]);
+		std::string written;
+		char        chunk[256];
+		for (ssize_t count; (count = ::read(pipeFds[0], chunk, sizeof(chunk))) > 0;)
+		{
+			written.append(chunk, static_cast<size_t>(count));
+		}
+		::close(pipeFds[0]);
+		int status = 0;
+		assert(::waitpid(pid, &status, 0) == pid);
+		assert(!WIFEXITED(status) || WEXITSTATUS(status) != 0);
+		assert(written == "Running:Crashing case");
+	}
+#endif
+};
+
+void ParallelJobsShouldRunEveryClass()
+{
+	static std::atomic<unsigned int> counter{};
+
+	class TestA final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Should increase counter", [this]() {
+				counter++;
+				TEST_TRUE(true);
+				});
+			TestCase("Should increase counter again", []() {
+				counter++;
+				});
+		}
+	};
+
+	class TestFailing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Should fail", [this]() {
+				counter++;
+				TEST_TRUE(false);
+				});
+		}
+	};
+
+	char  program[] = "selftest";
+	char  jobs[]    = "--jobs=4";
+	char* argv[]    = { program, jobs };
+
+	bitter::AutomationTester passingTester;
+	for (int i = 0; i < 16; i++)
+	{
+		passingTester.AddTest<TestA>("A" + std::to_string(i));
+	}
+
+	counter = 0;
+	assert(passingTester.RunAllTests(2, argv) == true);
+	assert(counter == 32);
+
+	bitter::AutomationTester failingTester;
+	failingTester.AddTest<TestA>("A");
+	failingTester.AddTest<TestFailing>("B");
+	failingTester.AddTest<TestA>("C");
+
+	counter = 0;
+	assert(failingTester.RunAllTests(2, argv) == false);
+	assert(counter == 5);
+
+	// a throwing Define fails its class on the workers like on the calling thread
+	class TestThrowing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Defined before the throw", []() { counter++; });
+			throw std::runtime_error("broken definition");
+		}
+	};
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::map<std::string, bitter::DClassResult> Classes;
+		std::map<std::string, bitter::DCaseResult>  Cases;
+
+		void OnCaseEnd(const std::string& className, const bitter::DCaseResult& result) override { Cases[className + "." + result.Name] = result; }
+		void OnClassEnd(const bitter::DClassResult& result) override { Classes[result.Name] = result; }
+	};
+
+	for (int argc = 1; argc <= 2; argc++)
+	{
+		auto                     recorder = std::make_shared<Recorder>();
+		bitter::AutomationTester throwingTester;
+		throwingTester.AddReporter(recorder);
+		throwingTester.AddTest<TestA>("A");
+		throwingTester.AddTest<TestThrowing>("Throwing");
+		counter = 0;
+		assert(throwingTester.RunAllTests(argc, argv) == false);
+		assert(counter == 2);
+		const bitter::DClassResult& throwing = recorder->Classes["Throwing"];
+		assert(!throwing.HooksPassed && throwing.Log.find("Define threw broken definition") != std::string::npos);
+		const bitter::DCaseResult& notRun = recorder->Cases["Throwing.Defined before the throw"];
+		assert(notRun.Status == bitter::ETestStatus::FAILED && notRun.Messages.find("Define of the class failed") != std::string::npos);
+		assert(recorder->Classes["A"].Passed());
+	}
+};
+
+void AttachedThreadsShouldReportToTheirCase()
+{
+	class Stress final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			for (int c = 0; c < 2; c++)
+			{
+				TestCase("Threads " + std::to_string(c), [this, c]() {
+					std::atomic<unsigned int> pushed{};
+					std::vector<std::thread>  threads;
+					for (int t = 0; t < 32; t++)
+					{
+						threads.push_back(StartTestThread([this, &pushed, c, t]() {
+							for (int i = 0; i < 1000; i++)
+							{
+								pushed++;
+								TEST_TRUE(c == 0 || t != 7 || i != 500);
+							}
+							TEST_EQUAL(c == 1 && t == 20 ? -1 : t, t);
+						}));
+					}
+					for (std::thread& thread : threads)
+					{
+						thread.join();
+					}
+					TEST_EQUAL(pushed.load(), 32000u);
+				});
+			}
+			TestCase("Context", [this]() {
+				const TestContext context = GetTestContext();
+				std::thread       thread([this, &context]() {
+					AttachedThread attached(context);
+					TEST_TRUE(false);
+				});
+				thread.join();
+			});
+		}
+	};
+
+	// the two cases run concurrently, their threads report to their own case
+	Stress inst;
+	inst.Define();
+	std::thread first([&inst]() { inst.RunTest(0); });
+	inst.RunTest(1);
+	first.join();
+	assert(inst.GetResult(0) == bitter::ETestStatus::PASSED && inst.GetFailureMessages(0).empty());
+	assert(inst.GetResult(1) == bitter::ETestStatus::FAILED);
+	const std::string& messages = inst.GetFailureMessages(1);
+	assert(std::count(messages.begin(), messages.end(), '\n') == 2);
+	assert(messages.find("In:Threads 1[line ") != std::string::npos && messages.find("TEST_TRUE(c == 0 || t != 7 || i != 500)") != std::string::npos);
+	assert(messages.find("TEST_EQUAL(c == 1 && t == 20 ? -1 : t,t)") != std::string::npos);
+	assert(inst.RunTest(2) == false);
+	assert(inst.GetFailureMessages(2).find("In:Context[line ") != std::string::npos);
+
+	// a thread that isn't attached has no current case, its failure fails the class and none of the cases
+	class Unattached final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Passing", []() {});
+			TestCase("Spawning", [this]() {
+				std::thread thread([this]() { TEST_TRUE(false); });
+				thread.join();
+			});
+		}
+	};
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		bitter::DClassResult Class;
+		size_t               Passed{};
+
+		void OnCaseEnd(const std::string&, const bitter::DCaseResult& result) override { Passed += result.Status == bitter::ETestStatus::PASSED; }
+		void OnClassEnd(const bitter::DClassResult& result) override { Class = result; }
+	};
+
+	auto                     recorder = std::make_shared<Recorder>();
+	bitter::AutomationTester tester;
+	tester.AddReporter(recorder);
+	tester.AddTest<Unattached>("Unattached");
+	char  name[] = "selftest";
+	char* argv[] = { name };
+	assert(tester.RunAllTests(1, argv) == false);
+	assert(recorder->Passed == 2 && !recorder->Class.Passed());
+	assert(recorder->Class.Log.find("In:<no current case>[line ") != std::string::npos);
+};
+
+#if defined(BITTER_HAS_COROUTINES)
+bitter::Task<int> AnswerLater()
+{
+	co_await bitter::SleepFor(std::chrono::milliseconds(1));
+	co_return 42;
+}
+
+void AsyncCasesShouldRunConcurrently()
+{
+	static int                      pipeFds[2] = { -1, -1 };
+	static std::vector<std::string> events;
+
+	class Async final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			for (int i = 0; i < 20; i++)
+			{
+				AsyncTestCase("Wait " + std::to_string(i), [this, i]() -> bitter::Task<> {
+					events.push_back("Start " + std::to_string(i));
+					co_await bitter::SleepFor(std::chrono::milliseconds(100 - i));
+					TEST_TRUE(i != 7);
+					const int answer = co_await AnswerLater();
+					TEST_EQUAL(answer, 42);
+					events.push_back("End " + std::to_string(i));
+				});
+			}
+			AsyncTestCase("Hangs", [this]() -> bitter::Task<> {
+				co_await bitter::SleepFor(std::chrono::seconds(10));
+				TEST_TRUE(false);
+			}, bitter::Timeout{ std::chrono::milliseconds(50) });
+			AsyncTestCase("Throws", [this]() -> bitter::Task<> {
+				co_await bitter::Yield();
+				throw std::runtime_error("lost connection");
+			});
+			TestCase("Sync", [this]() { TEST_TRUE(true); });
+			AsyncTestCase("Allocates", [this]() -> bitter::Task<> {
+				std::vector<int> values(100);
+				co_await bitter::Yield();
+				bitter::DoNotOptimize(values.data());
+			});
+#if defined(BITTER_HAS_FORK)
+			AsyncTestCase("Reader", [this]() -> bitter::Task<> {
+				co_await bitter::WaitReadable(pipeFds[0]);
+				char byte = 0;
+				TEST_EQUAL(read(pipeFds[0], &byte, 1), 1);
+				TEST_EQUAL(byte, 'x');
+			});
+			AsyncTestCase("Writer", [this]() -> bitter::Task<> {
+				co_await bitter::SleepFor(std::chrono::milliseconds(20));
+				co_await bitter::WaitWritable(pipeFds[1]);
+				TEST_EQUAL(write(pipeFds[1], "x", 1), 1);
+			});
+#endif
+		}
+
+		virtual void SetUp() override { events.push_back("SetUp"); }
+		virtual void TearDown() override { events.push_back("TearDown"); }
+	};
+
+	const auto position = [](const std::string& event) { return std::find(events.begin(), events.end(), event) - events.begin(); };
+
+#if defined(BITTER_HAS_FORK)
+	assert(pipe(pipeFds) == 0);
+#endif
+	Async inst;
+	inst.Define();
+	// kept alive across the cases, a buffer growing in a case would be one of its leaks
+	events.reserve(128);
+	inst.SetDetectLeaks(true);
+	assert(inst.RunAll() == false);
+	for (size_t i = 0; i < 20; i++)
+	{
+		assert(inst.GetResult(i) == (i == 7 ? bitter::ETestStatus::FAILED : bitter::ETestStatus::PASSED));
+		assert(inst.GetDuration(i) >= std::chrono::milliseconds(80));
+		// every case starts right after its SetUp and is followed by its TearDown
+		const std::string name = std::to_string(i);
+		assert(events[static_cast<size_t>(position("Start " + name)) - 1] == "SetUp");
+		assert(i == 7 || events[static_cast<size_t>(position("End " + name)) + 1] == "TearDown");
+	}
+	// all of them started before the first one ended
+	const auto firstEnd = std::find_if(events.begin(), events.end(), [](const std::string& event) { return event.rfind("End ", 0) == 0; }) - events.begin();
+	assert(position("Start 19") < firstEnd);
+	assert(inst.GetFailureMessages(7).find("In:Wait 7[line ") != std::string::npos);
+	assert(inst.GetFailureMessages(20).find("In:Hangs timed out after ") != std::string::npos);
+	assert(inst.GetFailureMessages(20).find("TEST_TRUE") == std::string::npos);
+	assert(inst.GetFailureMessages(21).find("In:Throws threw lost connection") != std::string::npos);
+	assert(inst.GetResult(22) == bitter::ETestStatus::PASSED);
+	// the allocations of a case are counted between the resumes of the others, the loop's own don't count as leaks
+	assert(inst.GetResult(23) == bitter::ETestStatus::PASSED);
+	assert(!bitter::IsTrackingAllocations() || (inst.GetAllocations(23).Allocations >= 1 && inst.GetAllocations(23).Live == 0));
+#if defined(BITTER_HAS_FORK)
+	assert(inst.GetResult(24) == bitter::ETestStatus::PASSED && inst.GetResult(25) == bitter::ETestStatus::PASSED);
+	close(pipeFds[0]);
+	close(pipeFds[1]);
+#endif
+
+	// a single case runs on its own loop through RunTest
+	assert(inst.RunTest(3) == true);
+	assert(inst.RunTest(7) == false);
+
+	// without SetRunCasesInParallel the async cases run one at a time
+	class Serial final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			for (int i = 0; i < 2; i++)
+			{
+				AsyncTestCase("Wait " + std::to_string(i), [this, i]() -> bitter::Task<> {
+					events.push_back("Start " + std::to_string(i));
+					co_await bitter::SleepFor(std::chrono::milliseconds(10));
+					events.push_back("End " + std::to_string(i));
+				});
+			}
+		}
+	};
+	events.clear();
+	Serial serial;
+	serial.Define();
+	assert(serial.RunAll() == true);
+	assert((events == std::vector<std::string>{ "Start 0", "End 0", "Start 1", "End 1" }));
+
+	static std::atomic<int> inFlight{};
+	static std::atomic<int> mostInFlight{};
+	class Passing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			for (int i = 0; i < 10; i++)
+			{
+				AsyncTestCase("Wait " + std::to_string(i), [this]() -> bitter::Task<> {
+					const int now = ++inFlight;
+					for (int most = mostInFlight; most < now && !mostInFlight.compare_exchange_weak(most, now);)
+					{
+					}
+					co_await bitter::SleepFor(std::chrono::milliseconds(100));
+					inFlight--;
+					TEST_EQUAL(co_await AnswerLater(), 42);
+				});
+			}
+		}
+	};
+	char  program[] = "selftest";
+	char  jobs[]    = "--jobs=2";
+	char* argv[]    = { program, jobs };
+	for (int argc = 1; argc <= 2; argc++)
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Passing>("A");
+		tester.AddTest<Passing>("B");
+		mostInFlight = 0;
+		assert(tester.RunAllTests(argc, argv) == true);
+		// the ten cases of a class overlap
+		assert(mostInFlight >= 10);
+	}
+
+#if defined(BITTER_HAS_FORK)
+	// a case blocking the loop past its timeout can't be cancelled, the watchdog ends the run
+	class Blocking final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			AsyncTestCase("Waits", [this]() -> bitter::Task<> { co_await bitter::SleepFor(std::chrono::milliseconds(1)); });
+			AsyncTestCase("Blocks", [this]() -> bitter::Task<> {
+				co_await bitter::Yield();
+				std::this_thread::sleep_for(std::chrono::seconds(10));
+			}, bitter::Timeout{ std::chrono::milliseconds(50) });
+		}
+	};
+
+	std::fflush(nullptr);
+	const pid_t pid = ::fork();
+	if (pid == 0)
+	{
+		std::string junit       = "--junit=selftest_blocking.xml";
+		char*       junitArgv[] = { program, &junit[0] };
+		bitter::AutomationTester tester;
+		tester.AddTest<Blocking>("Blocking");
+		tester.RunAllTests(2, junitArgv);
+		::_exit(0);
+	}
+	int status = 0;
+	assert(::waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE);
+	std::ifstream     junitFile("selftest_blocking.xml");
+	const std::string xml((std::istreambuf_iterator<char>(junitFile)), std::istreambuf_iterator<char>());
+	assert(xml.find("<failure message=\"Timeout:Blocking.Blocks did not complete within 50.000ms\"") != std::string::npos);
+	std::remove("selftest_blocking.xml");
+#endif
+};
+#endif
+
+void ParallelCasesShouldReportEachCase()
+{
+	static std::atomic<unsigned int> counter{};
+
+	class ParallelTest final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			for (int i = 0; i < 64; i++)
+			{
+				TestCase("Case " + std::to_string(i), [this, i]() {
+					counter++;
+					TEST_TRUE(i != 13);
+					});
+			}
+		}
+	};
+
+	class SerialTest final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			for (int i = 0; i < 8; i++)
+			{
+				TestCase("Case " + std::to_string(i), [this]() {
+					counter++;
+					TEST_TRUE(true);
+					});
+			}
+		}
+	};
+
+	char  program[]  = "selftest";
+	char  jobs[]     = "--jobs=4";
+	char  parallel[] = "--parallel-cases";
+	char* argv[]     = { program, jobs, parallel };
+
+	bitter::AutomationTester tester;
+	tester.AddTest<ParallelTest>("Parallel");
+	tester.AddTest<SerialTest>("Serial");
+
+	counter = 0;
+	assert(tester.RunAllTests(3, argv) == false);
+	assert(counter == 72);
+
+	bitter::AutomationTester passingTester;
+	passingTester.AddTest<SerialTest>("Serial");
+
+	counter = 0;
+	assert(passingTester.RunAllTests(3, argv) == true);
+	assert(counter == 8);
+};
+
+void SchedulerShouldRunNestedTasks()
+{
+	std::atomic<unsigned int> counter{};
+	{
+		bitter::TaskScheduler scheduler(4);
+		for (int i = 0; i < 8; i++)
+		{
+			scheduler.Submit([&]() {
+				for (int j = 0; j < 100; j++)
+				{
+					scheduler.Submit([&]() { counter++; });
+				}
+			});
+		}
+		while (counter < 800)
+		{
+			std::this_thread::yield();
+		}
+	}
+	assert(counter == 800);
+};
+
+void BenchmarkCaseShouldCollectStatistics()
+{
+	class Benchmark final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			bitter::DBenchmarkOptions options;
+			options.WarmupTime = std::chrono::milliseconds(1);
+			options.SampleTime = std::chrono::microseconds(100);
+			options.NumSamples = 20;
+
+			BenchmarkCase("Sum", [this]() {
+				unsigned int sum{};
+				for (unsigned int i = 0; i < 64; i++)
+				{
+					sum += i;
+				}
+				bitter::DoNotOptimize(sum);
+				}, options);
+			BenchmarkCase("Failing", [this]() {
+				TEST_TRUE(false);
+				}, options);
+			TestCase("Not a benchmark", []() {});
+		}
+	};
+	Benchmark inst;
+	inst.Define();
+
+	assert(inst.RunTest("Sum") == true);
+	const bitter::DBenchmarkResult* result = inst.GetBenchmarkResult(inst.FindTest("Sum"));
+	assert(result != nullptr);
+	assert(result->Samples.size() == 20);
+	assert(result->Iterations > 0);
+	assert(result->Min > 0.);
+	assert(result->Min <= result->Median);
+	assert(result->Median <= result->P99);
+	assert(result->StdDev >= 0.);
+	// the hardware counters depend on the machine, when readable an iteration retires some instructions
+	const bitter::HardwareCounterGroup counters(true);
+	assert(counters.IsOpen() == result->Counters.HasAny());
+	assert(!result->Counters.HasAny() || result->Counters.Instructions > 0.);
+
+	assert(inst.RunTest("Failing") == false);
+	assert(inst.GetBenchmarkResult(inst.FindTest("Not a benchmark")) == nullptr);
+
+	bitter::AutomationTester tester;
+	tester.AddTest<Benchmark>("Benchmark");
+	assert(tester.RunAllTests() == false);
+};
+
+void BenchmarkBaselineShouldDetectRegressions()
+{
+	std::vector<double> fast(30), slow(30);
+	for (size_t i = 0; i < fast.size(); i++)
+	{
+		fast[i] = 10. + static_cast<double>(i % 5) * 0.1;
+		slow[i] = 20. + static_cast<double>(i % 5) * 0.1;
+	}
+	assert(bitter::__mannWhitneyGreater(slow, fast) < 0.001);
+	assert(bitter::__mannWhitneyGreater(fast, slow) > 0.999);
+	assert(bitter::__mannWhitneyGreater(fast, fast) > 0.05);
+
+	class Benchmark final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			bitter::DBenchmarkOptions options;
+			options.WarmupTime = std::chrono::milliseconds(1);
+			options.SampleTime = std::chrono::microseconds(50);
+			options.NumSamples = 10;
+
+			BenchmarkCase("Spin", []() {
+				for (unsigned int i = 0; i < 32; i++)
+				{
+					bitter::DoNotOptimize(i);
+				}
+				}, options);
+		}
+	};
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::string Log;
+
+		void OnClassEnd(const bitter::DClassResult& result) override { Log = result.Log; }
+	};
+
+	auto                     recorder = std::make_shared<Recorder>();
+	bitter::AutomationTester tester;
+	tester.AddReporter(recorder);
+	tester.AddTest<Benchmark>("Benchmark");
+
+	const std::string filename = "selftest_baseline.txt";
+	std::map<std::string, bitter::DBenchmarkBaseline> baseline;
+	baseline["Benchmark.Spin"] = { 0.001, std::vector<double>(10, 0.001), {} };
+	assert(bitter::AutomationTester::SaveBenchmarkBaseline(filename, baseline));
+
+	std::string baselineArgument = "--bench-baseline=" + filename;
+	char        program[]        = "selftest";
+	char*       argv[]           = { program, &baselineArgument[0] };
+	assert(tester.RunAllTests(2, argv) == false);
+	assert(recorder->Log.find("In:Spin benchmark regression, median ") == 0);
+	assert(recorder->Log.find("ns against a baseline of 0.00ns") != std::string::npos);
+
+	baseline["Benchmark.Spin"] = { 1e9, std::vector<double>(10, 1e9), {} };
+	assert(bitter::AutomationTester::SaveBenchmarkBaseline(filename, baseline));
+	assert(tester.RunAllTests(2, argv) == true);
+
+	// Save the measurements and compare against them
+	char  save[]     = "--bench-save";
+	char* saveArgv[] = { program, &baselineArgument[0], save };
+	assert(tester.RunAllTests(3, saveArgv) == true);
+
+	std::map<std::string, bitter::DBenchmarkBaseline> saved;
+	assert(bitter::AutomationTester::LoadBenchmarkBaseline(filename, saved));
+	assert(saved.size() == 1);
+	assert(saved["Benchmark.Spin"].Samples.size() == 10);
+	assert(saved["Benchmark.Spin"].Median < 1e9);
+
+	// the counters are kept next to the samples
+	baseline["Benchmark.Spin"] = { 1e9, std::vector<double>(10, 1e9), { 100., 250.5, 0.25, -1. } };
+	assert(bitter::AutomationTester::SaveBenchmarkBaseline(filename, baseline));
+	saved.clear();
+	assert(bitter::AutomationTester::LoadBenchmarkBaseline(filename, saved));
+	assert(saved["Benchmark.Spin"].Samples.size() == 10);
+	assert(saved["Benchmark.Spin"].Counters.Cycles == 100. && saved["Benchmark.Spin"].Counters.Instructions == 250.5);
+	assert(saved["Benchmark.Spin"].Counters.CacheMisses == 0.25 && saved["Benchmark.Spin"].Counters.BranchMisses < 0.);
+	std::remove(filename.c_str());
+};
+
+void SoakShouldRepeatTheSelectedCases()
+{
+	bitter::LatencyHistogram histogram;
+	for (int i = 1; i <= 1000; i++)
+	{
+		histogram.Add(std::chrono::nanoseconds(i));
+	}
+	assert(histogram.Count() == 1000 && histogram.Max() == std::chrono::nanoseconds(1000));
+	assert(std::abs(histogram.Percentile(0.5).count() - 500) <= 35);
+	assert(std::abs(histogram.Percentile(0.99).count() - 990) <= 70);
+
+	static std::atomic<unsigned int> counted{};
+	static std::atomic<unsigned int> flaky{};
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::map<std::string, bitter::DCaseResult> Results;
+
+		void OnCaseEnd(const std::string& className, const bitter::DCaseResult& result) override { Results[className + "." + result.Name] = result; }
+	};
+
+	class Soaked final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Counter", [this]() { counted++; });
+			TestCase("Every tenth", [this]() { TEST_TRUE(++flaky % 10 != 0); });
+			BenchmarkCase("Benchmark", [this]() {});
+		}
+	};
+
+	char  program[]     = "selftest";
+	char  repeat[]      = "--repeat=50";
+	char  concurrency[] = "--concurrency=4";
+	char  shuffle[]     = "--shuffle";
+	char  seed[]        = "--seed=5";
+	char  duration[]    = "--duration=50ms";
+	char* argv[]        = { program, repeat, concurrency, shuffle, seed };
+
+	for (int argc = 2; argc <= 5; argc += 3)
+	{
+		auto                     recorder = std::make_shared<Recorder>();
+		bitter::AutomationTester tester;
+		tester.AddReporter(recorder);
+		tester.AddTest<Soaked>("Soaked");
+		counted = 0;
+		flaky   = 0;
+		assert(tester.RunAllTests(argc, argv) == false);
+		assert(counted == 50 && flaky == 50);
+		assert(recorder->Results.size() == 2 && recorder->Results.count("Soaked.Benchmark") == 0);
+		const bitter::DSoakStats& passing = recorder->Results["Soaked.Counter"].Soak;
+		assert(passing.Runs == 50 && passing.Failures == 0 && passing.FirstFailedIteration == -1);
+		assert(passing.P50 <= passing.P99 && passing.P99 <= passing.Max);
+		const bitter::DCaseResult& failing = recorder->Results["Soaked.Every tenth"];
+		assert(failing.Status == bitter::ETestStatus::FAILED && failing.Soak.Failures == 5);
+		assert(failing.Messages.find("In:Every tenth[line ") != std::string::npos);
+		if (argc == 2)
+		{
+			assert(failing.Soak.FirstFailedIteration == 10);
+		}
+	}
+
+	char*                    timedArgv[] = { program, duration, concurrency };
+	auto                     recorder    = std::make_shared<Recorder>();
+	bitter::AutomationTester tester;
+	tester.AddReporter(recorder);
+	tester.AddTest<Soaked>("Soaked");
+	counted          = 0;
+	const auto start = std::chrono::steady_clock::now();
+	tester.RunAllTests(3, timedArgv);
+	assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+	assert(counted > 0 && recorder->Results["Soaked.Counter"].Soak.Runs == counted);
+};
+
+void ReportersShouldReceiveEveryResult()
+{
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::vector<std::string> Events;
+
+		void OnRunBegin() override { Events.push_back("run"); }
+		void OnClassBegin(const std::string& className) override { Events.push_back("class " + className); }
+		void OnCaseEnd(const std::string& className, const bitter::DCaseResult& result) override
+		{
+			Events.push_back(className + "." + result.Name + " " + bitter::__statusName(result.Status));
+		}
+		void OnClassEnd(const bitter::DClassResult& result) override { Events.push_back("end " + result.Name + " " + std::to_string(result.NumPassed)); }
+		void OnRunEnd(bool passed, std::chrono::nanoseconds) override { Events.push_back(passed ? "passed" : "failed"); }
+	};
+
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Pass", [this]() {TEST_TRUE(true); });
+			TestCase("Fail <&>", [this]() {TEST_TRUE(false); });
+		}
+	};
+
+	const std::vector<std::string> expected = { "run", "class A", "A.Pass passed", "A.Fail <&> failed", "end A 1",
+		"class B", "B.Pass passed", "B.Fail <&> failed", "end B 1", "failed" };
+
+	char        program[] = "selftest";
+	char        jobs[]    = "--jobs=2";
+	std::string junit     = "--junit=selftest_junit.xml";
+	std::string jsonLines = "--jsonl=selftest.jsonl";
+	char*       argv[]    = { program, &junit[0], &jsonLines[0], jobs };
+	for (int argc = 3; argc <= 4; argc++)
+	{
+		auto                     recorder = std::make_shared<Recorder>();
+		bitter::AutomationTester tester;
+		tester.AddReporter(recorder);
+		tester.AddTest<Instance>("A");
+		tester.AddTest<Instance>("B");
+		assert(tester.RunAllTests(argc, argv) == false);
+		assert(recorder->Events == expected);
+
+		std::ifstream     junitFile("selftest_junit.xml");
+		const std::string xml((std::istreambuf_iterator<char>(junitFile)), std::istreambuf_iterator<char>());
+		assert(xml.find("<testsuite name=\"A\" tests=\"2\" failures=\"1\" skipped=\"0\" time=\"") != std::string::npos);
+		assert(xml.find("<testcase classname=\"A\" name=\"Pass\"") > xml.find("<testsuite name=\"A\""));
+		assert(xml.find("<testcase classname=\"B\" name=\"Fail &lt;&amp;&gt;\"") != std::string::npos);
+		assert(xml.find("<failure message=\"In:Fail &lt;&amp;&gt;[line") != std::string::npos);
+		assert(xml.find("</testsuites>") != std::string::npos);
+
+		std::ifstream            jsonFile("selftest.jsonl");
+		std::vector<std::string> lines;
+		for (std::string line; std::getline(jsonFile, line);)
+		{
+			lines.push_back(line);
+		}
+		assert(lines.size() == 7);
+		assert(lines[0].find("{\"type\":\"case\",\"class\":\"A\",\"name\":\"Pass\",\"status\":\"passed\"") == 0);
+		assert(lines[1].find("\"status\":\"failed\"") != std::string::npos);
+		assert(lines[1].find("\"message\":\"In:Fail <&>[line") != std::string::npos);
+		assert(lines[2].find("{\"type\":\"class\",\"class\":\"A\",\"tests\":2,\"passed\":1,\"hooks_passed\":true") == 0);
+		assert(lines[6].find("{\"type\":\"run\",\"passed\":false") == 0);
+	}
+
+	// a failed hook fails the class in the files too
+	class FailingAfterAll final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Pass", [this]() { TEST_TRUE(true); });
+		}
+		void AfterAll() override { throw std::runtime_error("released twice"); }
+	};
+
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<FailingAfterAll>("C");
+		assert(tester.RunAllTests(3, argv) == false);
+
+		std::ifstream     junitFile("selftest_junit.xml");
+		const std::string xml((std::istreambuf_iterator<char>(junitFile)), std::istreambuf_iterator<char>());
+		assert(xml.find("<testsuite name=\"C\" tests=\"2\" failures=\"1\"") != std::string::npos);
+		assert(xml.find("<testcase classname=\"C\" name=\"[hooks]\"") != std::string::npos);
+		assert(xml.find("<failure message=\"AfterAll threw released twice\"") != std::string::npos);
+
+		std::ifstream     jsonFile("selftest.jsonl");
+		const std::string json((std::istreambuf_iterator<char>(jsonFile)), std::istreambuf_iterator<char>());
+		assert(json.find("{\"type\":\"class\",\"class\":\"C\",\"tests\":1,\"passed\":1,\"hooks_passed\":false") != std::string::npos);
+	}
+	std::remove("selftest_junit.xml");
+	std::remove("selftest.jsonl");
+};
+
+void FilterShouldSkipUnselectedClassesAndCases()
+{
+	assert(bitter::TestFilter::GlobMatch("A.*", "A.Case", false));
+	assert(bitter::TestFilter::GlobMatch("*.Ca?e", "A.Case", false));
+	assert(!bitter::TestFilter::GlobMatch("A.*", "AB.Case", false));
+	assert(bitter::TestFilter::GlobMatch("A*.Fast", "AB.", true));
+	assert(!bitter::TestFilter::GlobMatch("A.Fast", "B.", true));
+
+	const bitter::TestFilter filter("Heavy*.Fast*:Light.*-*.FastBroken", "");
+	assert(filter.MayMatchClass("HeavyA"));
+	assert(filter.MayMatchClass("Light"));
+	assert(!filter.MayMatchClass("Other"));
+	assert(filter.MatchesCase("HeavyA", "Fast one"));
+	assert(!filter.MatchesCase("HeavyA", "FastBroken"));
+	assert(!filter.MatchesCase("HeavyA", "Slow"));
+	assert(!bitter::TestFilter("-Heavy.*", "").MayMatchClass("Heavy"));
+
+	static unsigned int constructed{};
+	static unsigned int executed{};
+
+	class Heavy final : public bitter::AutomatedTestInstance {
+	public:
+		Heavy() { constructed++; }
+		virtual void Define() override {
+			TestCase("Fast", [this]() { executed++; });
+			TestCase("Slow", [this]() { executed++; TEST_TRUE(false); });
+		}
+	};
+
+	char  program[]        = "selftest";
+	char  filterArgument[] = "--filter=Selected.Fast";
+	char  regexArgument[]  = "--filter-regex=^Sel.*st$";
+	char  jobs[]           = "--jobs=2";
+	char* argv[]           = { program, filterArgument, jobs };
+	char* regexArgv[]      = { program, regexArgument };
+
+	for (int argc = 2; argc <= 3; argc++)
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Heavy>("Selected");
+		tester.AddTest<Heavy>("Skipped");
+		tester.AddTest<Heavy>("Unselected");
+
+		constructed = 0;
+		executed    = 0;
+		assert(tester.RunAllTests(argc, argv) == true);
+		assert(constructed == 1);
+		assert(executed == 1);
+	}
+
+	bitter::AutomationTester tester;
+	tester.AddTest<Heavy>("Selected");
+	tester.AddTest<Heavy>("Skipped");
+	constructed = 0;
+	executed    = 0;
+	assert(tester.RunAllTests(2, regexArgv) == true);
+	assert(constructed == 2);
+	assert(executed == 1);
+};
+
+void StaticRegistryShouldBeRunBySingleton()
+{
+	std::vector<std::string> registered;
+	for (const bitter::DTestRegistration* registration = bitter::__testRegistryHead(); registration; registration = registration->Next)
+	{
+		registered.push_back(registration->Name);
+	}
+	assert(registered.size() == 2);
+	assert(std::find(registered.begin(), registered.end(), "StaticallyRegistered") != registered.end());
+	assert(std::find(registered.begin(), registered.end(), "InsertedWithoutMacros") != registered.end());
+
+	// Only the singleton runs the static registry
+	bitter::AutomationTester tester;
+	staticRegistrationRuns = 0;
+	assert(tester.RunAllTests() == true);
+	assert(staticRegistrationRuns == 0);
+
+	staticRegistrationRuns = 0;
+	assert(bitter::AutomationTester::GetInstance().RunAllTests() == true);
+	assert(staticRegistrationRuns == 2);
+
+	// A later registration of the same name replaces the class, until its inserter is destroyed
+	class Replacing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Should replace the class", []() { staticRegistrationRuns += 10; });
+		}
+	};
+	{
+		bitter::TestInserter<Replacing> replacing("InsertedWithoutMacros");
+		staticRegistrationRuns = 0;
+		assert(bitter::AutomationTester::GetInstance().RunAllTests() == true);
+		assert(staticRegistrationRuns == 11);
+	}
+	registered.clear();
+	for (const bitter::DTestRegistration* registration = bitter::__testRegistryHead(); registration; registration = registration->Next)
+	{
+		registered.push_back(registration->Name);
+	}
+	assert(registered.size() == 2);
+	staticRegistrationRuns = 0;
+	assert(bitter::AutomationTester::GetInstance().RunAllTests() == true);
+	assert(staticRegistrationRuns == 2);
+};
+
+void WatchdogShouldReportExpiredCases()
+{
+	using namespace std::chrono_literals;
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Default", [this]() { TEST_TRUE(true); });
+			TestCase("Bounded", [this]() { TEST_TRUE(true); }, bitter::Timeout{ 2s });
+		}
+	};
+	Instance inst;
+	inst.Define();
+	assert(inst.GetTimeout(0) == std::chrono::nanoseconds::zero());
+	assert(inst.GetTimeout(1) == std::chrono::seconds(2));
+
+	const std::string   className = "Instance";
+	std::mutex          mutex;
+	std::vector<size_t> expired;
+	{
+		bitter::Watchdog watchdog([&](const bitter::Watchdog::DWatchedCase& watched) {
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(*watched.ClassName == "Instance");
+			expired.push_back(watched.Index);
+		});
+		const uint64_t completed = watchdog.Watch({ &className, &inst, 0, 10s });
+		watchdog.Watch({ &className, &inst, 1, 20ms });
+		watchdog.Unwatch(completed);
+		std::this_thread::sleep_for(100ms);
+	}
+	assert(expired.size() == 1 && expired[0] == 1);
+
+#if defined(BITTER_HAS_FORK)
+	// A case running past its timeout ends the report with a failure and the process with a failure code
+	class Hanging final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Before", [this]() { TEST_TRUE(true); });
+			TestCase("Hang", []() { std::this_thread::sleep_for(10s); }, bitter::Timeout{ 50ms });
+		}
+	};
+
+	std::fflush(nullptr);
+	const pid_t pid = ::fork();
+	if (pid == 0)
+	{
+		char        program[] = "selftest";
+		std::string junit     = "--junit=selftest_timeout.xml";
+		char*       argv[]    = { program, &junit[0] };
+		bitter::AutomationTester tester;
+		tester.AddTest<Hanging>("Hanging");
+		tester.RunAllTests(2, argv);
+		::_exit(0);
+	}
+	int status = 0;
+	assert(::waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE);
+	std::ifstream     junitFile("selftest_timeout.xml");
+	const std::string xml((std::istreambuf_iterator<char>(junitFile)), std::istreambuf_iterator<char>());
+	assert(xml.find("<testsuite name=\"Hanging\" tests=\"2\" failures=\"1\"") != std::string::npos);
+	assert(xml.find("<failure message=\"Timeout:Hanging.Hang did not complete within 50.000ms\"") != std::string::npos);
+	assert(xml.find("</testsuites>") != std::string::npos);
+	std::remove("selftest_timeout.xml");
+#endif
+};
+
+void IsolatedRunShouldContainCrashes()
+{
+#if defined(BITTER_HAS_FORK)
+	static unsigned int constructed = 0;
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::map<std::string, bitter::DCaseResult>  Cases;
+		std::map<std::string, bitter::DClassResult> Classes;
+		std::string                                 Log;
+
+		void OnCaseEnd(const std::string& className, const bitter::DCaseResult& result) override { Cases[className + "." + result.Name] = result; }
+		void OnClassEnd(const bitter::DClassResult& result) override
+		{
+			Log += result.Log;
+			Classes[result.Name] = result;
+		}
+	};
+
+	class Crashing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Before", [this]() { OutLog() << "from the worker"; TEST_TRUE(true); });
+			TestCase("Abort", [this]() { std::abort(); });
+			TestCase("Hang", [this]() { std::this_thread::sleep_for(std::chrono::seconds(10)); }, bitter::Timeout{ std::chrono::milliseconds(50) });
+			TestCase("After", [this]() { TEST_TRUE(true); });
+		}
+	};
+
+	class Parallel final : public bitter::AutomatedTestInstance {
+	public:
+		Parallel() { constructed++; }
+
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			for (int i = 0; i < 16; i++)
+			{
+				TestCase("Case " + std::to_string(i), [this, i]() { TEST_TRUE(i != 3); });
+			}
+		}
+	};
+
+	class CrashingDefinition final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Never defined", [this]() { TEST_TRUE(true); });
+			std::abort();
+		}
+	};
+
+	class FailingAfterAll final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Passing", [this]() { TEST_TRUE(true); });
+		}
+		void AfterAll() override { throw std::runtime_error("released twice"); }
+	};
+
+	char  program[] = "selftest";
+	char  isolate[] = "--isolate";
+	char  jobs[]    = "--jobs=3";
+	char  slowest[] = "--slowest=0";
+	char* argv[]    = { program, isolate, jobs, slowest };
+
+	auto                     recorder = std::make_shared<Recorder>();
+	bitter::AutomationTester tester;
+	tester.AddReporter(recorder);
+	tester.AddTest<Crashing>("Crashing");
+	tester.AddTest<Parallel>("Parallel");
+	tester.AddTest<CrashingDefinition>("CrashingDefinition");
+	tester.AddTest<FailingAfterAll>("FailingAfterAll");
+	assert(tester.RunAllTests(4, argv) == false);
+
+	// only the workers construct the classes
+	assert(constructed == 0);
+	assert(recorder->Classes.size() == 4 && !recorder->Classes["CrashingDefinition"].Passed());
+	assert(recorder->Classes["CrashingDefinition"].Log.find("Define crashed the worker process") == 0);
+	// the AfterAll of the workers is reported to the runner
+	assert(recorder->Classes["Crashing"].HooksPassed && recorder->Classes["Parallel"].HooksPassed);
+	assert(!recorder->Classes["FailingAfterAll"].HooksPassed && recorder->Classes["FailingAfterAll"].NumPassed == 1);
+	assert(recorder->Classes["FailingAfterAll"].Log.find("AfterAll threw released twice") != std::string::npos);
+	assert(recorder->Cases.size() == 21);
+	assert(recorder->Cases["Crashing.Before"].Status == bitter::ETestStatus::PASSED);
+	assert(recorder->Cases["Crashing.Abort"].Status == bitter::ETestStatus::FAILED);
+	assert(recorder->Cases["Crashing.Abort"].Messages.find("crashed the worker process") != std::string::npos);
+	assert(recorder->Cases["Crashing.Hang"].Status == bitter::ETestStatus::FAILED);
+	assert(recorder->Cases["Crashing.Hang"].Messages.find("did not complete") != std::string::npos);
+	assert(recorder->Cases["Crashing.After"].Status == bitter::ETestStatus::PASSED);
+	assert(recorder->Cases["Parallel.Case 3"].Status == bitter::ETestStatus::FAILED);
+	assert(recorder->Cases["Parallel.Case 15"].Status == bitter::ETestStatus::PASSED);
+	assert(recorder->Log.find("from the worker") == 0);
+#endif
+};
+
+void TelemetryShouldPublishTheProgress()
+{
+#if defined(BITTER_HAS_FORK)
+	static const std::string          filename = "selftest.telemetry";
+	static bitter::DTelemetrySnapshot observed;
+
+	class Observed final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Passing", [this]() { TEST_TRUE(true); });
+			TestCase("Failing", [this]() { TEST_TRUE(false); });
+			TestCase("Observe", [this]() { TEST_TRUE(bitter::Telemetry::Read(filename, observed)); });
+		}
+	};
+
+	class Crashing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Abort", [this]() { std::abort(); });
+			TestCase("After", [this]() { TEST_TRUE(true); });
+		}
+	};
+
+	std::string telemetryArgument = "--telemetry=" + filename;
+	char        program[]         = "selftest";
+	char        jobs[]            = "--jobs=2";
+	char        isolate[]         = "--isolate";
+	char        repeat[]          = "--repeat=4";
+	char*       argv[]            = { program, &telemetryArgument[0], jobs, isolate };
+
+	bitter::DTelemetrySnapshot snapshot;
+	for (int argc = 2; argc <= 3; argc++)
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Observed>("Observed");
+		observed = {};
+		assert(tester.RunAllTests(argc, argv) == false);
+
+		// the observing case sees itself running on its worker
+		assert(observed.Running && observed.Cases == 3 && observed.Passed == 1 && observed.Failed == 1 && observed.Remaining == 1);
+		assert(std::count_if(observed.Workers.begin(), observed.Workers.end(), [](const bitter::DTelemetrySnapshot::DWorkerStatus& worker) {
+			return worker.Case == "Observed.Observe";
+		}) == 1);
+
+		assert(bitter::Telemetry::Read(filename, snapshot));
+		assert(!snapshot.Running && snapshot.Cases == 3 && snapshot.Passed == 2 && snapshot.Failed == 1 && snapshot.Remaining == 0);
+		assert(snapshot.Elapsed > std::chrono::nanoseconds::zero() && snapshot.PeakRss > 0);
+		for (const auto& worker : snapshot.Workers)
+		{
+			assert(worker.Case.empty());
+		}
+	}
+
+	// the case of a crashed worker process is counted by the runner
+	{
+		bitter::AutomationTester tester;
+		tester.AddTest<Crashing>("Crashing");
+		assert(tester.RunAllTests(4, argv) == false);
+		assert(bitter::Telemetry::Read(filename, snapshot));
+		assert(snapshot.Cases == 2 && snapshot.Passed == 1 && snapshot.Failed == 1 && snapshot.Remaining == 0);
+	}
+
+	// a soak counts every run
+	{
+		char*                    soakArgv[] = { program, &telemetryArgument[0], repeat };
+		bitter::AutomationTester tester;
+		tester.AddTest<Observed>("Observed");
+		assert(tester.RunAllTests(3, soakArgv) == false);
+		assert(bitter::Telemetry::Read(filename, snapshot));
+		assert(snapshot.Cases == 12 && snapshot.Passed == 8 && snapshot.Failed == 4);
+	}
+
+	std::ofstream(filename) << "not a telemetry file";
+	assert(!bitter::Telemetry::Read(filename, snapshot));
+	std::remove(filename.c_str());
+#endif
+};
+
+void ShardsShouldPartitionEveryCase()
+{
+	static unsigned int definitions = 0;
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::vector<std::string> Cases;
+
+		void OnCaseEnd(const std::string& className, const bitter::DCaseResult& result) override { Cases.push_back(className + "." + result.Name); }
+	};
+
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			definitions++;
+			for (int i = 0; i < 30; i++)
+			{
+				TestCase("Case " + std::to_string(i), [this]() { TEST_TRUE(true); });
+			}
+		}
+	};
+
+	std::ofstream durations("selftest.durations");
+	for (int i = 0; i < 30; i++)
+	{
+		durations << "A.Case " << i << '\t' << (i < 3 ? 1000000 : 1000) << '\n';
+	}
+	durations.close();
+
+	char program[]       = "selftest";
+	char shardCount[]    = "--shard-count=3";
+	char balance[]       = "--shard-balance";
+	char durationsFile[] = "--durations=selftest.durations";
+	char slowest[]       = "--slowest=0";
+	for (int balanced = 0; balanced < 2; balanced++)
+	{
+		std::map<std::string, int> runs;
+		for (int shard = 0; shard < 3; shard++)
+		{
+			std::string shardIndex = "--shard-index=" + std::to_string(shard);
+			char*       argv[]     = { program, &shardIndex[0], shardCount, slowest, balance, durationsFile };
+
+			auto                     recorder = std::make_shared<Recorder>();
+			bitter::AutomationTester tester;
+			tester.AddReporter(recorder);
+			tester.AddTest<Instance>("A");
+			tester.AddTest<Instance>("B");
+			definitions = 0;
+			assert(tester.RunAllTests(balanced ? 6 : 4, argv) == true);
+			// the plan of the shards defines the classes that the run uses
+			assert(definitions == 2);
+			assert(!recorder->Cases.empty());
+			int slowCases = 0;
+			for (const std::string& name : recorder->Cases)
+			{
+				runs[name]++;
+				slowCases += name == "A.Case 0" || name == "A.Case 1" || name == "A.Case 2";
+			}
+			if (balanced)
+			{
+				// the three slow cases end on different shards and the rest is split evenly
+				assert(slowCases == 1);
+				assert(recorder->Cases.size() == 20);
+			}
+		}
+		assert(runs.size() == 60);
+		for (const auto& run : runs)
+		{
+			assert(run.second == 1);
+		}
+	}
+
+	char                     save[] = "--durations-save";
+	char*                    argv[] = { program, durationsFile, save, slowest };
+	bitter::AutomationTester tester;
+	tester.AddTest<Instance>("C");
+	assert(tester.RunAllTests(4, argv) == true);
+	std::map<std::string, std::chrono::nanoseconds> saved;
+	assert(bitter::AutomationTester::LoadDurations("selftest.durations", saved));
+	assert(saved.size() == 60 && saved["A.Case 0"] == std::chrono::milliseconds(1) && saved.count("C.Case 29"));
+	std::remove("selftest.durations");
+
+	char       invalidIndex[] = "--shard-index=3";
+	char*      invalidArgv[]  = { program, invalidIndex, shardCount };
+	const auto options        = bitter::AutomationTester::ParseArguments(3, invalidArgv);
+	assert(options.ShardCount == 1 && options.ShardIndex == 0);
+};
+
+static std::mutex        startedMutex;
+static std::vector<char> startedClasses;
+
+template<char N>
+class StartRecorder final : public bitter::AutomatedTestInstance {
+public:
+	virtual void Define() override {
+		TestCase("Case", [this]() {
+			{
+				std::lock_guard<std::mutex> lock(startedMutex);
+				startedClasses.push_back(N);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			TEST_TRUE(true);
+		});
+	}
+};
+
+void HistoryShouldStartTheLongestClassesFirst()
+{
+	std::vector<int> order;
+	{
+		bitter::TaskScheduler                  scheduler(1);
+		std::vector<std::function<void(void)>> tasks;
+		for (int i = 0; i < 8; i++)
+		{
+			tasks.push_back([&order, i]() { order.push_back(i); });
+		}
+		scheduler.SubmitBatch(std::move(tasks));
+	}
+	assert((order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7 }));
+
+	std::ofstream history("selftest.history");
+	history << "B.Case\t2000000\nC.Case\t9000000\n";
+	history.close();
+
+	char  program[]     = "selftest";
+	char  jobs[]        = "--jobs=2";
+	char  historyFile[] = "--history=selftest.history";
+	char  slowest[]     = "--slowest=0";
+	char* argv[]        = { program, jobs, historyFile, slowest };
+
+	bitter::AutomationTester tester;
+	tester.AddTest<StartRecorder<'A'>>("A");
+	tester.AddTest<StartRecorder<'B'>>("B");
+	tester.AddTest<StartRecorder<'C'>>("C");
+	assert(tester.RunAllTests(4, argv) == true);
+	// A has no history and weighs the mean of B and C, so C and A start first
+	assert(startedClasses.size() == 3);
+	assert(startedClasses[2] == 'B');
+
+	std::map<std::string, std::chrono::nanoseconds> saved;
+	assert(bitter::AutomationTester::LoadDurations("selftest.history", saved));
+	assert(saved.size() == 3 && saved["C.Case"] >= std::chrono::milliseconds(20));
+	std::remove("selftest.history");
+};
+
+void ResultsShouldDriveRerunAndCache()
+{
+	static int passRuns = 0;
+	static int failRuns = 0;
+
+	class Recorder final : public bitter::Reporter {
+	public:
+		std::vector<bitter::DCaseResult> Cases;
+
+		void OnCaseEnd(const std::string&, const bitter::DCaseResult& result) override { Cases.push_back(result); }
+	};
+
+	class Instance final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Pass", [this]() { passRuns++; TEST_TRUE(true); });
+			TestCase("Fail", [this]() { failRuns++; TEST_EQUAL(1, 2); });
+		}
+	};
+
+	char program[] = "selftest";
+	char results[] = "--results=selftest.results";
+	char rerun[]   = "--rerun-failed";
+	char cache[]   = "--cache";
+	char slowest[] = "--slowest=0";
+	const auto run = [&](char* option, const std::string& fingerprint) {
+		char*                    argv[]   = { program, results, slowest, option };
+		auto                     recorder = std::make_shared<Recorder>();
+		bitter::AutomationTester tester;
+		tester.AddReporter(recorder);
+		tester.AddTest<Instance>("A");
+		tester.AddTest<Instance>("B");
+		if (!fingerprint.empty())
+		{
+			tester.SetFingerprint("A", fingerprint);
+		}
+		assert(tester.RunAllTests(option ? 4 : 3, argv) == false);
+		return recorder->Cases;
+	};
+
+	std::remove("selftest.results");
+	run(nullptr, std::string());
+	assert(passRuns == 2 && failRuns == 2);
+
+	auto cases = run(rerun, std::string());
+	assert(passRuns == 2 && failRuns == 4);
+	assert(cases.size() == 2 && cases[0].Name == "Fail" && cases[1].Name == "Fail");
+
+	std::map<std::string, bitter::DRecordedClass> recorded;
+	assert(bitter::AutomationTester::LoadResults("selftest.results", recorded));
+	assert(recorded.size() == 2 && recorded["A"].Complete && recorded["A"].Cases.size() == 2);
+	assert(recorded["A"].Cases[1].Status == bitter::ETestStatus::FAILED);
+	assert(recorded["A"].Cases[1].Messages.find("TEST_EQUAL(1,2)") != std::string::npos);
+	assert(recorded["A"].Cases[1].Messages.back() == '\n');
+
+	// the fingerprint changed from none to v1, so A runs once more before being cached
+	run(cache, "v1");
+	assert(passRuns == 4 && failRuns == 6);
+	cases = run(cache, "v1");
+	assert(passRuns == 5 && failRuns == 7);
+	assert(cases.size() == 4 && cases[0].Cached && cases[1].Cached && !cases[2].Cached);
+	assert(cases[0].Status == bitter::ETestStatus::PASSED && cases[1].Status == bitter::ETestStatus::FAILED);
+	run(cache, "v2");
+	assert(passRuns == 7 && failRuns == 9);
+	std::remove("selftest.results");
+};
+
+void FixturesShouldWrapCasesAndClasses()
+{
+	static std::atomic<int> setUps{};
+	static std::atomic<int> tearDowns{};
+	static std::atomic<int> bodies{};
+	static std::atomic<int> beforeAlls{};
+	static std::atomic<int> afterAlls{};
+	static std::atomic<int> constructed{};
+	static std::atomic<int> destroyed{};
+
+	struct Dataset
+	{
+		Dataset() { constructed++; }
+		~Dataset() { destroyed++; }
+		int Value{ 42 };
+	};
+
+	class Hooked final : public bitter::AutomatedTestInstance {
+	public:
+		static void DeclareSharedFixtures(bitter::SharedFixtureUsers& users) { users.Use<Dataset>(); }
+		virtual void Define() override {
+			SetRunCasesInParallel(true);
+			for (int i = 0; i < 4; i++)
+			{
+				TestCase("Case" + std::to_string(i), [this]() {
+					bodies++;
+					TEST_EQUAL(Shared->Value, 42);
+					});
+			}
+		}
+		void SetUp() override { setUps++; }
+		void TearDown() override { tearDowns++; }
+		void BeforeAll() override {
+			beforeAlls++;
+			Shared = bitter::SharedFixtures::Acquire<Dataset>();
+		}
+		void AfterAll() override {
+			afterAlls++;
+			Shared.reset();
+		}
+		std::shared_ptr<Dataset> Shared;
+	};
+
+	// runs after the users of the fixture in a serial run
+	static std::atomic<int> destroyedBeforeLast{};
+	class Unrelated final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("After the users", []() { destroyedBeforeLast = destroyed.load(); });
+		}
+	};
+
+	class BrokenBeforeAll final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Should not run", []() { bodies++; });
+		}
+		void BeforeAll() override { TEST_TRUE(false); }
+		void AfterAll() override { afterAlls++; }
+	};
+
+	class FailingSetUp final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Should not run", []() { bodies++; });
+		}
+		void SetUp() override { throw std::runtime_error("no device"); }
+		void TearDown() override { tearDowns++; }
+	};
+
+	char program[]  = "selftest";
+	char jobs[]     = "--jobs=4";
+	char parallel[] = "--parallel-cases";
+	char slowest[]  = "--slowest=0";
+	for (int mode = 0; mode < 3; mode++)
+	{
+		setUps = tearDowns = bodies = beforeAlls = afterAlls = constructed = destroyed = 0;
+		char* argv[] = { program, slowest, jobs, parallel };
+		const int argc = mode == 0 ? 2 : mode == 1 ? 3 : 4;
+
+		bitter::AutomationTester passingTester;
+		for (int i = 0; i < 8; i++)
+		{
+			passingTester.AddTest<Hooked>("Hooked" + std::to_string(i));
+		}
+		passingTester.AddTest<Unrelated>("Unrelated");
+		assert(passingTester.RunAllTests(argc, argv) == true);
+		assert(setUps == 32 && tearDowns == 32 && bodies == 32);
+		assert(beforeAlls == 8 && afterAlls == 8);
+		// shared by every class that declared it and released after the last of them
+		assert(constructed == 1 && destroyed == 1);
+		assert(mode != 0 || destroyedBeforeLast == 1);
+		assert(bitter::SharedFixtures::GetNumAlive() == 0);
+
+		bodies = afterAlls = tearDowns = 0;
+		bitter::AutomationTester failingTester;
+		failingTester.AddTest<BrokenBeforeAll>("Broken");
+		failingTester.AddTest<FailingSetUp>("FailingSetUp");
+		assert(failingTester.RunAllTests(argc, argv) == false);
+		assert(bodies == 0 && afterAlls == 0 && tearDowns == 1);
+	}
+
+	// an exception is reported with the case, whatever is thrown
+	class Throwing final : public bitter::AutomatedTestInstance {
+	public:
+		virtual void Define() override {
+			TestCase("Throws an int", []() { throw 7; });
+		}
+		void TearDown() override { throw std::logic_error("torn"); }
+	};
+	FailingSetUp failingSetUp;
+	failingSetUp.Define();
+	assert(failingSetUp.RunTest(0) == false);
+	assert(failingSetUp.GetFailureMessages(0).find("In:Should not run threw no device") != std::string::npos);
+	Throwing throwing;
+	throwing.Define();
+	assert(throwing.RunTest(0) == false);
+	assert(throwing.GetFailureMessages(0).find("In:Throws an int threw\n") != std::string::npos);
+	assert(throwing.GetFailureMessages(0).find("In:Throws an int TearDown threw torn") != std::string::npos);
+
+	// outside of a run the last handle destroys the fixture
+	constructed = destroyed = 0;
+	{
+		auto first  = bitter::SharedFixtures::Acquire<Dataset>();
+		auto second = bitter::SharedFixtures::Acquire<Dataset>();
+		assert(first == second && constructed == 1);
+		auto other = bitter::SharedFixtures::Acquire<Dataset>("other", []() { return std::make_shared<Dataset>(); });
+		assert(other != first && constructed == 2);
+	}
+	assert(destroyed == 2 && bitter::SharedFixtures::GetNumAlive() == 0);
+};
+
+void ArgumentsShouldBeParsed()
+{
+	char  program[] = "selftest";
+	char  log[]     = "log.txt";
+	char  jobs[]    = "--jobs=3";
+	char* argv[]    = { program, jobs, log };
+
+	const auto options = bitter::AutomationTester::ParseArguments(3, argv);
+	assert(options.Jobs == 3);
+	assert(options.LogFilename == "log.txt");
+
+	const auto defaults = bitter::AutomationTester::ParseArguments(1, argv);
+	assert(defaults.Jobs == 1);
+	assert(defaults.LogFilename.empty());
+	assert(defaults.Timeout == std::chrono::nanoseconds::zero());
+
+	char       timeout[]     = "--timeout=1.5s";
+	char*      timeoutArgv[] = { program, timeout };
+	const auto withTimeout   = bitter::AutomationTester::ParseArguments(2, timeoutArgv);
+	assert(withTimeout.Timeout == std::chrono::milliseconds(1500));
+
+	std::chrono::nanoseconds duration{};
+	assert(bitter::AutomationTester::ParseDuration("250ms", duration) && duration == std::chrono::milliseconds(250));
+	assert(bitter::AutomationTester::ParseDuration("2", duration) && duration == std::chrono::seconds(2));
+	assert(bitter::AutomationTester::ParseDuration("1m", duration) && duration == std::chrono::minutes(1));
+	assert(!bitter::AutomationTester::ParseDuration("5 apples", duration));
+	assert(!bitter::AutomationTester::ParseDuration("", duration));
+	assert(!bitter::AutomationTester::ParseDuration("300y", duration));
+	assert(!bitter::AutomationTester::ParseDuration("1e300s", duration));
+	assert(!bitter::AutomationTester::ParseDuration("300000000h", duration));
+	assert(!bitter::AutomationTester::ParseDuration("nan", duration));
+	assert(bitter::AutomationTester::ParseDuration("2000000h", duration) && duration == std::chrono::hours(2000000));
+};
 
 int main(int argc, char* argv[])
 {
@@ -188,6 +2341,38 @@ int main(int argc, char* argv[])
 	InstanceShouldReturnCorrectValues();
 	InstanceShouldListAllTestNames();
 	InstanceShouldRunTestByNames();
+	InstanceShouldRunTestByIndex();
+	InstanceShouldMeasureDurations();
+	InstanceShouldKeepFailureMessagesPerTest();
+	InstanceShouldStoreManyTestCases();
+	ComparisonMacrosShouldReportOperands();
+	AllocationsShouldBeCountedPerCase();
+	BufferAssertionsShouldReportTheFirstMismatch();
+	SnapshotsShouldMatchTheGoldenFiles();
+	ParameterizedCasesShouldRunEveryParameter();
+	PropertyCasesShouldShrinkTheCounterexample();
+	AsyncStreamBufferShouldWriteEverything();
+	ParallelJobsShouldRunEveryClass();
+	ParallelCasesShouldReportEachCase();
+	AttachedThreadsShouldReportToTheirCase();
+#if defined(BITTER_HAS_COROUTINES)
+	AsyncCasesShouldRunConcurrently();
+#endif
+	SchedulerShouldRunNestedTasks();
+	BenchmarkCaseShouldCollectStatistics();
+	BenchmarkBaselineShouldDetectRegressions();
+	ReportersShouldReceiveEveryResult();
+	SoakShouldRepeatTheSelectedCases();
+	FilterShouldSkipUnselectedClassesAndCases();
+	StaticRegistryShouldBeRunBySingleton();
+	WatchdogShouldReportExpiredCases();
+	IsolatedRunShouldContainCrashes();
+	TelemetryShouldPublishTheProgress();
+	ShardsShouldPartitionEveryCase();
+	HistoryShouldStartTheLongestClassesFirst();
+	ResultsShouldDriveRerunAndCache();
+	FixturesShouldWrapCasesAndClasses();
+	ArgumentsShouldBeParsed();
 
     std::cout << "All self tests passed" << std::endl;
 	return 0;